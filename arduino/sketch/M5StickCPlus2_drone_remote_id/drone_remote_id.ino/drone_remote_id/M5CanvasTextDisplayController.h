@@ -1,56 +1,77 @@
 #include <M5Unified.h>
+#include <vector>
+#include <algorithm> // std::fill, std::equal
+#include <cstdarg>   // va_list
+#include <cstdio>    // vsnprintf
+#include <cstring>   // strlen
 
 /**
  * @class M5CanvasTextDisplayController
  * @brief M5GFXディスプレイ上でテキスト表示を効率的に行うためのコントローラクラス
  *
- * ダブルバッファリングを使用して、ちらつきのないテキスト更新を実現します
+ * 画面の内容を文字セル (行 x 列の文字と色属性) のグリッドとして保持します
+ * setText/print などはグリッドを書き換えるだけで、show() で前回表示したグリッドとの差分を取り、
+ * 変わった行だけを1行分の高さのストリップバッファへ描画してLCDへ転送します
+ * ストリップバッファは2本を交互に使い、一方をDMA転送している間にもう一方へ次の行を描画します
+ * 画面全体のキャンバスを持たないため、表示用のメモリは数KB (ストリップ2本分) で済みます
+ * ASCII文字は文字サイズ変更時に1bitのマスク (グリフキャッシュ) へ変換しておき、
+ * ストリップへはフォントを引かずにマスクから直接書き込みます
  * 文字単位のグリッドベースでのテキスト配置や、Arduino Printクラスライクな
  * インターフェースを提供します。画面の回転や文字サイズの変更にも対応しています
  */
 class M5CanvasTextDisplayController {
 public:
+    /**
+     * @struct FrameStats
+     * @brief show() の転送コストを確認するための統計情報
+     */
+    struct FrameStats {
+        uint32_t frames = 0;          ///< show() の呼び出し回数
+        uint32_t rowsPushed = 0;      ///< LCDへ転送した行数の累計
+        uint32_t rowsUnchanged = 0;   ///< ダーティだったが内容が変わっていなかったため転送しなかった行数の累計
+        uint32_t rowsClean = 0;       ///< ダーティでなかったため比較もしなかった行数の累計
+        uint32_t cellsDrawn = 0;      ///< ストリップバッファへ描画した文字セル数の累計
+        uint32_t bytesPushed = 0;     ///< LCDへ転送したバイト数の累計
+        uint32_t lastShowUs = 0;      ///< 直近の show() の所要時間 (マイクロ秒)
+        uint32_t maxShowUs = 0;       ///< show() の最大所要時間 (マイクロ秒)
+    };
+
     /**
      * @brief M5CanvasTextDisplayController のコンストラクタ
      * @param display 操作対象の M5GFX (M5Display) オブジェクトへの参照
      * @note この時点ではM5Canvasオブジェクトのインスタンス化のみを行い、
-     *       スプライトのメモリ確保 (createSprite) は begin() または setRotation() で行われます
-     */
-    M5CanvasTextDisplayController(M5GFX& display) : 
-        _lcd(display), 
-        _canvas1(nullptr), 
-        _canvas2(nullptr),
-        _activeCanvas(nullptr),
-        _drawingCanvas(nullptr)
+     *       スプライトのメモリ確保 (createSprite) は begin() または setTextSize() で行われます
+     */
+    M5CanvasTextDisplayController(M5GFX& display) :
+        _lcd(display)
     {
-        // M5Canvasオブジェクトを生成します。スプライトの作成はまだ行いません
-        _canvas1 = new M5Canvas(&_lcd);
-        _canvas2 = new M5Canvas(&_lcd);
+        // ストリップ用のM5Canvasオブジェクトを生成します。スプライトの作成はまだ行いません
+        for (int i = 0; i < STRIP_COUNT; ++i) {
+            _strips[i] = new M5Canvas(&_lcd);
+        }
     }
 
     /**
      * @brief M5CanvasTextDisplayController のデストラクタ
      *
-     * 確保された2つのM5Canvasオブジェクトと、それらが持つスプライトメモリを解放します
+     * 確保されたM5Canvasオブジェクトと、そのスプライトメモリを解放します
      */
     ~M5CanvasTextDisplayController() {
-        if (_canvas1) {
-            _canvas1->deleteSprite(); // スプライトメモリを解放
-        }
-        if (_canvas2) {
-            _canvas2->deleteSprite(); // スプライトメモリを解放
+        _lcd.waitDMA(); // 転送中のストリップを解放しないように待つ
+        for (int i = 0; i < STRIP_COUNT; ++i) {
+            if (_strips[i]) {
+                _strips[i]->deleteSprite(); // スプライトメモリを解放
+            }
+            delete _strips[i]; // M5Canvasオブジェクト自体を解放
+            _strips[i] = nullptr;
         }
-        delete _canvas1; // M5Canvasオブジェクト自体を解放
-        _canvas1 = nullptr;
-        delete _canvas2; // M5Canvasオブジェクト自体を解放
-        _canvas2 = nullptr;
     }
 
     /**
      * @brief ディスプレイコントローラの初期化を行います
      *
      * 画面の回転、テキストサイズ、文字色、背景色を設定し、
-     * ダブルバッファ用のキャンバスを指定された回転に基づいて作成します
+     * ストリップバッファを画面の幅と文字の高さに合わせて作成します
      *
      * @param initialTextSize 初期テキストサイズ (デフォルト: 1)
      * @param initialLineWrap 初期状態でテキストの行ラップを有効にするか (デフォルト: true)
@@ -58,7 +79,7 @@ public:
      * @param bgColor 初期背景色 (デフォルト: BLACK)
      * @param initialRotation 初期画面回転 (0-3、M5GFXの回転定数。デフォルト: 0)
      * @return 初期化に成功した場合は true、失敗した場合は false
-     *         主にキャンバスの作成に失敗した場合に false を返します
+     *         主にストリップバッファの作成に失敗した場合に false を返します
      */
     bool begin(int initialTextSize = 1, bool initialLineWrap = true,
                uint16_t textColor = WHITE, uint16_t bgColor = BLACK,
@@ -66,49 +87,39 @@ public:
         _textColor = textColor;
         _bgColor = bgColor;
         _lineWrap = initialLineWrap;
-        // 最初に回転を設定します。これによりキャンバスが適切なサイズで作成されます
+        _textSize = initialTextSize;
+        // 回転を設定します。内部で setTextSize(_textSize) が呼ばれ、ストリップバッファが適切なサイズで作成されます
         // begin() 内部では、まだ画面に表示する必要がないため、setRotationの第2引数 doShow は false にします
         if (!setRotation(initialRotation, false)) {
-             Serial.println("Error: Failed to set initial rotation and create canvases in begin().");
-             return false; // 回転設定失敗はキャンバス作成失敗を意味します
+             Serial.println("Error: Failed to set initial rotation and create strip buffers in begin().");
+             return false; // 回転設定失敗はストリップバッファ作成失敗を意味します
         }
-        // setTextSizeはsetRotation内で一度呼ばれますが、
-        // 引数で指定されたinitialTextSizeを確実に適用するために再度呼び出します
-        // ここでも、まだ画面に表示する必要がないため、setTextSizeの第2引数 doShow は false にします
-        setTextSize(initialTextSize, false);
-        // 両方のキャンバスは setRotation -> _recreateCanvases -> _clearAndResetDrawingCanvas 及び
-        // _activeCanvas->fillSprite(_bgColor) によって初期背景色でクリアされます
-        // print用カーソルはsetTextSize -> _clearAndResetDrawingCanvas で初期化されます
-        // 必要であれば、beginの最後に空の画面をshow()することもできますが、
-        // 通常は最初の描画内容をセットした後にshow()を呼び出すため、ここでは行いません
-        // show(); 
+        // 通常は最初の描画内容をセットした後にshow()を呼び出すため、ここでは表示しません
         return true;
     }
-    
+
     /**
-     * @brief LCD表示とキャンバスの回転を設定します
+     * @brief LCD表示の回転を設定します
      *
-     * このメソッドを呼び出すと、内部のキャンバスは現在のLCDの幅と高さに合わせて再作成されます
-     * 再作成後、現在のテキストサイズ設定に基づいて文字の行数・列数が再計算され、
-     * 描画キャンバスはクリアされます
+     * 現在のテキストサイズ設定に基づいて、新しい画面寸法での文字の行数・列数が再計算され、
+     * ストリップバッファは新しい画面の幅に合わせて再作成されます。文字グリッドはクリアされます
      *
      * @param rotation 新しい画面の回転方向 (0, 1, 2, 3)。M5GFXの回転定数に対応します
-     * @param doShow trueの場合、回転設定後に現在の描画キャンバスの内容をLCDに表示します (デフォルト: true)
+     * @param doShow trueの場合、回転設定後に現在の内容をLCDに表示します (デフォルト: true)
      *               falseの場合、表示は行いません
-     * @return キャンバスの再作成と設定に成功した場合は true、失敗した場合は false
+     * @return ストリップバッファの再作成に成功した場合は true、失敗した場合は false
      */
     bool setRotation(uint8_t rotation, bool doShow = true) {
+        _lcd.waitDMA(); // 転送中は回転を変えない
         _lcd.setRotation(rotation); // LCD自体の回転を設定
-        // 新しい画面寸法に合わせてキャンバスを再作成します
-        if (!_recreateCanvases()) {
-            Serial.println("Error: Failed to recreate canvases for new rotation.");
-            return false;
-        }
-        // 文字サイズ関連の情報を再計算します
         // setTextSizeを呼び出すことで、新しい画面寸法に基づいた _rows, _cols が計算され、
-        // 描画キャンバスがクリアされ、フォント設定も適用されます
+        // ストリップバッファの再作成と文字グリッドのクリアが行われます
         // ここでは doShow = false で呼び出し、最後の show() でまとめて表示します
         setTextSize(_textSize, false);
+        if (!_stripsReady) {
+            Serial.println("Error: Failed to recreate strip buffers for new rotation.");
+            return false;
+        }
         if (doShow) {
             show(); // 新しい回転とサイズで画面を更新します
         }
@@ -118,11 +129,12 @@ public:
     /**
      * @brief テキストのサイズを設定します
      *
-     * 文字サイズを変更すると、画面に表示可能な行数 (_rows) と列数 (_cols) が再計算されます
-     * また、描画キャンバスはクリアされ、カーソル位置もリセットされます
+     * 文字サイズを変更すると、画面に表示可能な行数 (_rows) と列数 (_cols) が再計算され、
+     * 文字グリッドとストリップバッファ (1行分の高さ) が作り直されます
+     * カーソル位置もリセットされ、次の show() で画面全体を描画し直します
      *
      * @param size 新しいテキストサイズ (1以上の整数)。M5GFXのsetTextSizeに渡されます
-     * @param doShow trueの場合、文字サイズ変更後に現在の描画キャンバスの内容をLCDに表示します (デフォルト: true)
+     * @param doShow trueの場合、文字サイズ変更後に現在の内容をLCDに表示します (デフォルト: true)
      *               falseの場合、表示は行いません
      * @note 内部でフォントサイズを取得し、それに基づいて行数・列数を計算します
      *       デフォルトフォント (font 0) が使用されます
@@ -130,31 +142,30 @@ public:
     void setTextSize(int size, bool doShow = true) {
         if (size < 1) size = 1; // サイズは1以上を保証
         _textSize = size;
-        // 両方のキャンバスに新しい文字サイズとデフォルトフォント(font 0)を設定します
-        if (_drawingCanvas) {
-            _drawingCanvas->setTextSize(_textSize);
-            _drawingCanvas->setTextFont(0); // 標準フォントを使用
-        }
-        if (_activeCanvas) {
-            _activeCanvas->setTextSize(_textSize);
-            _activeCanvas->setTextFont(0);  // 標準フォントを使用
-        }
-        // フォントの高と幅を取得します。_drawingCanvasが存在することを期待します
-        if(_drawingCanvas) {
-            _fontHeight = _drawingCanvas->fontHeight();
-            _fontWidth = _drawingCanvas->fontWidth();
-        } else {
-            // フォールバック: _drawingCanvasが未作成の場合 (通常は発生しないはず)
-             _fontHeight = 8 * _textSize; // 標準フォントの高さの目安
-             _fontWidth = 6 * _textSize;  // 標準フォントの幅の目安 (font 0は可変幅だが、createSprite用には固定値が必要な場合がある)
+        for (int i = 0; i < STRIP_COUNT; ++i) {
+            _strips[i]->setTextSize(_textSize);
+            _strips[i]->setTextFont(0); // 標準フォントを使用
         }
+        // フォントの寸法はスプライトのメモリがなくても取得できます
+        _fontHeight = _strips[0]->fontHeight();
+        _fontWidth = _strips[0]->fontWidth();
         // fontHeight/Widthが0になるケース(フォント未設定時など)へのフォールバック
         if (_fontHeight == 0) _fontHeight = 8 * _textSize; // 8は標準フォントの基本高さ
         if (_fontWidth == 0) _fontWidth = 6 * _textSize;   // 6は標準フォントの多くの文字の基本幅
-        // 現在のLCDの幅と高さから、表示可能な文字の行数と列数を計算します
-        _rows = _lcd.height() / _fontHeight;
-        _cols = _lcd.width() / _fontWidth;
-        // 描画キャンバスをクリアし、カーソル位置をリセットします
+        _screenWidth = _lcd.width();
+        _screenHeight = _lcd.height();
+        // 画面の幅と高さから、表示可能な文字の行数と列数を計算します
+        _rows = _screenHeight / _fontHeight;
+        _cols = _screenWidth / _fontWidth;
+        if (!_recreateStrips()) {
+            _rows = 0; // ストリップがなければ何も表示できない
+            _cols = 0;
+        }
+        _buildGlyphCache();
+        _cells.assign((size_t)_rows * _cols, Cell());
+        _presentedCells.assign((size_t)_rows * _cols, Cell());
+        _rowDirty.assign(_rows, 1);
+        _fullPushPending = true; // グリッドの形が変わったので次の show() で全体を描画し直す
         _clearAndResetDrawingCanvas();
         if (doShow) {
             show(); // 新しい文字サイズで画面を更新します
@@ -162,40 +173,36 @@ public:
     }
 
     /**
-     * @brief 指定した行・列に文字列を描画します
+     * @brief 指定した行・列に文字列を書き込みます
      *
      * 文字列が指定した位置から画面右端を超える場合、自動的に切り詰められます
-     * 描画は内部の描画キャンバスに対して行われ、show()が呼び出されるまで画面には反映されません
+     * 書き込みは文字グリッドに対して行われ、show()が呼び出されるまで画面には反映されません
      *
-     * @param row 描画を開始する行 (0から始まるインデックス)
-     * @param col 描画を開始する列 (0から始まるインデックス)
-     * @param text 描画する文字列 (Stringオブジェクト)
-     * @note このメソッドは文字の背景を指定された背景色で塗りつぶしてから文字を描画します
+     * @param row 書き込みを開始する行 (0から始まるインデックス)
+     * @param col 書き込みを開始する列 (0から始まるインデックス)
+     * @param text 書き込む文字列 (Stringオブジェクト)
+     * @note 書き込んだ文字セルは現在の文字色・背景色になります
      */
     void setText(int row, int col, const String& text) {
-        if (row < 0 || row >= _rows || col < 0 || col >= _cols || !_drawingCanvas) return;
-        int x = col * _fontWidth; // ピクセル座標X
-        int y = row * _fontHeight; // ピクセル座標Y
-        _drawingCanvas->setTextDatum(TL_DATUM); // 左上基準で描画
-        String sub = text;
-        int maxLen = _cols - col; // 現在のカーソル位置から行末までの最大文字数
-        if (text.length() > (unsigned int)maxLen) {
-            sub = text.substring(0, maxLen); // 最大文字数に合わせて文字列を切り詰める
-        }
-        // 文字を描画する領域をまず背景色でクリアし、その上に文字を描画
-        _drawingCanvas->setTextColor(_textColor, _bgColor); 
-        _drawingCanvas->fillRect(x, y, sub.length() * _fontWidth, _fontHeight, _bgColor);
-        _drawingCanvas->drawString(sub, x, y);
+        setText(row, col, text.c_str());
     }
-    
+
     /**
-     * @brief 指定した行・列に文字列を描画します (const char*版)
-     * @param row 描画を開始する行 (0から始まるインデックス)
-     * @param col 描画を開始する列 (0から始まるインデックス)
-     * @param text 描画するCスタイル文字列
+     * @brief 指定した行・列に文字列を書き込みます (const char*版)
+     * @param row 書き込みを開始する行 (0から始まるインデックス)
+     * @param col 書き込みを開始する列 (0から始まるインデックス)
+     * @param text 書き込むCスタイル文字列
      */
     void setText(int row, int col, const char* text) {
-        setText(row, col, String(text));
+        if (row < 0 || row >= _rows || col < 0 || col >= _cols || !text) return;
+        const uint8_t attr = _currentAttr();
+        Cell* cell = &_cells[(size_t)row * _cols + col];
+        for (int c = col; c < _cols && *text; ++c, ++text) { // 行末を超える分は切り詰める
+            cell->ch = *text;
+            cell->attr = attr;
+            ++cell;
+        }
+        _rowDirty[row] = 1;
     }
 
     /**
@@ -210,97 +217,154 @@ public:
     }
 
     /**
-     * @brief 現在のカーソル位置から文字列を印字します (Arduino Printクラス互換)
+     * @brief 現在のカーソル位置から、長さを指定した文字列を印字します
      *
      * 改行コード('\\n')や行末での自動改行 (setLineWrapで設定可能) に対応します
-     * 描画は内部の描画キャンバスに対して行われ、show()が呼び出されるまで画面には反映されません
+     * 書き込みは文字グリッドに対して行われ、show()が呼び出されるまで画面には反映されません
+     * 文字列は終端されている必要がないため、部分文字列もコピーせずに印字できます (string_viewと同様)
      *
-     * @param text 印字する文字列 (Stringオブジェクト)
+     * @param text 印字する文字列の先頭
+     * @param len 印字する文字数
      * @return 印字された文字数
      */
-    size_t print(const String& text) {
-        if (!_drawingCanvas) return 0; // 描画キャンバスがなければ何もしない
-        _drawingCanvas->setTextColor(_textColor); // 文字色を設定 (背景色は指定しないモード)
-        _drawingCanvas->setTextDatum(TL_DATUM);   // 左上基準で文字を描画
+    size_t print(const char* text, size_t len) {
         size_t n = 0; // 印字した文字数をカウント
-        for (unsigned int i = 0; i < text.length(); ++i) {
-            char c = text.charAt(i);
-            if (_printChar(c)) { // 内部メソッドで1文字ずつ処理
+        for (size_t i = 0; i < len; ++i) {
+            if (_printChar(text[i])) { // 内部メソッドで1文字ずつ処理
                 n++;
-            } else {
-                break; // _printCharがfalseを返したら (画面外など)、ループを抜ける
+            } else if (_printCursorRow >= _rows) {
+                break; // 画面外に出たら、ループを抜ける
             }
+            // 行ラップ無効で行末に達した場合は、次の改行までの文字を読み飛ばす
         }
         return n;
     }
 
+    /**
+     * @brief 現在のカーソル位置から文字列を印字します (Arduino Printクラス互換)
+     * @param text 印字する文字列 (Stringオブジェクト)
+     * @return 印字された文字数
+     */
+    size_t print(const String& text) { return print(text.c_str(), text.length()); }
     /** @brief 現在のカーソル位置から文字列を印字します (const char*版) @copydoc print(const String&) */
-    size_t print(const char* text) { return print(String(text)); }
+    size_t print(const char* text) { return text ? print(text, strlen(text)) : 0; }
     /** @brief 現在のカーソル位置から1文字を印字します @copydoc print(const String&) */
-    size_t print(char c) { if(!_drawingCanvas) return 0; return _printChar(c) ? 1 : 0; }
+    size_t print(char c) { return _printChar(c) ? 1 : 0; }
     /** @brief 現在のカーソル位置から整数を印字します @copydoc print(const String&) */
-    size_t print(int val, int base = DEC) { return print(String(val, base)); }
+    size_t print(int val, int base = DEC) {
+        char buf[34]; // 2進数の32桁 + 符号 + 終端
+        return print(buf, _formatInt(buf, sizeof(buf), val, base));
+    }
     /** @brief 現在のカーソル位置から浮動小数点数を印字します @copydoc print(const String&) */
-    size_t print(double val, int decimalPlaces = 2) { return print(String(val, decimalPlaces)); }
+    size_t print(double val, int decimalPlaces = 2) {
+        char buf[32];
+        return print(buf, _formatResultLength(snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, val), sizeof(buf)));
+    }
 
     /**
-     * @brief 現在のカーソル位置から文字列を印字し、最後に改行します (Arduino Printクラス互換)
-     * @param text 印字する文字列 (Stringオブジェクト)
-     * @return 印字された文字数 (改行文字も含む)
+     * @brief 現在のカーソル位置から、書式を指定して印字します (printf互換)
+     * @details スタック上のバッファ (PRINTF_BUFFER_SIZE バイト) へ書式化してから印字するため、ヒープを使いません
+     *          バッファに収まらない部分は切り捨てます
+     * @param format 書式文字列
+     * @return 印字された文字数
+     */
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[PRINTF_BUFFER_SIZE];
+        va_list args;
+        va_start(args, format);
+        const int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return print(buf, _formatResultLength(len, sizeof(buf)));
+    }
+
+    /**
+     * @brief 現在のカーソル位置から、同じ文字を指定した数だけ印字します
+     * @param c 印字する文字
+     * @param count 印字する数 (0以下の場合は何もしない)
+     * @return 印字された文字数
      */
-    size_t println(const String& text) {
-        size_t n = print(text);
-        if (_printChar('\n')) { // 改行文字を処理
-             n++; // 改行も1文字としてカウント
+    size_t printRepeat(char c, int count) {
+        size_t n = 0;
+        for (int i = 0; i < count && _printChar(c); ++i) {
+            n++;
         }
         return n;
     }
 
+    /**
+     * @brief 現在のカーソル位置から文字列を印字し、最後に改行します (Arduino Printクラス互換)
+     * @param text 印字する文字列 (Stringオブジェクト)
+     * @return 印字された文字数 (改行文字も含む)
+     */
+    size_t println(const String& text) { return print(text) + println(); }
+
+    /** @brief 現在のカーソル位置から長さを指定した文字列を印字し、最後に改行します @copydoc println(const String&) */
+    size_t println(const char* text, size_t len) { return print(text, len) + println(); }
     /** @brief 現在のカーソル位置から文字列を印字し、最後に改行します (const char*版) @copydoc println(const String&) */
-    size_t println(const char* text) { return println(String(text)); }
+    size_t println(const char* text) { return print(text) + println(); }
     /** @brief 現在のカーソル位置から1文字を印字し、最後に改行します @copydoc println(const String&) */
-    size_t println(char c) { return println(String(c));}
+    size_t println(char c) { return print(c) + println(); }
     /** @brief 現在のカーソル位置から整数を印字し、最後に改行します @copydoc println(const String&) */
-    size_t println(int val, int base = DEC) { return println(String(val, base)); }
+    size_t println(int val, int base = DEC) { return print(val, base) + println(); }
     /** @brief 現在のカーソル位置から浮動小数点数を印字し、最後に改行します @copydoc println(const String&) */
-    size_t println(double val, int decimalPlaces = 2) { return println(String(val, decimalPlaces)); }
+    size_t println(double val, int decimalPlaces = 2) { return print(val, decimalPlaces) + println(); }
     /** @brief 現在のカーソル位置から改行のみ行います @copydoc println(const String&) */
     size_t println() { return _printChar('\n') ? 1 : 0; }
 
     /**
-     * @brief 描画キャンバスの内容をLCDに表示し、バッファを切り替えます
-     *
-     * 具体的には、現在の描画キャンバス (_drawingCanvas) の内容を物理LCDに転送し、
-     * その後、アクティブキャンバス (_activeCanvas) と描画キャンバスの役割を入れ替えます
-     * 新しい描画キャンバス (元のアクティブキャンバス) には、古い描画キャンバスの内容がコピーされます
-     * これにより、次のフレームの描画をスムーズに開始できます
+     * @brief 文字グリッドのうち、前回表示した内容から変わった部分だけをLCDに表示します
      *
-     * @note M5GFXのpushSpriteは、コピー元スプライトの内容をコピー先スプライトに上書きコピーする
-     *       1. _drawingCanvas を LCD にプッシュ (表示)
-     *       2. _activeCanvas と _drawingCanvas のポインタをスワップ
-     *       3. 新しい _drawingCanvas (元 _activeCanvas) に、新しい _activeCanvas (元 _drawingCanvas) の内容をコピー
-     *          これにより、次のフレームで差分描画や継続描画が容易になる
+     * ダーティな行ごとに、文字グリッドを前回表示したグリッド (_presentedCells) と文字セル単位で比較し、
+     * 変わった行だけをストリップバッファへ描画してLCDへDMA転送します
+     * ストリップは交互に使うため、ある行の転送中に次の行の描画が進みます
+     * 文字グリッドの内容はそのまま残るため、次のフレームも表示中の内容から継続して書き込めます
      */
     void show() {
-        if (!_drawingCanvas || !_activeCanvas) return; // キャンバスがなければ何もしない
-        // 1. 現在の描画キャンバスの内容をLCDに表示
-        _drawingCanvas->pushSprite(0, 0);
-        // 2. アクティブキャンバスと描画キャンバスの役割をスワップ
-        M5Canvas* temp = _activeCanvas;
-        _activeCanvas = _drawingCanvas;
-        _drawingCanvas = temp;
-        // 3. 新しい描画キャンバス (元々のアクティブキャンバスだったもの) に、
-        //    新しいアクティブキャンバス (元々の描画キャンバスだったもの、つまり表示された内容) の内容をコピーします
-        //    これにより、次の描画サイクルで、表示されている内容から継続して変更を加えることができます
-        if (_drawingCanvas && _activeCanvas) { // 両方が有効な場合のみコピー
-            _activeCanvas->pushSprite(_drawingCanvas, 0, 0);
+        if (!_stripsReady || _rows <= 0) return; // ストリップがなければ何もしない
+        const uint32_t start_us = micros();
+        _lcd.startWrite(); // 複数行の転送の間、バスを保持する
+        for (int row = 0; row < _rows; ++row) {
+            if (!_fullPushPending && !_rowDirty[row]) {
+                _frameStats.rowsClean++;
+                continue;
+            }
+            if (!_fullPushPending && !_rowChanged(row)) {
+                _frameStats.rowsUnchanged++;
+                continue;
+            }
+            _pushRow(row);
+            _frameStats.rowsPushed++;
+        }
+        if (_fullPushPending) {
+            // 行に満たない画面下端の余りは背景色で塗りつぶす
+            const int y = _rows * _fontHeight;
+            if (y < _screenHeight) {
+                _lcd.waitDMA();
+                _lcd.fillRect(0, y, _screenWidth, _screenHeight - y, _bgColor);
+            }
         }
-        // 新しい描画キャンバスのM5Canvas内部カーソルをリセット (ピクセル単位のカーソル)
-        if (_drawingCanvas) {
-            _drawingCanvas->setCursor(0,0); 
+        _lcd.waitDMA(); // 最後のストリップの転送完了を待つ
+        _lcd.endWrite();
+        std::fill(_rowDirty.begin(), _rowDirty.end(), 0);
+        _fullPushPending = false;
+        _frameStats.frames++;
+        _frameStats.lastShowUs = micros() - start_us;
+        if (_frameStats.lastShowUs > _frameStats.maxShowUs) {
+            _frameStats.maxShowUs = _frameStats.lastShowUs;
         }
     }
 
+    /**
+     * @brief show() の転送コストの統計情報を取得します
+     * @return 統計情報 (resetFrameStats() からの累計)
+     */
+    const FrameStats& getFrameStats() const { return _frameStats; }
+
+    /**
+     * @brief show() の転送コストの統計情報をリセットします
+     */
+    void resetFrameStats() { _frameStats = FrameStats(); }
+
     /**
      * @brief print/printlnメソッド使用時の行末での自動改行を有効/無効にします
      * @param wrap trueで有効、falseで無効
@@ -310,9 +374,10 @@ public:
     }
 
     /**
-     * @brief 描画キャンバスの内容を現在の背景色でクリアし、カーソルをリセットします
+     * @brief 文字グリッドを空白 (現在の背景色) でクリアし、カーソルをリセットします
      *
      * この変更は show() が呼び出されるまで画面には反映されません
+     * 前回と同じ内容を書き直した文字セルは、show() で描画も転送もされません
      */
     void clearDrawingCanvas() {
         _clearAndResetDrawingCanvas();
@@ -321,8 +386,8 @@ public:
     /**
      * @brief 画面全体を指定された色で塗りつぶします
      *
-     * このメソッドは物理LCDだけでなく、内部の描画キャンバスとアクティブキャンバスも
-     * 指定色で塗りつぶし、背景色設定(_bgColor)も更新します
+     * このメソッドは物理LCDだけでなく、文字グリッドも
+     * 指定色でクリアし、背景色設定(_bgColor)も更新します
      * print/printlnカーソルもリセットされます
      * この変更は即座にLCDに反映されます
      *
@@ -330,21 +395,24 @@ public:
      */
     void fillScreen(uint16_t color) {
         _bgColor = color; // 新しい背景色を保存
+        _lcd.waitDMA();
         _lcd.fillScreen(_bgColor); // 物理LCDを塗りつぶし
-        // 内部キャンバスも新しい背景色で塗りつぶし
-        if (_drawingCanvas) _drawingCanvas->fillSprite(_bgColor);
-        if (_activeCanvas) _activeCanvas->fillSprite(_bgColor);
-        // print/printlnカーソルとM5Canvasのピクセルカーソルをリセット
+        // LCDと文字グリッドの内容が一致したので、転送待ちの行はない
+        const Cell blank(' ', _currentAttr());
+        std::fill(_cells.begin(), _cells.end(), blank);
+        std::fill(_presentedCells.begin(), _presentedCells.end(), blank);
+        std::fill(_rowDirty.begin(), _rowDirty.end(), 0);
+        _fullPushPending = false;
+        // print/printlnカーソルをリセット
         _printCursorRow = 0;
         _printCursorCol = 0;
-        if (_drawingCanvas) _drawingCanvas->setCursor(0,0);
     }
 
     /**
      * @brief 画面全体を現在の背景色 (_bgColor) で塗りつぶします
      *
      * この変更は即座にLCDに反映されます
-     * 内部キャンバスもクリアされ、カーソルもリセットされます
+     * 文字グリッドもクリアされ、カーソルもリセットされます
      */
     void fillScreen() {
         fillScreen(_bgColor);
@@ -367,7 +435,7 @@ public:
     void setBgColor(uint16_t color) {
         _bgColor = color;
     }
-    
+
     /** @brief 現在の画面設定での最大行数を取得します @return 行数 */
     int getRows() const { return _rows; }
     /** @brief 現在の画面設定での最大列数を取得します @return 列数 */
@@ -381,12 +449,89 @@ public:
     /** @brief 現在の画面回転設定を取得します @return 回転設定値 (0-3) */
     uint8_t getRotation() const { return _lcd.getRotation(); }
 
+    /**
+     * @brief グリフキャッシュを使うかどうかを設定します
+     * @param enabled trueでグリフキャッシュを使う (デフォルト)、falseで1文字ずつdrawCharで描画する
+     */
+    void setGlyphCacheEnabled(bool enabled) { _glyphCacheEnabled = enabled; }
+
+    /**
+     * @brief 1行分の描画 (ストリップへのラスタライズ) の速度を測定します
+     *
+     * 文字グリッドの内容には触れず、ASCII文字で埋めた1行を繰り返しストリップへ描画します (LCDへの転送は含みません)
+     * 測定後は次の show() で画面全体を描画し直します
+     *
+     * @param use_glyph_cache trueでグリフキャッシュ、falseでdrawCharの経路で描画する
+     * @param rows 描画する行数
+     * @return 1秒あたりの描画文字数。ストリップがない場合は0
+     */
+    uint32_t benchmarkRaster(bool use_glyph_cache, uint32_t rows) {
+        if (!_stripsReady || _cols <= 0 || rows == 0) return 0;
+        _lcd.waitDMA(); // 転送中のストリップには描画しない
+        std::vector<Cell> line(_cols);
+        const uint8_t attr = _currentAttr();
+        for (int col = 0; col < _cols; ++col) {
+            line[col] = Cell((char)(GLYPH_FIRST + col % GLYPH_COUNT), attr);
+        }
+        const bool saved = _glyphCacheEnabled;
+        _glyphCacheEnabled = use_glyph_cache;
+        const uint32_t start_us = micros();
+        for (uint32_t i = 0; i < rows; ++i) {
+            _rasterRow(_strips[i % STRIP_COUNT], line.data());
+        }
+        const uint32_t elapsed_us = micros() - start_us;
+        _glyphCacheEnabled = saved;
+        _fullPushPending = true; // ストリップの内容を上書きしたため
+        if (elapsed_us == 0) return 0;
+        return (uint32_t)((uint64_t)rows * _cols * 1000000ULL / elapsed_us);
+    }
+
 private:
+    /**
+     * @struct Cell
+     * @brief 文字グリッドの1文字セル
+     * @note 色は (文字色, 背景色) の組をパレット (_palette) に登録し、その番号 (attr) で保持します
+     */
+    struct Cell {
+        char ch;      ///< 文字
+        uint8_t attr; ///< 色属性 (_palette のインデックス)
+        Cell(char c = ' ', uint8_t a = 0) : ch(c), attr(a) {}
+        bool operator==(const Cell& other) const { return ch == other.ch && attr == other.attr; }
+        bool operator!=(const Cell& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @struct ColorPair
+     * @brief 色属性パレットの1エントリ
+     */
+    struct ColorPair {
+        uint16_t fg; ///< 文字色
+        uint16_t bg; ///< 背景色
+    };
+
+    static const size_t MAX_PALETTE_SIZE = 255; ///< 色属性パレットの最大エントリ数
+
+    static const int STRIP_COUNT = 2;           ///< ストリップバッファの本数 (描画とDMA転送を交互に行う)
+    static const size_t PRINTF_BUFFER_SIZE = 128; ///< printf() の書式化に使うスタック上のバッファの大きさ
+    static const char GLYPH_FIRST = 0x20;       ///< グリフキャッシュの先頭の文字 (空白)
+    static const int GLYPH_COUNT = 0x7F - 0x20; ///< グリフキャッシュの文字数 (印字可能なASCII文字)
+    static const int GLYPH_MAX_WIDTH = 32;      ///< グリフキャッシュを使える文字幅の上限 (1行を uint32_t で持つため)
+
     M5GFX& _lcd;                  ///< M5GFX (M5Display) オブジェクトへの参照
-    M5Canvas* _canvas1;           ///< ダブルバッファリング用キャンバス1
-    M5Canvas* _canvas2;           ///< ダブルバッファリング用キャンバス2
-    M5Canvas* _activeCanvas;      ///< 現在LCDに表示されている内容を保持するキャンバス (表示バッファ)
-    M5Canvas* _drawingCanvas;     ///< 次に表示する内容を描画するためのキャンバス (描画バッファ)
+    M5Canvas* _strips[STRIP_COUNT] = {}; ///< 1行分 (画面幅 x 文字の高さ) のストリップバッファ
+    int _nextStrip = 0;           ///< 次に描画するストリップの番号
+    bool _stripsReady = false;    ///< ストリップバッファが確保されているか
+    int _screenWidth = 0;         ///< 画面の幅 (ピクセル)
+    int _screenHeight = 0;        ///< 画面の高さ (ピクセル)
+
+    std::vector<Cell> _cells;          ///< 次に表示する文字グリッド (_rows x _cols)
+    std::vector<Cell> _presentedCells; ///< 前回 show() で表示した文字グリッド
+    std::vector<ColorPair> _palette;   ///< 色属性パレット (登録された色の組は変更しない)
+    std::vector<uint8_t> _rowDirty;    ///< 行ごとのダーティフラグ (書き込みのあった行)
+    bool _fullPushPending = true;      ///< 次の show() で全体を描画し直して転送するかどうか
+    FrameStats _frameStats;            ///< show() の転送コストの統計情報
+    std::vector<uint32_t> _glyphMasks; ///< グリフキャッシュ (GLYPH_COUNT x _fontHeight 行、左端の画素が上位bit)
+    bool _glyphCacheEnabled = true;    ///< グリフキャッシュを使うかどうか
 
     int _rows = 0;                ///< 現在のフォントサイズと画面寸法での最大表示行数
     int _cols = 0;                ///< 現在のフォントサイズと画面寸法での最大表示列数
@@ -400,123 +545,232 @@ private:
     int _printCursorCol = 0;      ///< print/println用カーソルの現在列
 
     /**
-     * @brief 既存のキャンバスのスプライトメモリを解放します
-     * @note M5Canvasオブジェクト自体はdeleteしません。スプライトのメモリのみを解放します
-     *       オブジェクトのdeleteはデストラクタで行います
+     * @brief 現在の文字色・背景色の組に対応する色属性を取得します
+     * @details 未登録の組はパレットに追加します。パレットが一杯の場合は0番を返します
+     * @return 色属性 (_palette のインデックス)
+     */
+    uint8_t _currentAttr() {
+        for (size_t i = 0; i < _palette.size(); ++i) {
+            if (_palette[i].fg == _textColor && _palette[i].bg == _bgColor) {
+                return (uint8_t)i;
+            }
+        }
+        if (_palette.size() >= MAX_PALETTE_SIZE) {
+            return 0;
+        }
+        _palette.push_back(ColorPair{_textColor, _bgColor});
+        return (uint8_t)(_palette.size() - 1);
+    }
+
+    /**
+     * @brief 1行分の文字グリッドが前回表示した内容から変わったかどうかを調べます
+     * @param row 行 (0から始まるインデックス)
+     * @return 1つでも文字セルが変わっていれば true
+     */
+    bool _rowChanged(int row) const {
+        const size_t base = (size_t)row * _cols;
+        return !std::equal(_cells.begin() + base, _cells.begin() + base + _cols, _presentedCells.begin() + base);
+    }
+
+    /**
+     * @brief 1行分の文字グリッドをストリップバッファへ描画し、LCDへDMA転送します
+     * @details 前の行の転送が終わるのを待ってから転送を開始するため、
+     *          転送中のストリップに次の行を描画することはありません (2本を交互に使う)
+     * @param row 行 (0から始まるインデックス)
+     */
+    void _pushRow(int row) {
+        M5Canvas* strip = _strips[_nextStrip];
+        _nextStrip = (_nextStrip + 1) % STRIP_COUNT;
+        const size_t base = (size_t)row * _cols;
+        _rasterRow(strip, &_cells[base]);
+        std::copy(_cells.begin() + base, _cells.begin() + base + _cols, _presentedCells.begin() + base);
+        _frameStats.cellsDrawn += _cols;
+        // スプライトのバッファはバイトスワップ済みのRGB565なので、swap565_tとしてそのまま転送する
+        _lcd.waitDMA();
+        _lcd.pushImageDMA(0, row * _fontHeight, _screenWidth, _fontHeight,
+                          static_cast<const lgfx::swap565_t*>(strip->getBuffer()));
+        _frameStats.bytesPushed += (uint32_t)_screenWidth * _fontHeight * sizeof(uint16_t);
+    }
+
+    /**
+     * @brief 1行分の文字セルをストリップバッファへ描画します
+     * @details グリフキャッシュにある文字はマスクから直接バッファへ書き込み、それ以外の文字はdrawCharで描画します
+     * @param strip 描画先のストリップ
+     * @param cells 1行分 (_cols 個) の文字セル
+     */
+    void _rasterRow(M5Canvas* strip, const Cell* cells) {
+        uint16_t* buf = static_cast<uint16_t*>(strip->getBuffer());
+        const bool use_cache = _glyphCacheEnabled && !_glyphMasks.empty();
+        for (int col = 0; col < _cols; ++col) {
+            const Cell& cell = cells[col];
+            const ColorPair& colors = _palette[cell.attr];
+            const int x = col * _fontWidth;
+            const int glyph = (uint8_t)cell.ch - (uint8_t)GLYPH_FIRST;
+            if (use_cache && glyph >= 0 && glyph < GLYPH_COUNT) {
+                _blitGlyph(buf + x, &_glyphMasks[(size_t)glyph * _fontHeight],
+                           _swap565(colors.fg), _swap565(colors.bg));
+                continue;
+            }
+            strip->fillRect(x, 0, _fontWidth, _fontHeight, colors.bg);
+            if (cell.ch != ' ') {
+                strip->setTextColor(colors.fg); // 背景は塗りつぶし済みなので透過で描く
+                strip->drawChar(cell.ch, x, 0, strip->getTextFont());
+            }
+        }
+        const int text_width = _cols * _fontWidth;
+        if (text_width < _screenWidth) { // 列に満たない右端の余り
+            strip->fillRect(text_width, 0, _screenWidth - text_width, _fontHeight, _bgColor);
+        }
+    }
+
+    /**
+     * @brief 1文字分のマスクを、文字色と背景色でストリップのバッファへ書き込みます
+     * @param dst 書き込み先 (文字セルの左上の画素)
+     * @param mask 文字の各行のマスク (_fontHeight 行)
+     * @param fg バイトスワップ済みの文字色
+     * @param bg バイトスワップ済みの背景色
      */
-    void _deleteCanvases() {
-        if (_canvas1) {
-            _canvas1->deleteSprite(); // スプライトメモリを解放
+    void _blitGlyph(uint16_t* dst, const uint32_t* mask, uint16_t fg, uint16_t bg) const {
+        const uint32_t left_bit = 1UL << (_fontWidth - 1);
+        for (int y = 0; y < _fontHeight; ++y) {
+            uint32_t bits = mask[y];
+            for (int x = 0; x < _fontWidth; ++x) {
+                dst[x] = (bits & left_bit) ? fg : bg;
+                bits <<= 1;
+            }
+            dst += _screenWidth; // ストリップの1ライン分進める
         }
-        if (_canvas2) {
-            _canvas2->deleteSprite(); // スプライトメモリを解放
+    }
+
+    /**
+     * @brief RGB565の色をスプライトのバッファ上の並び (バイトスワップ) に変換します
+     * @param color RGB565の色
+     * @return バイトスワップした色
+     */
+    static uint16_t _swap565(uint16_t color) {
+        return (uint16_t)((color << 8) | (color >> 8));
+    }
+
+    /**
+     * @brief 現在のフォントとサイズで、印字可能なASCII文字のマスクを作成します
+     * @details ストリップを作業領域にしてdrawCharで描画し、描かれた画素を1bitのマスクとして取り出します
+     *          色はマスクにせず書き込み時に与えるため、文字色・背景色を変えても作り直す必要はありません
+     *          文字幅が GLYPH_MAX_WIDTH を超える場合はキャッシュを作らず、drawCharで描画します
+     */
+    void _buildGlyphCache() {
+        _glyphMasks.clear();
+        if (!_stripsReady || _fontWidth > GLYPH_MAX_WIDTH || _screenWidth < _fontWidth) return;
+        _glyphMasks.assign((size_t)GLYPH_COUNT * _fontHeight, 0);
+        M5Canvas* work = _strips[0];
+        const uint16_t* buf = static_cast<const uint16_t*>(work->getBuffer());
+        const int per_pass = _screenWidth / _fontWidth; // ストリップ1本に並べられる文字数
+        work->setTextColor(0xFFFF);
+        for (int first = 0; first < GLYPH_COUNT; first += per_pass) {
+            const int count = std::min(per_pass, GLYPH_COUNT - first);
+            work->fillSprite(0);
+            for (int i = 0; i < count; ++i) {
+                work->drawChar((char)(GLYPH_FIRST + first + i), i * _fontWidth, 0, work->getTextFont());
+            }
+            for (int i = 0; i < count; ++i) {
+                uint32_t* mask = &_glyphMasks[(size_t)(first + i) * _fontHeight];
+                for (int y = 0; y < _fontHeight; ++y) {
+                    const uint16_t* line = buf + (size_t)y * _screenWidth + i * _fontWidth;
+                    uint32_t bits = 0;
+                    for (int x = 0; x < _fontWidth; ++x) {
+                        bits = (bits << 1) | (line[x] != 0 ? 1 : 0);
+                    }
+                    mask[y] = bits;
+                }
+            }
         }
-        // ポインタをnullptrにはしません。オブジェクトは再利用されるためです
+        Serial.printf("_buildGlyphCache: %d glyphs of %d x %d (%u bytes)\n", GLYPH_COUNT, _fontWidth, _fontHeight,
+                      (unsigned)(_glyphMasks.size() * sizeof(uint32_t)));
     }
-    
+
     /**
-     * @brief LCDの現在の幅と高さに合わせて、2つのキャンバスのスプライトを再作成します
+     * @brief 画面の幅と現在の文字の高さに合わせて、ストリップバッファを再作成します
      *
      * 既存のスプライトは解放され、新しいサイズのものが確保されます
-     * 高さは、現在のヒープから計算された値が指定される
-     * 作成後、_drawingCanvas と _activeCanvas に適切に割り当てられ、
-     * 描画キャンバスはクリアされ、アクティブキャンバスも背景色で塗りつぶされます
+     * スプライトのメモリはDMA転送可能な内部RAMから確保されます
      *
-     * @return キャンバスの再作成に成功した場合は true、失敗した場合は false
-     */
-    bool _recreateCanvases() {
-        _deleteCanvases(); // 既存のキャンバススプライトを解放 (メモリリーク防止)
-        // M5Canvasオブジェクト (_canvas1, _canvas2) はコンストラクタでnewされている前提です
-        // ここでは、それらのオブジェクトに対してスプライトを作成します
-        int original_w = _lcd.width();
-        int original_h = _lcd.height();
-        int w = original_w; // 幅はLCDに合わせる前提
-        int h = original_h; // まずはLCDの高さで試す
-        const int bytes_per_pixel = 2; // RGB565の場合
-        const int num_canvases = 2;    // ダブルバッファリング
-        const size_t safety_margin = 1024 * 10; // 10KB程度の安全マージン (調整が必要)
-        Serial.printf("_recreateCanvases: Original LCD w=%d, h=%d\n", original_w, original_h);
-        // 利用可能な最大の連続メモリブロックを取得
-        size_t largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
-        Serial.printf("_recreateCanvases: Largest free block: %u bytes\n", largest_free_block);
-        // 必要な総メモリ量 (マージン込み)
-        size_t required_memory_for_full_height = (size_t)w * h * bytes_per_pixel * num_canvases + safety_margin;
-        Serial.printf("_recreateCanvases: Required memory for full height (%d x %d x %d canvases) + margin: %u bytes\n", w, h, num_canvases, required_memory_for_full_height);
-        if (largest_free_block < required_memory_for_full_height) {
-            Serial.println("_recreateCanvases: Not enough memory for full height canvases. Attempting to calculate reduced height.");
-            // マージンを引いた、キャンバス2枚で利用できる最大メモリ
-            size_t available_for_canvases = (largest_free_block > safety_margin) ? (largest_free_block - safety_margin) : 0;
-            if (available_for_canvases > 0) {
-                // 1枚のキャンバスあたりで利用できる最大メモリ
-                size_t memory_per_canvas = available_for_canvases / num_canvases;
-                // 計算上の最大高さ
-                int calculated_h = memory_per_canvas / (w * bytes_per_pixel);
-                Serial.printf("_recreateCanvases: Available for canvases: %u, Memory per canvas: %u, Calculated h: %d\n",
-                              available_for_canvases, memory_per_canvas, calculated_h);
-                if (calculated_h > 0) {
-                    h = calculated_h;
-                    // 高さはある程度の単位（例：フォントの高さの倍数など）に丸めることも検討できる
-                    // h = (h / _fontHeight) * _fontHeight; // もし_fontHeightがこの時点で確定していれば
-                    Serial.printf("_recreateCanvases: Reducing canvas height to: %d\n", h);
-                } else {
-                    Serial.println("_recreateCanvases: Calculated height is 0 or less. Canvas creation will likely fail.");
-                    h = 0; // 非常に小さい値、またはエラーとして扱う
+     * @return ストリップバッファの再作成に成功した場合は true、失敗した場合は false
+     */
+    bool _recreateStrips() {
+        _lcd.waitDMA(); // 転送中のストリップを解放しないように待つ
+        _stripsReady = false;
+        _nextStrip = 0;
+        for (int i = 0; i < STRIP_COUNT; ++i) {
+            _strips[i]->deleteSprite(); // 既存のスプライトを解放 (メモリリーク防止)
+        }
+        const int w = _screenWidth;
+        const int h = _fontHeight;
+        for (int i = 0; i < STRIP_COUNT; ++i) {
+            if (!_strips[i]->createSprite(w, h)) {
+                Serial.printf("Error: Failed to create strip buffer %d (%d x %d)\n", i, w, h);
+                for (int j = 0; j < i; ++j) {
+                    _strips[j]->deleteSprite();
                 }
-            } else {
-                Serial.println("_recreateCanvases: Not enough memory even after safety margin. Canvas creation will likely fail.");
-                h = 0;
+                return false;
             }
         }
-        if (h <= 0) { // 高さが無効な場合は失敗とする
-            Serial.println("Error: Calculated canvas height is invalid.");
-            return false;
-        }
-        Serial.printf("Attempting to create canvases with w=%d, h=%d\n", w, h);
-        if (!_canvas1 || !_canvas1->createSprite(w, h)) {
-            Serial.printf("Error: Failed to create canvas1 (%d x %d)\n", w, h);
-            return false;
-        }
-        if (!_canvas2 || !_canvas2->createSprite(w, h)) {
-            Serial.printf("Error: Failed to create canvas2 (%d x %d)\n", w, h);
-            if (_canvas1) _canvas1->deleteSprite();
-            return false;
-        }
-        _drawingCanvas = _canvas1;
-        _activeCanvas = _canvas2;
-        _clearAndResetDrawingCanvas();
-        if (_activeCanvas) _activeCanvas->fillSprite(_bgColor);
-        // ★重要: キャンバスサイズが変わったので、行数・列数も再計算する必要がある
-        // setTextSize内で _rows, _cols が再計算されるが、
-        // その際の _lcd.height() は物理LCDの高さを使う。
-        // しかし、我々のキャンバスはそれより小さいかもしれない。
-        // このクラスの設計では、_rows, _cols は _lcd.height()/_fontHeight を基準にしているので、
-        // この動的な高さ変更とどう整合性を取るかは慎重な設計が必要。
-        // 一つの方法は、このクラスで扱う「仮想的な画面の高さ」を動的に変更したhに合わせること。
-        // ただし、M5GFXの他の機能との兼ね合いも出てくる。
-        //
-        // ここでは、ひとまず _rows の計算に影響を与えず、
-        // setTextSize が物理LCDサイズベースで計算する前提のままにする。
-        // 表示がキャンバスの下にはみ出る可能性は、printやsetTextのロジックで
-        // 描画先キャンバスの実際の高さ (h) を超えないようにクリッピングする必要が出てくる。
-        // または、_rows を h / _fontHeight で上書きする。
-        // current_canvas_height = h; // メンバ変数で保持など
+        Serial.printf("_recreateStrips: %d strips of %d x %d (%u bytes)\n",
+                      STRIP_COUNT, w, h, (unsigned)(STRIP_COUNT * w * h * sizeof(uint16_t)));
+        _stripsReady = true;
+        _fullPushPending = true; // LCDの内容は文字グリッドと一致していない
         return true;
     }
 
     /**
-     * @brief 描画キャンバス (_drawingCanvas) を現在の背景色でクリアし、
-     *        print/println用の文字カーソルとM5Canvasのピクセルカーソルをリセットします
+     * @brief 文字グリッドを空白 (現在の背景色) でクリアし、print/println用の文字カーソルをリセットします
      */
     void _clearAndResetDrawingCanvas() {
-        if (!_drawingCanvas) return;
-        _drawingCanvas->fillSprite(_bgColor);
-        _drawingCanvas->setCursor(0,0); // M5Canvasのピクセル単位のカーソルを左上に
+        const Cell blank(' ', _currentAttr());
+        std::fill(_cells.begin(), _cells.end(), blank);
+        std::fill(_rowDirty.begin(), _rowDirty.end(), 1); // 全行が変わった可能性がある
         _printCursorRow = 0;            // 文字グリッドベースのカーソル行を0に
         _printCursorCol = 0;            // 文字グリッドベースのカーソル列を0に
     }
 
     /**
-     * @brief print/printlnメソッドの内部処理として、1文字を描画キャンバスに印字します
+     * @brief 整数を指定した基数の文字列へ変換します
+     * @details 10進数以外では、負の値は2の補数の符号なし整数として表します (Arduino Stringと同じ)
+     * @param buf 書き込み先のバッファ
+     * @param size バッファの大きさ (34バイトあれば足りる)
+     * @param val 変換する値
+     * @param base 基数 (2～36。範囲外の場合は10)
+     * @return 変換した文字数
+     */
+    static size_t _formatInt(char* buf, size_t size, int val, int base) {
+        if (base < 2 || base > 36) base = DEC;
+        const bool negative = (base == DEC && val < 0);
+        uint32_t u = negative ? 0U - (uint32_t)val : (uint32_t)val;
+        char digits[33];
+        size_t n = 0;
+        do {
+            const uint32_t d = u % base;
+            digits[n++] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+            u /= base;
+        } while (u != 0 && n < sizeof(digits));
+        size_t len = 0;
+        if (negative && len + 1 < size) buf[len++] = '-';
+        while (n > 0 && len + 1 < size) buf[len++] = digits[--n];
+        buf[len] = '\0';
+        return len;
+    }
+
+    /**
+     * @brief snprintf/vsnprintf の戻り値を、実際にバッファへ書き込まれた文字数に直します
+     * @param result snprintf/vsnprintf の戻り値
+     * @param size バッファの大きさ
+     * @return バッファ内の文字数 (エラーの場合は0)
+     */
+    static size_t _formatResultLength(int result, size_t size) {
+        if (result < 0) return 0;
+        return (size_t)result < size ? (size_t)result : size - 1;
+    }
+
+    /**
+     * @brief print/printlnメソッドの内部処理として、1文字を文字グリッドに書き込みます
      *
      * 改行コード('\\n')の処理、行末での自動改行 (設定されている場合)、画面範囲外のチェックを行います
      *
@@ -524,18 +778,14 @@ private:
      * @return 文字の印字に成功した場合は true、画面外などで印字できなかった場合は false
      */
     bool _printChar(char c) {
-        if (!_drawingCanvas) return false; // 描画キャンバスがない
-        // 現在のカーソル行が画面の最大行数を超えているか、またはちょうど最大行数だが改行しようとしている場合は失敗
+        // 現在のカーソル行が画面の最大行数を超えている場合は失敗
         if (_printCursorRow >= _rows) {
             return false;
         }
-        _drawingCanvas->setTextColor(_textColor); // 文字色を設定 (print系では背景色は透過)
-        _drawingCanvas->setTextDatum(TL_DATUM);   // 左上基準で文字を描画 (M5GFXのdrawString/drawCharのデフォルト)
         if (c == '\n') { // 改行文字の場合
             _printCursorRow++;    // 次の行へ
             _printCursorCol = 0;  // 行頭へ
             if (_printCursorRow >= _rows) { // 改行した結果、画面外になった場合
-                // _printCursorRow = _rows; // カーソル位置を最終行に留めるか、超えたままにするか。ここでは超えたまま
                 return false; // これ以上印字できない
             }
             return true; // 改行成功
@@ -546,21 +796,16 @@ private:
                 _printCursorRow++;    // 次の行へ
                 _printCursorCol = 0;  // 行頭へ
                 if (_printCursorRow >= _rows) { // 改行した結果、画面外になった場合
-                    // _printCursorRow = _rows;
                     return false; // これ以上印字できない
                 }
-                // 改行して新しい行に移動したので、再度この文字を処理するために再帰呼び出し...はせず、
-                // この後の処理で現在の_printCursorRow, _printCursorColを使って描画する
             } else { // 行ラップが無効な場合
                 return false; // これ以上印字できない
             }
         }
-        // 描画位置を計算 (文字グリッド座標からピクセル座標へ)
-        int x = _printCursorCol * _fontWidth;
-        int y = _printCursorRow * _fontHeight;
-        // M5CanvasのdrawCharを使って1文字描画
-        // drawCharは背景を透過して文字のみを描画する
-        _drawingCanvas->drawChar(c, x, y, _drawingCanvas->getTextFont()); // フォント指定は現在の設定を使用
+        Cell& cell = _cells[(size_t)_printCursorRow * _cols + _printCursorCol];
+        cell.ch = c;
+        cell.attr = _currentAttr();
+        _rowDirty[_printCursorRow] = 1;
         _printCursorCol++; // カーソルを1文字分進める
         return true; // 1文字印字成功
     }
@@ -0,0 +1,161 @@
+/**
+ * @file RIDBinaryExport.cpp
+ * @brief リモートID履歴のバイナリフレーム (COBS + CRC-16) エンコーダの実装ファイル
+ */
+#include "RIDBinaryExport.h"
+#include <cmath> // lround
+
+namespace {
+
+/// @brief CRC-16/CCITT-FALSE (多項式0x1021) の4bit単位テーブル
+const uint16_t CRC16_NIBBLE_TABLE[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/// @brief CRC-16/CCITT-FALSEを1バイト分更新します
+uint16_t _crc16Update(uint16_t crc, uint8_t b) {
+    crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[((crc >> 12) ^ (b >> 4)) & 0x0F];
+    crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[((crc >> 12) ^ (b & 0x0F)) & 0x0F];
+    return crc;
+}
+
+/// @brief 浮動小数点値をスケーリングして指定範囲の整数へ丸めます (NaNは0)
+/// @note floatのまま1e7倍すると仮数部が足りず最下位桁がずれるため、doubleで計算します
+long _scaleClamp(float value, double scale, long min_value, long max_value) {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    double scaled = (double)value * scale;
+    if (scaled <= (double)min_value) return min_value;
+    if (scaled >= (double)max_value) return max_value;
+    return lround(scaled);
+}
+
+} // namespace
+
+/**
+ * @brief コンストラクタ
+ * @param output_stream フレームの出力先ストリーム
+ */
+RIDCobsFrameWriter::RIDCobsFrameWriter(Print& output_stream)
+    : _out(output_stream), _blockLen(0), _crc(0xFFFF), _written(0) {
+}
+
+/**
+ * @brief フレームを開始します
+ * @details 先頭に区切り 0x00 を出力することで、受信側は直前に混ざったログ文字列などを破棄できます
+ */
+void RIDCobsFrameWriter::begin() {
+    _blockLen = 0;
+    _crc = 0xFFFF;
+    _written = _out.write((uint8_t)0x00);
+}
+
+/**
+ * @brief ペイロードのバイト列をフレームに追加します
+ * @param data 追加するデータ
+ * @param len データ長
+ */
+void RIDCobsFrameWriter::write(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        writeByte(data[i]);
+    }
+}
+
+/**
+ * @brief ペイロードに1バイト追加します
+ * @param b 追加するバイト
+ */
+void RIDCobsFrameWriter::writeByte(uint8_t b) {
+    _crc = _crc16Update(_crc, b);
+    _encodeByte(b);
+}
+
+/**
+ * @brief ペイロードに16bit値をリトルエンディアンで追加します
+ * @param value 追加する値
+ */
+void RIDCobsFrameWriter::writeUInt16(uint16_t value) {
+    writeByte((uint8_t)(value & 0xFF));
+    writeByte((uint8_t)(value >> 8));
+}
+
+/**
+ * @brief ペイロードに32bit値をリトルエンディアンで追加します
+ * @param value 追加する値
+ */
+void RIDCobsFrameWriter::writeUInt32(uint32_t value) {
+    writeUInt16((uint16_t)(value & 0xFFFF));
+    writeUInt16((uint16_t)(value >> 16));
+}
+
+/**
+ * @brief CRCを付けてフレームを終了します
+ * @details CRC自体はCRC計算に含めず、リトルエンディアンでペイロード末尾に付けます
+ * @return begin() からこのフレームで出力したバイト数 (区切りを含む)
+ */
+size_t RIDCobsFrameWriter::end() {
+    uint16_t crc = _crc;
+    _encodeByte((uint8_t)(crc & 0xFF));
+    _encodeByte((uint8_t)(crc >> 8));
+    _flushBlock(); // 最後のブロック (空でもコードバイト0x01を出力する)
+    _written += _out.write((uint8_t)0x00);
+    return _written;
+}
+
+/**
+ * @brief CRCを更新せずにCOBSエンコーダへ1バイト渡します
+ * @details 0x00 はブロックの終端として扱い、254バイト溜まったブロックは0x00を伴わずに出力します
+ * @param b エンコードするバイト
+ */
+void RIDCobsFrameWriter::_encodeByte(uint8_t b) {
+    if (b == 0x00) {
+        _flushBlock();
+        return;
+    }
+    _block[_blockLen++] = b;
+    if (_blockLen == sizeof(_block)) {
+        _flushBlock(); // コードバイト0xFF: 後ろに0x00を伴わないブロック
+    }
+}
+
+/**
+ * @brief 現在のブロックをCOBSのコードバイト付きで出力します
+ */
+void RIDCobsFrameWriter::_flushBlock() {
+    _written += _out.write((uint8_t)(_blockLen + 1));
+    if (_blockLen > 0) {
+        _written += _out.write(_block, _blockLen);
+    }
+    _blockLen = 0;
+}
+
+/**
+ * @brief RemoteIDEntryの値からRemoteIDPackedEntryを作成します
+ * @details 範囲外の値は各フィールドの表現可能な範囲に飽和させます
+ * @param rssi RSSI値
+ * @param timestamp 受信タイムスタンプ (UNIX秒)
+ * @param beaconTimestamp ビーコンタイムスタンプ (マイクロ秒)
+ * @param channel 受信Wi-Fiチャンネル
+ * @param lat 緯度 (度)
+ * @param lon 経度 (度)
+ * @param pAlt 気圧高度 (メートル)
+ * @param gAlt GPS高度 (メートル)
+ * @return 詰めたエントリ
+ */
+RemoteIDPackedEntry packRemoteIDEntry(int rssi, time_t timestamp, uint64_t beaconTimestamp, int channel,
+                                      float lat, float lon, float pAlt, float gAlt) {
+    RemoteIDPackedEntry packed;
+    packed.rssi = (int8_t)constrain(rssi, -128, 127);
+    packed.channel = (uint8_t)constrain(channel, 0, 255);
+    packed.timestamp = (uint32_t)timestamp;
+    for (int i = 0; i < 6; i++) {
+        packed.beaconTimestamp[i] = (uint8_t)(beaconTimestamp >> (8 * i));
+    }
+    packed.latitude = (int32_t)_scaleClamp(lat, 1e7, -1800000000L, 1800000000L);
+    packed.longitude = (int32_t)_scaleClamp(lon, 1e7, -1800000000L, 1800000000L);
+    packed.pressureAltitude = (int16_t)_scaleClamp(pAlt, 10.0, -32768L, 32767L);
+    packed.gpsAltitude = (int16_t)_scaleClamp(gAlt, 10.0, -32768L, 32767L);
+    return packed;
+}
@@ -0,0 +1,134 @@
+#ifndef RID_BINARY_EXPORT_H
+#define RID_BINARY_EXPORT_H
+
+#include <Arduino.h>
+
+/**
+ * @file RIDBinaryExport.h
+ * @brief リモートID履歴をシリアルへバイナリ形式で出力するためのフレーム形式とエンコーダの定義
+ *
+ * フレームは COBS (Consistent Overhead Byte Stuffing) でエンコードし、前後を 0x00 で区切ります
+ * 同じシリアルにログ文字列が混在しても、受信側は 0x00 区切りとCRCでフレームだけを取り出せます
+ *
+ * フレームのペイロード (COBSエンコード前、多バイト値はすべてリトルエンディアン):
+ * | オフセット | サイズ | 内容                                              |
+ * |-----------|--------|---------------------------------------------------|
+ * | 0         | 2      | マジック 'R','B'                                   |
+ * | 2         | 1      | フォーマットバージョン (RID_BINARY_VERSION)          |
+ * | 3         | 1      | フラグ (RID_BINARY_FLAG_*)                          |
+ * | 4         | 1      | RID文字列長 N                                      |
+ * | 5         | N      | RID文字列 (終端なし)                                |
+ * | 5+N       | 1      | 登録記号文字列長 M                                  |
+ * | 6+N       | M      | 登録記号文字列 (終端なし)                            |
+ * | 6+N+M     | 2      | エントリ数 K                                       |
+ * | 8+N+M     | 4      | カーソル: 最後のエントリのシーケンス番号            |
+ * | 12+N+M    | 24*K   | RemoteIDPackedEntry × K (古い順、連番)              |
+ * | 末尾      | 2      | ここまでの全バイトの CRC-16/CCITT-FALSE             |
+ *
+ * エントリのシーケンス番号はカーソルから逆算できます (i番目のエントリは カーソル - K + 1 + i)
+ * K が0の場合のカーソルは、要求時に渡された since_seq がそのまま返ります
+ *
+ * 1回の出力 (ボタンA / since コマンド) は複数のフレームに分かれることがあり、最後のフレームにだけ
+ * RID_BINARY_FLAG_LAST が立ちます。受信側は LAST のフレームを受け取るまでを1回分の応答として扱ってください
+ *
+ * 復号用のPCツールは tools/rid_binary_decode.py を参照してください
+ */
+
+static const uint8_t RID_BINARY_MAGIC0 = 'R';   ///< フレームのマジック1バイト目
+static const uint8_t RID_BINARY_MAGIC1 = 'B';   ///< フレームのマジック2バイト目
+static const uint8_t RID_BINARY_VERSION = 3;    ///< フレームのフォーマットバージョン (2: カーソルを追加、3: フラグを追加)
+
+static const uint8_t RID_BINARY_FLAG_LAST = 0x01; ///< 1回の出力の最後のフレーム
+static const uint8_t RID_BINARY_FLAG_MORE = 0x02; ///< 出力件数の上限や中止で打ち切ったため、カーソルより新しいエントリがまだある (LASTと同時のみ)
+
+#pragma pack(push,1) // ワイヤフォーマットなのでパディングを入れない
+
+/**
+ * @struct RemoteIDPackedEntry
+ * @brief RemoteIDEntryをシリアル転送用に詰めた固定長 (24バイト) の表現
+ * @note 緯度経度・高度はASTM F3411-19のメッセージと同じ整数単位に戻して格納します
+ *       多バイト値はESP32のネイティブ順 (リトルエンディアン) のまま出力します
+ *       登録記号はエントリごとではなくフレームのヘッダに1回だけ格納します
+ */
+struct RemoteIDPackedEntry {
+    int8_t rssi;                    ///< RSSI (dBm)
+    uint8_t channel;                ///< 受信Wi-Fiチャンネル
+    uint32_t timestamp;             ///< 受信時刻 (UNIX秒)
+    uint8_t beaconTimestamp[6];     ///< ビーコンのTSFタイムスタンプ (マイクロ秒、下位48bit、リトルエンディアン)
+    int32_t latitude;               ///< 緯度 (1e-7度単位)
+    int32_t longitude;              ///< 経度 (1e-7度単位)
+    int16_t pressureAltitude;       ///< 気圧高度 (0.1m単位)
+    int16_t gpsAltitude;            ///< GPS高度 (0.1m単位)
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(RemoteIDPackedEntry) == 24, "RemoteIDPackedEntry must be 24 bytes");
+
+/**
+ * @class RIDCobsFrameWriter
+ * @brief ペイロードを逐次COBSエンコードし、CRC-16を付けてストリームへ出力するライタ
+ *
+ * COBSの1ブロック分 (最大254バイト) のバッファだけを持ち、フレーム全体をメモリに展開しません
+ * 使い方: begin() → write() を必要な回数 → end()
+ */
+class RIDCobsFrameWriter {
+public:
+    /// @brief コンストラクタ
+    /// @param output_stream フレームの出力先ストリーム
+    explicit RIDCobsFrameWriter(Print& output_stream);
+
+    /// @brief フレームを開始します。先頭の区切り 0x00 を出力し、CRCを初期化します
+    void begin();
+
+    /// @brief ペイロードのバイト列をフレームに追加します
+    /// @param data 追加するデータ
+    /// @param len データ長
+    void write(const uint8_t* data, size_t len);
+
+    /// @brief ペイロードに1バイト追加します
+    /// @param b 追加するバイト
+    void writeByte(uint8_t b);
+
+    /// @brief ペイロードに16bit値をリトルエンディアンで追加します
+    /// @param value 追加する値
+    void writeUInt16(uint16_t value);
+
+    /// @brief ペイロードに32bit値をリトルエンディアンで追加します
+    /// @param value 追加する値
+    void writeUInt32(uint32_t value);
+
+    /// @brief CRCを付けてフレームを終了し、末尾の区切り 0x00 を出力します
+    /// @return begin() からこのフレームで出力したバイト数 (区切りを含む)
+    size_t end();
+
+private:
+    Print& _out;              ///< 出力先ストリーム
+    uint8_t _block[254];      ///< COBSの現在のブロック (0x00を含まないバイト列)
+    uint8_t _blockLen;        ///< _block に溜まっているバイト数
+    uint16_t _crc;            ///< ペイロードの CRC-16/CCITT-FALSE の途中値
+    size_t _written;          ///< このフレームで出力したバイト数
+
+    /// @brief CRCを更新せずにCOBSエンコーダへ1バイト渡します
+    void _encodeByte(uint8_t b);
+
+    /// @brief 現在のブロックをCOBSのコードバイト付きで出力します
+    void _flushBlock();
+};
+
+/**
+ * @brief RemoteIDEntryの値からRemoteIDPackedEntryを作成します
+ * @param rssi RSSI値
+ * @param timestamp 受信タイムスタンプ (UNIX秒)
+ * @param beaconTimestamp ビーコンタイムスタンプ (マイクロ秒)
+ * @param channel 受信Wi-Fiチャンネル
+ * @param lat 緯度 (度)
+ * @param lon 経度 (度)
+ * @param pAlt 気圧高度 (メートル)
+ * @param gAlt GPS高度 (メートル)
+ * @return 詰めたエントリ
+ */
+RemoteIDPackedEntry packRemoteIDEntry(int rssi, time_t timestamp, uint64_t beaconTimestamp, int channel,
+                                      float lat, float lon, float pAlt, float gAlt);
+
+#endif // RID_BINARY_EXPORT_H
@@ -0,0 +1,181 @@
+/**
+ * @file RIDTelemetry.cpp
+ * @brief RIDTelemetryクラスの実装ファイル
+ */
+#include "RIDTelemetry.h"
+
+/**
+ * @brief パーセンタイル値を取得します
+ * @details バケットの幅は2倍ずつ広がるため、値は該当するバケットの上限 (誤差は最大で2倍) です
+ * @param percent 0～100
+ * @return パーセンタイル値 (最大値を超えない)
+ */
+uint32_t RIDTelemetry::Histogram::percentile(uint8_t percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    // 記録回数のpercent%に達する最初のバケットを探す (切り上げ、最低1回)
+    uint64_t target = ((uint64_t)count * percent + 99) / 100;
+    if (target == 0) target = 1;
+    uint64_t cumulative = 0;
+    for (uint8_t b = 0; b < BUCKET_COUNT; ++b) {
+        cumulative += buckets[b];
+        if (cumulative >= target) {
+            const uint32_t upper = b == 0 ? 0 : (b == BUCKET_COUNT - 1 ? max : (1UL << b) - 1);
+            return min(upper, max);
+        }
+    }
+    return max;
+}
+
+/**
+ * @brief コンストラクタ
+ */
+RIDTelemetry::RIDTelemetry() : _mux(portMUX_INITIALIZER_UNLOCKED), _lockTimeouts(0) {
+    reset();
+}
+
+/**
+ * @brief 計測値を記録します
+ * @param metric 計測項目
+ * @param value 計測値
+ */
+void RIDTelemetry::record(Metric metric, uint32_t value) {
+    if (metric >= METRIC_COUNT) {
+        return;
+    }
+    const uint8_t bucket = _bucketOf(value);
+    portENTER_CRITICAL(&_mux);
+    Histogram& h = _histograms[metric];
+    h.count++;
+    h.sum += value;
+    if (value > h.max) h.max = value;
+    h.buckets[bucket]++;
+    portEXIT_CRITICAL(&_mux);
+}
+
+/**
+ * @brief Wi-Fiコールバックでセマフォを取得できなかった回数を数えます
+ */
+void RIDTelemetry::countLockTimeout() {
+    portENTER_CRITICAL(&_mux);
+    _lockTimeouts++;
+    portEXIT_CRITICAL(&_mux);
+}
+
+/**
+ * @brief ヒープ残量を取得し、水位とFREE_HEAP_KBを更新します
+ */
+void RIDTelemetry::sampleHeap() {
+    const uint32_t free_heap = ESP.getFreeHeap();
+    const uint32_t min_free_heap = ESP.getMinFreeHeap();
+    const uint32_t largest_block = ESP.getMaxAllocHeap();
+    portENTER_CRITICAL(&_mux);
+    _heap.freeHeap = free_heap;
+    _heap.minFreeHeap = min_free_heap;
+    _heap.largestFreeBlock = largest_block;
+    if (_heap.minLargestFreeBlock == 0 || largest_block < _heap.minLargestFreeBlock) {
+        _heap.minLargestFreeBlock = largest_block;
+    }
+    portEXIT_CRITICAL(&_mux);
+    record(FREE_HEAP_KB, free_heap / 1024);
+}
+
+/**
+ * @brief 計測項目のヒストグラムの写しを取得します
+ * @param metric 計測項目
+ * @param out 写しの格納先
+ */
+void RIDTelemetry::snapshot(Metric metric, Histogram& out) const {
+    if (metric >= METRIC_COUNT) {
+        memset(&out, 0, sizeof(out));
+        return;
+    }
+    portENTER_CRITICAL(&_mux);
+    out = _histograms[metric];
+    portEXIT_CRITICAL(&_mux);
+}
+
+/**
+ * @brief ヒープ残量の水位を取得します
+ * @return ヒープ残量の水位
+ */
+RIDTelemetry::HeapWatermarks RIDTelemetry::getHeapWatermarks() const {
+    portENTER_CRITICAL(&_mux);
+    HeapWatermarks heap = _heap;
+    portEXIT_CRITICAL(&_mux);
+    return heap;
+}
+
+/**
+ * @brief すべての記録を消去します
+ * @details 最大の連続ブロックの最小値も消去するため、以降の断片化だけを観察できます
+ *          (ヒープ残量の最小値はESP-IDFが起動時から保持している値のため消去されません)
+ */
+void RIDTelemetry::reset() {
+    portENTER_CRITICAL(&_mux);
+    memset(_histograms, 0, sizeof(_histograms));
+    memset(&_heap, 0, sizeof(_heap));
+    _lockTimeouts = 0;
+    portEXIT_CRITICAL(&_mux);
+}
+
+/**
+ * @brief すべての記録を1行のJSONとして出力します
+ * @details 形式: {"telemetry":{"parse_us":{"n":..,"sum":..,"max":..,"p50":..,"p99":..,"buckets":[..]},...,
+ *          "lock_timeouts":..,"heap":{"free":..,"min_free":..,"largest":..,"min_largest":..}}}
+ *          バケットbの範囲は [2^(b-1), 2^b) (b=0は0のみ、最後のバケットはそれ以上の値すべて) です
+ * @param output 出力先
+ * @return 出力したバイト数
+ */
+size_t RIDTelemetry::dumpJson(Print& output) const {
+    size_t written = output.print("{\"telemetry\":{");
+    for (uint8_t m = 0; m < METRIC_COUNT; ++m) {
+        Histogram h;
+        snapshot((Metric)m, h);
+        written += output.printf("\"%s\":{\"n\":%u,\"sum\":%llu,\"max\":%u,\"p50\":%u,\"p99\":%u,\"buckets\":[",
+                                 metricName((Metric)m), h.count, (unsigned long long)h.sum, h.max,
+                                 h.percentile(50), h.percentile(99));
+        for (uint8_t b = 0; b < BUCKET_COUNT; ++b) {
+            written += output.printf(b == 0 ? "%u" : ",%u", h.buckets[b]);
+        }
+        written += output.print("]},");
+    }
+    const HeapWatermarks heap = getHeapWatermarks();
+    written += output.printf("\"lock_timeouts\":%u,\"heap\":{\"free\":%u,\"min_free\":%u,\"largest\":%u,\"min_largest\":%u}}}\n",
+                             getLockTimeouts(), heap.freeHeap, heap.minFreeHeap, heap.largestFreeBlock, heap.minLargestFreeBlock);
+    return written;
+}
+
+/**
+ * @brief 計測項目の名前を取得します
+ * @param metric 計測項目
+ * @return 名前 (JSONのキーとデバッグページの表示に使用)
+ */
+const char* RIDTelemetry::metricName(Metric metric) {
+    switch (metric) {
+        case PARSE_US:        return "parse_us";
+        case LOCK_WAIT_US:    return "lock_wait_us";
+        case ADD_DATA_US:     return "add_data_us";
+        case UI_FRAME_US:     return "ui_frame_us";
+        case EXPORT_CHUNK_US: return "export_chunk_us";
+        case EXPORT_MS:       return "export_ms";
+        case RID_DEPTH:       return "rid_depth";
+        case ENTRY_DEPTH:     return "entry_depth";
+        case FREE_HEAP_KB:    return "free_heap_kb";
+        default:              return "unknown";
+    }
+}
+
+/**
+ * @brief 値が入るバケットの番号を取得します
+ * @param value 計測値
+ * @return バケット番号 (0は値0、bは [2^(b-1), 2^b))
+ */
+uint8_t RIDTelemetry::_bucketOf(uint32_t value) {
+    if (value == 0) {
+        return 0;
+    }
+    const uint8_t bits = 32 - __builtin_clz(value);
+    return bits < BUCKET_COUNT ? bits : BUCKET_COUNT - 1;
+}
@@ -0,0 +1,107 @@
+#ifndef RID_TELEMETRY_H
+#define RID_TELEMETRY_H
+
+#include <Arduino.h>
+
+/**
+ * @file RIDTelemetry.h
+ * @brief 処理時間・キュー深さ・ヒープ残量をヒストグラムとして記録するRIDTelemetryクラスの定義
+ */
+
+/**
+ * @class RIDTelemetry
+ * @brief スニッファ・表示・出力の各処理の計測値を、2のべき乗幅のバケットのヒストグラムとして記録するクラス
+ *
+ * 記録はスピンロックで保護した数命令の加算だけなので、Wi-Fiコールバックや出力タスクからも呼び出せます
+ * 記録した内容はデバッグページ (snapshot()) とシリアルへのJSON出力 (dumpJson()) で確認できます
+ */
+class RIDTelemetry {
+public:
+    /// @brief 計測項目
+    enum Metric : uint8_t {
+        PARSE_US,        ///< Wi-FiコールバックでのBeaconの解析時間 (マイクロ秒、RIDのBeaconのみ)
+        LOCK_WAIT_US,    ///< Wi-Fiコールバックでのセマフォの待ち時間 (マイクロ秒)
+        ADD_DATA_US,     ///< addData() の処理時間 (マイクロ秒)
+        UI_FRAME_US,     ///< UIフレームの描画時間 (マイクロ秒)
+        EXPORT_CHUNK_US, ///< 出力タスクがセマフォを保持してチャンクを書き出す時間 (マイクロ秒)
+        EXPORT_MS,       ///< 1回の出力全体の時間 (ミリ秒)
+        RID_DEPTH,       ///< 保持しているRIDの数 (sampleHeap() と同じ周期で呼び出し側が記録)
+        ENTRY_DEPTH,     ///< 保持しているエントリの合計数 (sampleHeap() と同じ周期で呼び出し側が記録)
+        FREE_HEAP_KB,    ///< ヒープ残量 (KB、sampleHeap() ごと)
+        METRIC_COUNT     ///< 計測項目の数
+    };
+
+    static const uint8_t BUCKET_COUNT = 20; ///< バケット数。バケットbは [2^(b-1), 2^b) (b=0は0)、最後のバケットはそれ以上の値すべて
+
+    /// @brief 1つの計測項目のヒストグラム
+    struct Histogram {
+        uint32_t count;                 ///< 記録回数
+        uint64_t sum;                   ///< 記録した値の合計
+        uint32_t max;                   ///< 記録した値の最大値
+        uint32_t buckets[BUCKET_COUNT]; ///< バケットごとの記録回数
+
+        /// @brief 平均値を取得します
+        uint32_t mean() const { return count ? (uint32_t)(sum / count) : 0; }
+
+        /// @brief パーセンタイル値 (該当するバケットの上限、ただし最大値を超えない) を取得します
+        /// @param percent 0～100
+        uint32_t percentile(uint8_t percent) const;
+    };
+
+    /// @brief ヒープ残量の水位
+    struct HeapWatermarks {
+        uint32_t freeHeap;            ///< 直近のヒープ残量 (バイト)
+        uint32_t minFreeHeap;         ///< 起動後のヒープ残量の最小値 (バイト)
+        uint32_t largestFreeBlock;    ///< 直近の確保可能な最大の連続ブロック (バイト)
+        uint32_t minLargestFreeBlock; ///< 計測開始後の確保可能な最大の連続ブロックの最小値 (バイト)
+    };
+
+    /// @brief コンストラクタ
+    RIDTelemetry();
+
+    /// @brief 計測値を記録します
+    /// @param metric 計測項目
+    /// @param value 計測値
+    void record(Metric metric, uint32_t value);
+
+    /// @brief Wi-Fiコールバックでセマフォを取得できなかった回数を数えます
+    void countLockTimeout();
+
+    /// @brief ヒープ残量を取得し、水位とFREE_HEAP_KBを更新します。RID_DEPTHとENTRY_DEPTHは呼び出し側が記録します
+    void sampleHeap();
+
+    /// @brief 計測項目のヒストグラムの写しを取得します
+    /// @param metric 計測項目
+    /// @param out 写しの格納先
+    void snapshot(Metric metric, Histogram& out) const;
+
+    /// @brief ヒープ残量の水位を取得します
+    HeapWatermarks getHeapWatermarks() const;
+
+    /// @brief Wi-Fiコールバックでセマフォを取得できなかった回数を取得します
+    uint32_t getLockTimeouts() const { return _lockTimeouts; }
+
+    /// @brief すべての記録を消去します
+    void reset();
+
+    /// @brief すべての記録を1行のJSONとして出力します
+    /// @param output 出力先
+    /// @return 出力したバイト数
+    size_t dumpJson(Print& output) const;
+
+    /// @brief 計測項目の名前を取得します
+    /// @param metric 計測項目
+    /// @return 名前 (例: "parse_us")
+    static const char* metricName(Metric metric);
+
+private:
+    mutable portMUX_TYPE _mux;           ///< 記録と読み出しを保護するスピンロック
+    Histogram _histograms[METRIC_COUNT]; ///< 計測項目ごとのヒストグラム
+    HeapWatermarks _heap;                ///< ヒープ残量の水位
+    volatile uint32_t _lockTimeouts;     ///< Wi-Fiコールバックでセマフォを取得できなかった回数
+
+    /// @brief 値が入るバケットの番号を取得します
+    static uint8_t _bucketOf(uint32_t value);
+};
+
+#endif // RID_TELEMETRY_H
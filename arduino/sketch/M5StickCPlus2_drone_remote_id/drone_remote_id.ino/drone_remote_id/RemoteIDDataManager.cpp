@@ -4,13 +4,15 @@
  * @details リモートIDデータの管理、格納、およびクエリ機能を提供します
  */
 #include "RemoteIDDataManager.h"
+#include "RIDBinaryExport.h"
+#include <cmath> // llround
 
 /**
  * @brief RemoteIDDataManagerクラスのコンストラクタ
  * @param targetRid 特別扱いするRIDの文字列。このRIDは他のRIDよりも多くのデータエントリを保持します
  */
 RemoteIDDataManager::RemoteIDDataManager(const String& targetRid)
-    : _target_rid_value(targetRid) {
+    : _target_rid_value(targetRid), _data_version(0) {
     // 必要であれば初期化処理をここに追加
 }
 
@@ -28,8 +30,10 @@ RemoteIDDataManager::RemoteIDDataManager(const String& targetRid)
  * @param lon 経度
  * @param pAlt 気圧高度
  * @param gAlt GPS高度
+ * @param beaconIntervalTU ビーコンフレームのビーコン間隔 (TU = 1024マイクロ秒)。0の場合は不明
  */
-void RemoteIDDataManager::addData(const String& rid, int rssi, time_t timestamp, uint64_t beaconTimestamp, int channel, const String& registrationNo, float lat, float lon, float pAlt, float gAlt) {
+void RemoteIDDataManager::addData(const String& rid, int rssi, time_t timestamp, uint64_t beaconTimestamp, int channel, const String& registrationNo, float lat, float lon, float pAlt, float gAlt,
+                                  uint16_t beaconIntervalTU) {
     RemoteIDEntry new_entry(rssi, timestamp, beaconTimestamp, channel, registrationNo, lat, lon, pAlt, gAlt);
     auto it = _data_store.find(rid);
     if (it == _data_store.end()) {
@@ -42,7 +46,21 @@ void RemoteIDDataManager::addData(const String& rid, int rssi, time_t timestamp,
                                  std::forward_as_tuple(max_size)).first; // 値(RIDDataContainer)のコンストラクタ引数
     }
     // 既存または新規作成したコンテナに新しいデータエントリを追加
-    it->second.addEntry(new_entry);
+    RIDDataContainer& container = it->second;
+    const bool ranked = !container.entries.empty();
+    const int old_rssi = container.latest_rssi;
+    container.addEntry(new_entry);
+    if (beaconIntervalTU != 0) {
+        container.beacon_interval_tu = beaconIntervalTU;
+    }
+    // 最新RSSIが変わった場合だけ、RSSI順位インデックスを付け替える
+    if (!ranked || old_rssi != container.latest_rssi) {
+        if (ranked) {
+            _rssi_rank.erase(RSSIRankKey{old_rssi, &it->first});
+        }
+        _rssi_rank.insert(RSSIRankKey{container.latest_rssi, &it->first});
+    }
+    _data_version = _data_version + 1;
 }
 
 /**
@@ -122,6 +140,28 @@ int RemoteIDDataManager::getRIDCount() const {
     return _data_store.size();
 }
 
+/**
+ * @brief 指定されたRIDが保持しているデータエントリの数を返します
+ * @param rid 対象のRIDの識別子
+ * @return 保持しているエントリ数。RIDが存在しない場合は0
+ */
+size_t RemoteIDDataManager::getEntryCountForRID(const String& rid) const {
+    auto it = _data_store.find(rid);
+    return it != _data_store.end() ? it->second.entries.size() : 0;
+}
+
+/**
+ * @brief 全RIDが保持しているデータエントリの合計数を返します
+ * @return エントリの合計数
+ */
+size_t RemoteIDDataManager::getTotalEntryCount() const {
+    size_t total = 0;
+    for (const auto& pair : _data_store) {
+        total += pair.second.entries.size();
+    }
+    return total;
+}
+
 /**
  * @brief RSSIの降順でソートされたRIDのリストを取得するヘルパーメソッド
  *        リストの各要素は {最新RSSI, RID文字列} のペアです
@@ -130,25 +170,30 @@ int RemoteIDDataManager::getRIDCount() const {
  */
 std::vector<std::pair<int, String>> RemoteIDDataManager::getSortedRIDsByRSSI() const {
     std::vector<std::pair<int, String>> sorted_rids_list;
-    if (_data_store.empty()) {
-        return sorted_rids_list; // データストアが空なら空リストを返す
+    getRIDsByRSSIRank(0, _rssi_rank.size(), sorted_rids_list);
+    return sorted_rids_list;
+}
+
+/**
+ * @brief RSSI順位の範囲を指定して、{最新RSSI, RID文字列} のペアを取得します
+ * @details RSSI順位インデックスは常に並んだ状態で保持しているため、先頭から first 件を読み飛ばして count 件を取り出します
+ * @param first 取得する最初の順位 (0から始まる)
+ * @param count 取得する最大件数
+ * @param[out] out 取得したペアを格納するベクター (内容は置き換えられます)
+ * @return 順位付けされているRIDの総数
+ */
+size_t RemoteIDDataManager::getRIDsByRSSIRank(size_t first, size_t count, std::vector<std::pair<int, String>>& out) const {
+    out.clear();
+    if (first >= _rssi_rank.size()) {
+        return _rssi_rank.size();
     }
-    // データストア内の各RIDについて、最新のRSSIとRID文字列をペアにしてリストに追加
-    for (const auto& pair : _data_store) {
-        if (!pair.second.entries.empty()) { // エントリが空でないことを確認
-            sorted_rids_list.push_back({pair.second.latest_rssi, pair.first});
-        }
+    auto it = _rssi_rank.begin();
+    std::advance(it, first);
+    out.reserve(std::min(count, _rssi_rank.size() - first));
+    for (; it != _rssi_rank.end() && out.size() < count; ++it) {
+        out.push_back({it->rssi, *it->rid});
     }
-    // リストをソート
-    // 優先順位1: RSSIの降順
-    // 優先順位2: RID文字列の昇順 (RSSIが同じ場合)
-    std::sort(sorted_rids_list.begin(), sorted_rids_list.end(), [](const auto& a, const auto& b) {
-        if (a.first != b.first) {
-            return a.first > b.first; // RSSI降順
-        }
-        return a.second < b.second; // RSSIが同じ場合はRID文字列で昇順
-    });
-    return sorted_rids_list;
+    return _rssi_rank.size();
 }
 
 /**
@@ -161,12 +206,12 @@ std::vector<RemoteIDEntry> RemoteIDDataManager::getDataByIndex(int index) const
     if (index < 0) {
         return {}; // 負のインデックスは無効
     }
-    std::vector<std::pair<int, String>> sorted_rids = getSortedRIDsByRSSI();
-    if (static_cast<size_t>(index) >= sorted_rids.size()) {
+    std::vector<std::pair<int, String>> ranked;
+    getRIDsByRSSIRank(static_cast<size_t>(index), 1, ranked);
+    if (ranked.empty()) {
         return {}; // インデックスが範囲外の場合は空のベクターを返す
     }
-    String selected_rid = sorted_rids[index].second; // インデックスに対応するRID文字列を取得
-    return getAllDataForRID(selected_rid, 0); // 0を渡して、そのRIDの全データを取得
+    return getAllDataForRID(ranked[0].second, 0); // 0を渡して、そのRIDの全データを取得
 }
 
 /**
@@ -179,11 +224,12 @@ String RemoteIDDataManager::getRIDStringByIndex(int index) const {
     if (index < 0) {
         return ""; // 負のインデックスは無効
     }
-    std::vector<std::pair<int, String>> sorted_rids = getSortedRIDsByRSSI();
-    if (static_cast<size_t>(index) >= sorted_rids.size()) {
+    std::vector<std::pair<int, String>> ranked;
+    getRIDsByRSSIRank(static_cast<size_t>(index), 1, ranked);
+    if (ranked.empty()) {
         return ""; // インデックスが範囲外の場合は空文字列を返す
     }
-    return sorted_rids[index].second; // インデックスに対応するRID文字列を返す
+    return ranked[0].second; // インデックスに対応するRID文字列を返す
 }
 
 /**
@@ -214,7 +260,9 @@ bool RemoteIDDataManager::getLatestEntryForRID(const String& rid, RemoteIDEntry&
  * @brief データストア内の全てのRIDデータをクリアします
  */
 void RemoteIDDataManager::clearAllData() {
+    _rssi_rank.clear(); // 順位インデックスは _data_store のキーを指しているので先に消す
     _data_store.clear(); // マップをクリアすることで全データが削除される
+    _data_version = _data_version + 1;
 }
 
 /**
@@ -222,30 +270,370 @@ void RemoteIDDataManager::clearAllData() {
  * @param rid データをクリアしたいRIDの識別子
  */
 void RemoteIDDataManager::clearDataForRID(const String& rid) {
-    _data_store.erase(rid); // 指定されたキーのエントリをマップから削除
+    auto it = _data_store.find(rid);
+    if (it == _data_store.end()) {
+        return;
+    }
+    if (!it->second.entries.empty()) {
+        _rssi_rank.erase(RSSIRankKey{it->second.latest_rssi, &it->first});
+    }
+    _data_store.erase(it); // 指定されたキーのエントリをマップから削除
+    _data_version = _data_version + 1;
 }
 
 /**
- * @brief RemoteIDEntryの内容をJsonObjectに格納するプライベートヘルパーメソッド
- *        JSONのキー名は短縮形を使用します
- * @param jsonObj 格納先のJsonObject
- * @param entry 格納するRemoteIDEntryデータ
+ * @brief JSON出力用の数値・文字列整形ヘルパー群
+ * @details ArduinoJsonのドキュメントを構築せず、スタック上の小さなバッファへ直接書き込むための関数です
+ *          いずれもバッファ末尾を超えないことを呼び出し側で保証する前提で、書き込み後のポインタを返します
  */
-void RemoteIDDataManager::_populateJsonEntry(JsonObject jsonObj, const RemoteIDEntry& entry) const {
-    jsonObj["rssi"] = entry.rssi;
+namespace {
+
+/// @brief 1エントリ分のJSON文字列を組み立てるスタックバッファのサイズ (最長の数値を全フィールドに入れても収まる長さ)
+const size_t JSON_ENTRY_BUFFER_SIZE = 256;
+
+/// @brief 符号なし64bit整数を10進文字列として書き込みます
+char* _appendUInt64(char* p, uint64_t value) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+/// @brief 符号付き64bit整数を10進文字列として書き込みます
+char* _appendInt64(char* p, int64_t value) {
+    if (value < 0) {
+        *p++ = '-';
+        return _appendUInt64(p, static_cast<uint64_t>(-(value + 1)) + 1); // INT64_MINでもオーバーフローしない
+    }
+    return _appendUInt64(p, static_cast<uint64_t>(value));
+}
+
+/// @brief 浮動小数点数を小数点以下 `decimals` 桁の固定小数点表記で書き込みます
+///        10のべき乗でスケールした整数に丸めてから整数部と小数部を出力するため、printf系より高速です
+///        NaN/無限大や64bit整数に収まらない値は、JSONとして有効な `null` を書き込みます
+char* _appendFixed(char* p, float value, int decimals) {
+    static const int64_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+    const int64_t scale = POW10[decimals];
+    const double scaled = static_cast<double>(value) * scale;
+    if (!(scaled > -9.0e18 && scaled < 9.0e18)) { // NaNもここで弾かれる
+        memcpy(p, "null", 4);
+        return p + 4;
+    }
+    int64_t fixed = llround(scaled);
+    if (fixed < 0) {
+        *p++ = '-';
+        fixed = -fixed;
+    }
+    p = _appendUInt64(p, static_cast<uint64_t>(fixed / scale));
+    if (decimals > 0) {
+        *p++ = '.';
+        int64_t frac = fixed % scale;
+        for (int64_t div = scale / 10; div > 0; div /= 10) { // 先頭の0も含めて桁数分出力
+            *p++ = static_cast<char>('0' + (frac / div) % 10);
+        }
+    }
+    return p;
+}
+
+/// @brief 文字列リテラル (キー名や区切り記号) を書き込みます
+char* _appendLiteral(char* p, const char* literal) {
+    while (*literal) {
+        *p++ = *literal++;
+    }
+    return p;
+}
+
+/// @brief 文字列をJSONの文字列値としてエスケープしながらストリームへ出力します
+/// @return 出力したバイト数
+size_t _writeJsonString(Print& out, const String& value) {
+    char buf[64];
+    size_t len = 0;
+    size_t written = 0;
+    buf[len++] = '"';
+    for (unsigned int i = 0; i < value.length(); ++i) {
+        if (len + 6 >= sizeof(buf)) { // 最長のエスケープ (6バイト) が入らなければ先に吐き出す
+            written += out.write(reinterpret_cast<const uint8_t*>(buf), len);
+            len = 0;
+        }
+        const char c = value.charAt(i);
+        if (c == '"' || c == '\\') {
+            buf[len++] = '\\';
+            buf[len++] = c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            static const char HEX_DIGITS[] = "0123456789abcdef";
+            buf[len++] = '\\';
+            buf[len++] = 'u';
+            buf[len++] = '0';
+            buf[len++] = '0';
+            buf[len++] = HEX_DIGITS[(c >> 4) & 0x0F];
+            buf[len++] = HEX_DIGITS[c & 0x0F];
+        } else {
+            buf[len++] = c;
+        }
+    }
+    buf[len++] = '"';
+    written += out.write(reinterpret_cast<const uint8_t*>(buf), len);
+    return written;
+}
+
+} // namespace
+
+/**
+ * @brief 1つのRemoteIDEntryをJSONオブジェクトとしてストリームへ出力するプライベートヘルパーメソッド
+ *        JSONのキー名は短縮形を使用します。エントリはスタック上の固定長バッファで組み立ててから一度に書き込みます
+ * @param output_stream 出力先ストリーム
+ * @param entry 出力するRemoteIDEntryデータ
+ * @param leading_comma trueの場合、オブジェクトの前に配列要素の区切り `,` を付けます
+ * @return 出力したバイト数
+ */
+size_t RemoteIDDataManager::_writeJsonEntry(Print& output_stream, const RemoteIDEntry& entry, bool leading_comma) const {
+    char buf[JSON_ENTRY_BUFFER_SIZE];
+    char* p = buf;
+    if (leading_comma) {
+        *p++ = ',';
+    }
+    p = _appendLiteral(p, "{\"rssi\":");
+    p = _appendInt64(p, entry.rssi);
     // ts: UNIX timestamp (seconds) to milliseconds
-    jsonObj["ts"] = (unsigned long long)entry.timestamp * 1000ULL;
+    p = _appendLiteral(p, ",\"ts\":");
+    p = _appendUInt64(p, (unsigned long long)entry.timestamp * 1000ULL);
     // bTs: beaconTimestamp (microseconds) to milliseconds (truncate)
-    jsonObj["bTs"] = entry.beaconTimestamp / 1000ULL;
-    jsonObj["ch"] = entry.channel;
-    // registrationNo ("reg") is now handled at the root level of the JSON object.
-    // if (!entry.registrationNo.isEmpty()) {
-    //     jsonObj["reg"] = entry.registrationNo; // "registrationNo" -> "reg" (短縮)
-    // }
-    jsonObj["lat"] = entry.latitude;
-    jsonObj["lon"] = entry.longitude;
-    jsonObj["pAlt"] = entry.pressureAltitude;
-    jsonObj["gAlt"] = entry.gpsAltitude;
+    p = _appendLiteral(p, ",\"bTs\":");
+    p = _appendUInt64(p, entry.beaconTimestamp / 1000ULL);
+    p = _appendLiteral(p, ",\"ch\":");
+    p = _appendInt64(p, entry.channel);
+    // registrationNo ("reg") is handled at the root level of the JSON object.
+    // lat/lon: 受信値は1e-7度単位だが、floatの有効桁数に合わせて小数点以下6桁で出力
+    p = _appendLiteral(p, ",\"lat\":");
+    p = _appendFixed(p, entry.latitude, 6);
+    p = _appendLiteral(p, ",\"lon\":");
+    p = _appendFixed(p, entry.longitude, 6);
+    // pAlt/gAlt: 受信値は0.1m単位
+    p = _appendLiteral(p, ",\"pAlt\":");
+    p = _appendFixed(p, entry.pressureAltitude, 1);
+    p = _appendLiteral(p, ",\"gAlt\":");
+    p = _appendFixed(p, entry.gpsAltitude, 1);
+    *p++ = '}';
+    return output_stream.write(reinterpret_cast<const uint8_t*>(buf), p - buf);
+}
+
+/**
+ * @brief 最新の `max_log_entries` 件を出力する場合の開始位置を計算するヘルパーメソッド
+ * @param container 対象のデータコンテナ
+ * @param max_log_entries 出力するエントリの最大数。0の場合は全件
+ * @param[out] count 出力するエントリ数
+ * @return entries内の開始位置
+ */
+size_t RemoteIDDataManager::_tailRange(const RIDDataContainer& container, size_t max_log_entries, size_t& count) {
+    const size_t size = container.entries.size();
+    count = size;
+    if (max_log_entries > 0 && count > max_log_entries) {
+        count = max_log_entries; // 最新のmax_log_entries件のみ
+    }
+    return size - count;
+}
+
+/**
+ * @brief シーケンス番号が `since_seq` より新しいエントリを古い順に出力する場合の範囲を計算するヘルパーメソッド
+ * @details `since_seq` が最新のシーケンス番号より大きい場合は、カウンタがリセットされたとみなして全エントリを対象にします
+ *          `since_seq` の次のエントリがすでにリングバッファから削除されている場合は、保持している最も古いエントリから出力します
+ *          (ホストは出力された "from" と自分のカーソルを比べることで欠落を検出できます)
+ * @param container 対象のデータコンテナ
+ * @param since_seq ホストが受信済みの最後のシーケンス番号
+ * @param max_log_entries 出力するエントリの最大数。0の場合は全件
+ * @param[out] count 出力するエントリ数
+ * @return entries内の開始位置
+ */
+size_t RemoteIDDataManager::_sinceRange(const RIDDataContainer& container, uint32_t since_seq, size_t max_log_entries, size_t& count) {
+    const size_t size = container.entries.size();
+    size_t start_index = 0;
+    if (size > 0 && since_seq <= container.received_count) {
+        const uint32_t oldest_seq = _seqAt(container, 0);
+        if (since_seq >= oldest_seq) {
+            start_index = since_seq - oldest_seq + 1;
+        }
+    }
+    count = size - start_index;
+    if (max_log_entries > 0 && count > max_log_entries) {
+        count = max_log_entries; // 古い順にmax_log_entries件。残りは次のカーソルで取得
+    }
+    return start_index;
+}
+
+/**
+ * @brief JSONオブジェクトの先頭 (`{"rid":..,"reg":..,"elm":[`) をストリームへ出力するプライベートヘルパーメソッド
+ * @param output_stream 出力先ストリーム
+ * @param rid 出力するRIDの識別子
+ * @param regNo ルートに出力する登録記号。空の場合は "reg" キーを省略します
+ * @return 出力したバイト数
+ */
+size_t RemoteIDDataManager::_writeJsonHeader(Print& output_stream, const String& rid, const String& regNo) const {
+    size_t written = output_stream.print("{\"rid\":");
+    written += _writeJsonString(output_stream, rid);
+    if (!regNo.isEmpty()) {
+        written += output_stream.print(",\"reg\":");
+        written += _writeJsonString(output_stream, regNo);
+    }
+    written += output_stream.print(",\"elm\":[");
+    return written;
+}
+
+/**
+ * @brief JSONオブジェクトの末尾 (`],"from":..,"seq":..}` と改行) をストリームへ出力するプライベートヘルパーメソッド
+ * @details カーソルは実際に出力したエントリから決まるため、"elm" の後ろに出力します
+ * @param output_stream 出力先ストリーム
+ * @param from_seq 最初に出力したエントリのシーケンス番号。0の場合は "from" キーを省略します
+ * @param cursor_seq 次回の差分取得に使うカーソル (最後に出力したエントリのシーケンス番号)
+ * @return 出力したバイト数 (末尾の改行を含む)
+ */
+size_t RemoteIDDataManager::_writeJsonFooter(Print& output_stream, uint32_t from_seq, uint32_t cursor_seq) const {
+    char buf[48];
+    char* p = buf;
+    *p++ = ']';
+    if (from_seq > 0) {
+        p = _appendLiteral(p, ",\"from\":");
+        p = _appendUInt64(p, from_seq);
+    }
+    p = _appendLiteral(p, ",\"seq\":");
+    p = _appendUInt64(p, cursor_seq);
+    *p++ = '}';
+    size_t written = output_stream.write(reinterpret_cast<const uint8_t*>(buf), p - buf);
+    written += output_stream.println();
+    return written;
+}
+
+/**
+ * @brief 1つのRIDのデータをJSONとしてストリームへ逐次出力するプライベートヘルパーメソッド
+ *        リングバッファから直接、指定範囲のエントリを古い順に1エントリずつ書き出すため、
+ *        出力サイズに比例したヒープ確保は発生しません
+ * @details ルートには次回の差分取得に使うカーソル "seq" (最後に出力したエントリのシーケンス番号) と、
+ *          エントリがある場合は最初のエントリのシーケンス番号 "from" を出力します
+ * @param output_stream 出力先ストリーム
+ * @param rid 出力するRIDの識別子
+ * @param regNo ルートに出力する登録記号。空の場合は "reg" キーを省略します
+ * @param container 出力するRIDのデータコンテナ
+ * @param start_index 出力を開始するentries内の位置
+ * @param count 出力するエントリ数
+ * @param cursor_seq エントリが0件の場合にルートの "seq" として返すカーソル値
+ * @return 出力したバイト数 (末尾の改行を含む)
+ */
+size_t RemoteIDDataManager::_writeJsonForContainer(Print& output_stream, const String& rid, const String& regNo,
+                                                   const RIDDataContainer& container, size_t start_index, size_t count,
+                                                   uint32_t cursor_seq) const {
+    size_t written = _writeJsonHeader(output_stream, rid, regNo);
+    const auto& deque_entries = container.entries;
+    const auto first_iter = deque_entries.begin() + start_index;
+    for (auto iter = first_iter; iter != first_iter + count; ++iter) {
+        written += _writeJsonEntry(output_stream, *iter, iter != first_iter);
+    }
+    uint32_t from_seq = 0;
+    if (count > 0) {
+        from_seq = _seqAt(container, start_index);
+        cursor_seq = _seqAt(container, start_index + count - 1);
+    }
+    written += _writeJsonFooter(output_stream, from_seq, cursor_seq);
+    return written;
+}
+
+/**
+ * @brief 1つのRIDのデータをバイナリフレームとしてストリームへ逐次出力するプライベートヘルパーメソッド
+ * @details エントリは1件ずつ RemoteIDPackedEntry に詰めてCOBSエンコーダへ渡すため、
+ *          出力サイズに比例したヒープ確保は発生しません。文字列は最大255バイトに切り詰めます
+ * @param output_stream 出力先ストリーム
+ * @param rid 出力するRIDの識別子 (空の場合はエントリ数0のフレーム)
+ * @param regNo フレームのヘッダに格納する登録記号
+ * @param container 出力するRIDのデータコンテナ。nullptrの場合はエントリ数0のフレーム
+ * @param start_index 出力を開始するentries内の位置
+ * @param count 出力するエントリ数
+ * @param cursor_seq エントリが0件の場合にヘッダの "seq" として返すカーソル値
+ * @param flags ヘッダに格納するフラグ (RID_BINARY_FLAG_*)
+ * @return 出力したバイト数 (前後の区切りを含む)
+ */
+size_t RemoteIDDataManager::_writeBinaryForContainer(Print& output_stream, const String& rid, const String& regNo,
+                                                     const RIDDataContainer* container, size_t start_index, size_t count,
+                                                     uint32_t cursor_seq, uint8_t flags) const {
+    RIDCobsFrameWriter frame(output_stream);
+    frame.begin();
+    frame.writeByte(RID_BINARY_MAGIC0);
+    frame.writeByte(RID_BINARY_MAGIC1);
+    frame.writeByte(RID_BINARY_VERSION);
+    frame.writeByte(flags);
+    uint8_t rid_len = (uint8_t)min((size_t)rid.length(), (size_t)255);
+    frame.writeByte(rid_len);
+    frame.write((const uint8_t*)rid.c_str(), rid_len);
+    uint8_t reg_len = (uint8_t)min((size_t)regNo.length(), (size_t)255);
+    frame.writeByte(reg_len);
+    frame.write((const uint8_t*)regNo.c_str(), reg_len);
+
+    if (container == nullptr) {
+        count = 0;
+    }
+    if (count > 0xFFFF) {
+        count = 0xFFFF;
+    }
+    frame.writeUInt16((uint16_t)count);
+    if (count > 0) {
+        cursor_seq = _seqAt(*container, start_index + count - 1);
+    }
+    frame.writeUInt32(cursor_seq);
+    if (count > 0) {
+        const auto first_iter = container->entries.begin() + start_index;
+        for (auto iter = first_iter; iter != first_iter + count; ++iter) {
+            RemoteIDPackedEntry packed = packRemoteIDEntry(iter->rssi, iter->timestamp, iter->beaconTimestamp, iter->channel,
+                                                           iter->latitude, iter->longitude,
+                                                           iter->pressureAltitude, iter->gpsAltitude);
+            frame.write((const uint8_t*)&packed, sizeof(packed));
+        }
+    }
+    return frame.end();
+}
+
+/**
+ * @brief RSSIが最も高いRIDのデータを、COBSフレームのバイナリ形式でストリームに出力します
+ * @param max_log_entries フレームに含めるデータエントリの最大数
+ * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数
+ */
+size_t RemoteIDDataManager::getBinaryForTopRSSI(size_t max_log_entries, Print& output_stream) const {
+    const String* top_rid = _topRSSIRID();
+    if (top_rid == nullptr) {
+        return _writeBinaryForContainer(output_stream, String(""), String(""), nullptr, 0, 0, 0, RID_BINARY_FLAG_LAST);
+    }
+    const String& rid_str = *top_rid;
+    const RIDDataContainer& container = _data_store.find(rid_str)->second;
+    size_t num_to_write = 0;
+    size_t start_index = _tailRange(container, max_log_entries, num_to_write);
+    return _writeBinaryForContainer(output_stream, rid_str, container.entries.back().registrationNo,
+                                    &container, start_index, num_to_write, 0, RID_BINARY_FLAG_LAST);
+}
+
+/**
+ * @brief 指定された登録記号を持つRIDのデータを、COBSフレームのバイナリ形式でストリームに出力します
+ *        最初に見つかった登録記号に合致するRIDのデータを出力します
+ * @param regNo 検索する機体登録記号
+ * @param max_log_entries フレームに含めるデータエントリの最大数
+ * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数
+ */
+size_t RemoteIDDataManager::getBinaryForRegistrationNo(const String& regNo, size_t max_log_entries, Print& output_stream) const {
+    if (!regNo.isEmpty()) {
+        for (const auto& pair : _data_store) {
+            const RIDDataContainer& container = pair.second;
+            if (!container.entries.empty() && container.entries.back().registrationNo == regNo) {
+                size_t num_to_write = 0;
+                size_t start_index = _tailRange(container, max_log_entries, num_to_write);
+                return _writeBinaryForContainer(output_stream, pair.first, regNo, &container, start_index, num_to_write, 0,
+                                                RID_BINARY_FLAG_LAST);
+            }
+        }
+    }
+    return _writeBinaryForContainer(output_stream, String(""), regNo, nullptr, 0, 0, 0, RID_BINARY_FLAG_LAST);
 }
 
 /**
@@ -254,41 +642,23 @@ void RemoteIDDataManager::_populateJsonEntry(JsonObject jsonObj, const RemoteIDE
  * @param count 取得する上位RIDの数 (現在は1に固定して利用されることを想定)
  * @param max_log_entries 1つのRIDに対してJSONに含めるデータエントリの最大数
  * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数
  */
-void RemoteIDDataManager::getJsonForTopRSSI(int count, size_t max_log_entries, Print& output_stream) const {
-    const size_t jsonDocSize = JSON_OBJECT_SIZE(3) + // For root: rid, reg (optional), elm
-                               JSON_OBJECT_SIZE(8) * max_log_entries + // For each entry in elm (rssi,ts,bTs,ch,lat,lon,pAlt,gAlt)
-                               JSON_ARRAY_SIZE(max_log_entries) +
-                               1024; // Extra buffer
-    DynamicJsonDocument doc(jsonDocSize);
-    JsonObject root = doc.to<JsonObject>();
-    std::vector<std::pair<int, String>> sorted_rids = getSortedRIDsByRSSI();
-    if (sorted_rids.empty() || count < 1) {
-        output_stream.print("{}");
-        output_stream.println();
-        return;
+size_t RemoteIDDataManager::getJsonForTopRSSI(int count, size_t max_log_entries, Print& output_stream) const {
+    const String* top_rid = _topRSSIRID();
+    if (top_rid == nullptr || count < 1) {
+        size_t written = output_stream.print("{}");
+        written += output_stream.println();
+        return written;
     }
-    String rid_str = sorted_rids[0].second; // Get the top RID
-    std::vector<RemoteIDEntry> entries_for_rid = getAllDataForRID(rid_str, max_log_entries);
-    // Always set rid if available
-    root["rid"] = rid_str;
+    const String& rid_str = *top_rid; // Get the top RID
+    const RIDDataContainer& container = _data_store.find(rid_str)->second;
     // Get the registration number from the overall latest entry for this RID
-    RemoteIDEntry overall_latest_entry;
-    if (getLatestEntryForRID(rid_str, overall_latest_entry)) {
-        if (!overall_latest_entry.registrationNo.isEmpty()) {
-            root["reg"] = overall_latest_entry.registrationNo;
-        }
-    }
-    JsonArray elmArray = root.createNestedArray("elm"); // Changed "entries" to "elm"
-    if (!entries_for_rid.empty()) {
-        for (const auto& entry_item : entries_for_rid) {
-            JsonObject entryObj = elmArray.createNestedObject();
-            _populateJsonEntry(entryObj, entry_item);
-        }
-    }
-    // else, elmArray will be empty, which is correct if no log entries are selected.
-    serializeJson(doc, output_stream);
-    output_stream.println();
+    // (the RSSI rank index only holds RIDs with at least one entry)
+    size_t num_to_write = 0;
+    size_t start_index = _tailRange(container, max_log_entries, num_to_write);
+    return _writeJsonForContainer(output_stream, rid_str, container.entries.back().registrationNo,
+                                  container, start_index, num_to_write, 0);
 }
 
 /**
@@ -297,46 +667,206 @@ void RemoteIDDataManager::getJsonForTopRSSI(int count, size_t max_log_entries, P
  * @param regNo 検索する機体登録記号
  * @param max_log_entries JSONに含めるデータエントリの最大数
  * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数
  */
-void RemoteIDDataManager::getJsonForRegistrationNo(const String& regNo, size_t max_log_entries, Print& output_stream) const {
-    const size_t jsonDocSize = JSON_OBJECT_SIZE(3) + // For root: rid, reg, elm
-                               JSON_OBJECT_SIZE(8) * max_log_entries + // For each entry in elm
-                               JSON_ARRAY_SIZE(max_log_entries) +
-                               1024; // Extra buffer
-    DynamicJsonDocument doc(jsonDocSize);
-    JsonObject root = doc.to<JsonObject>();
-    if (regNo.isEmpty()) {
-        output_stream.print("{}");
-        output_stream.println();
-        return;
+size_t RemoteIDDataManager::getJsonForRegistrationNo(const String& regNo, size_t max_log_entries, Print& output_stream) const {
+    if (!regNo.isEmpty()) {
+        for (const auto& pair : _data_store) {
+            const RIDDataContainer& container = pair.second;
+            // Check the latest entry's registration number
+            if (!container.entries.empty() && container.entries.back().registrationNo == regNo) {
+                size_t num_to_write = 0;
+                size_t start_index = _tailRange(container, max_log_entries, num_to_write);
+                return _writeJsonForContainer(output_stream, pair.first, regNo, container, start_index, num_to_write, 0);
+            }
+        }
     }
-    bool found = false;
-    for (const auto& pair : _data_store) {
-        const String& rid_str_from_pair = pair.first;
-        const RIDDataContainer& container = pair.second;
-        // Check the latest entry's registration number
-        if (!container.entries.empty() && container.entries.back().registrationNo == regNo) {
-            std::vector<RemoteIDEntry> entries_for_rid = getAllDataForRID(rid_str_from_pair, max_log_entries);
-            root["rid"] = rid_str_from_pair;
-            root["reg"] = regNo; // The regNo we searched for
-            JsonArray elmArray = root.createNestedArray("elm"); // Changed "entries" to "elm"
-            if (!entries_for_rid.empty()) {
-                for (const auto& entry_item : entries_for_rid) {
-                    JsonObject entryObj = elmArray.createNestedObject();
-                    _populateJsonEntry(entryObj, entry_item);
-                }
+    size_t written = output_stream.print("{}");
+    written += output_stream.println();
+    return written;
+}
+
+/**
+ * @brief 指定されたRIDの最新エントリのシーケンス番号を取得します
+ * @param rid シーケンス番号を取得したいRIDの識別子
+ * @return 最新エントリのシーケンス番号。RIDが存在しない場合は0
+ */
+uint32_t RemoteIDDataManager::getLatestSeqForRID(const String& rid) const {
+    auto it = _data_store.find(rid);
+    if (it == _data_store.end()) {
+        return 0;
+    }
+    return it->second.received_count;
+}
+
+/**
+ * @brief 指定されたRIDの、シーケンス番号が `since_seq` より新しいエントリだけをJSONとしてストリームに出力します
+ * @details RIDが存在しない場合は `{}` を出力します
+ * @param rid 出力するRIDの識別子
+ * @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+ * @param max_log_entries 1回に出力するエントリの最大数。0の場合は全件
+ * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数
+ */
+size_t RemoteIDDataManager::getJsonForRIDSince(const String& rid, uint32_t since_seq, size_t max_log_entries, Print& output_stream) const {
+    auto it = _data_store.find(rid);
+    if (it == _data_store.end() || it->second.entries.empty()) {
+        size_t written = output_stream.print("{}");
+        written += output_stream.println();
+        return written;
+    }
+    const RIDDataContainer& container = it->second;
+    size_t num_to_write = 0;
+    size_t start_index = _sinceRange(container, since_seq, max_log_entries, num_to_write);
+    return _writeJsonForContainer(output_stream, rid, container.entries.back().registrationNo,
+                                  container, start_index, num_to_write, since_seq);
+}
+
+/**
+ * @brief getJsonForRIDSince() のバイナリ (COBSフレーム) 版です
+ * @details RIDが存在しない場合はエントリ数0のフレームを出力します
+ * @param rid 出力するRIDの識別子
+ * @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+ * @param max_log_entries 1回に出力するエントリの最大数。0の場合は全件
+ * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数
+ */
+size_t RemoteIDDataManager::getBinaryForRIDSince(const String& rid, uint32_t since_seq, size_t max_log_entries, Print& output_stream) const {
+    auto it = _data_store.find(rid);
+    if (it == _data_store.end() || it->second.entries.empty()) {
+        return _writeBinaryForContainer(output_stream, rid, String(""), nullptr, 0, 0, since_seq, RID_BINARY_FLAG_LAST);
+    }
+    const RIDDataContainer& container = it->second;
+    size_t num_to_write = 0;
+    size_t start_index = _sinceRange(container, since_seq, max_log_entries, num_to_write);
+    uint8_t flags = RID_BINARY_FLAG_LAST;
+    if (start_index + num_to_write < container.entries.size()) {
+        flags |= RID_BINARY_FLAG_MORE; // max_log_entries で打ち切った
+    }
+    return _writeBinaryForContainer(output_stream, rid, container.entries.back().registrationNo,
+                                    &container, start_index, num_to_write, since_seq, flags);
+}
+
+/**
+ * @brief 分割出力 (writeExportChunk) を開始します
+ * @details この時点のリングバッファからシーケンス番号の範囲を確定し (スナップショット)、カーソルを初期化します
+ *          以降に受信したエントリは範囲に含めません
+ * @param rid 出力するRIDの識別子
+ * @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+ * @param max_log_entries 出力するエントリの最大数。`since_seq` の次から古い順に数えます。0の場合は全件
+ * @param binary trueの場合はバイナリ (COBSフレーム) 形式、falseの場合はJSON形式
+ * @param[out] cursor 初期化するカーソル
+ * @return RIDが存在すればtrue。存在しない場合もカーソルは初期化され、空の出力になります
+ */
+bool RemoteIDDataManager::beginExport(const String& rid, uint32_t since_seq, size_t max_log_entries, bool binary,
+                                      RIDExportCursor& cursor) const {
+    cursor = RIDExportCursor();
+    cursor.rid = rid;
+    cursor.binary = binary;
+    cursor.cursor_seq = since_seq;
+    auto it = _data_store.find(rid);
+    if (it == _data_store.end() || it->second.entries.empty()) {
+        return false;
+    }
+    const RIDDataContainer& container = it->second;
+    cursor.found = true;
+    cursor.regNo = container.entries.back().registrationNo;
+    size_t count = 0;
+    size_t start_index = _sinceRange(container, since_seq, max_log_entries, count);
+    if (count > 0) {
+        cursor.first_seq = _seqAt(container, start_index);
+        cursor.next_seq = cursor.first_seq;
+        cursor.last_seq = cursor.first_seq + static_cast<uint32_t>(count) - 1;
+    }
+    cursor.more_pending = start_index + count < container.entries.size(); // max_log_entries で打ち切った
+    return true;
+}
+
+/**
+ * @brief beginExport() で確定した範囲のうち、次の最大 `max_entries` 件をストリームに出力します
+ * @details 呼び出しの間はセマフォを解放してよいよう、毎回リングバッファ上の位置をシーケンス番号から求め直します
+ *          出力中にリングバッファから削除されたエントリは読み飛ばし、`cursor.skipped_entries` に数えます
+ *          JSON形式では1回目の呼び出しでオブジェクトの先頭を、範囲を出力し終えた呼び出しで末尾を出力します (全体で1つのJSON)
+ *          バイナリ形式では呼び出しごとに独立した1フレームを出力します (各フレームにカーソルが入ります)
+ *          範囲を出力し終えるフレームには RID_BINARY_FLAG_LAST を立てるため、受信側は出力の終わりを判別できます
+ * @param cursor beginExport() で初期化したカーソル
+ * @param max_entries この呼び出しで出力するエントリの最大数
+ * @param output_stream 出力ストリームを受け取る
+ * @return 出力したバイト数。`cursor.finished` がtrueになったら出力完了です
+ */
+size_t RemoteIDDataManager::writeExportChunk(RIDExportCursor& cursor, size_t max_entries, Print& output_stream) const {
+    if (cursor.finished) {
+        return 0;
+    }
+    if (!cursor.found) {
+        cursor.finished = true;
+        if (cursor.binary) {
+            return _writeBinaryForContainer(output_stream, cursor.rid, String(""), nullptr, 0, 0, cursor.cursor_seq,
+                                            RID_BINARY_FLAG_LAST);
+        }
+        size_t written = output_stream.print("{}");
+        written += output_stream.println();
+        return written;
+    }
+    // 範囲内で、まだリングバッファに残っている部分を求める
+    const RIDDataContainer* container = nullptr;
+    size_t start_index = 0;
+    size_t count = 0;
+    auto it = _data_store.find(cursor.rid);
+    if (it != _data_store.end() && !it->second.entries.empty() && cursor.next_seq <= cursor.last_seq) {
+        container = &it->second;
+        const uint32_t oldest_seq = _seqAt(*container, 0);
+        if (cursor.next_seq < oldest_seq) {
+            uint32_t evicted_end = min(oldest_seq, cursor.last_seq + 1);
+            cursor.skipped_entries += evicted_end - cursor.next_seq;
+            cursor.next_seq = evicted_end;
+        }
+        if (cursor.next_seq <= cursor.last_seq && cursor.last_seq <= container->received_count) {
+            start_index = cursor.next_seq - oldest_seq;
+            count = min(static_cast<size_t>(cursor.last_seq - cursor.next_seq + 1), max_entries);
+        }
+    }
+    if (count == 0 && cursor.next_seq <= cursor.last_seq) {
+        // RIDが削除された、またはカウンタがリセットされた場合は残りを打ち切る
+        cursor.skipped_entries += cursor.last_seq - cursor.next_seq + 1;
+        cursor.next_seq = cursor.last_seq + 1;
+    }
+
+    size_t written = 0;
+    if (cursor.binary) {
+        uint8_t flags = 0;
+        if (cursor.next_seq + count > cursor.last_seq) { // このフレームで範囲を出力し終える
+            flags = RID_BINARY_FLAG_LAST | (cursor.more_pending ? RID_BINARY_FLAG_MORE : 0);
+        }
+        written = _writeBinaryForContainer(output_stream, cursor.rid, cursor.regNo, container, start_index, count,
+                                           cursor.cursor_seq, flags);
+    } else {
+        if (!cursor.started) {
+            written += _writeJsonHeader(output_stream, cursor.rid, cursor.regNo);
+        }
+        if (count > 0) {
+            const auto first_iter = container->entries.begin() + start_index;
+            for (size_t i = 0; i < count; ++i) {
+                written += _writeJsonEntry(output_stream, *(first_iter + i), cursor.entries_written + i > 0);
             }
-            // else: elmArray will be empty, which is correct if no log entries are selected.
-            serializeJson(doc, output_stream);
-            output_stream.println();
-            found = true;
-            break;
         }
     }
-    if (!found) {
-        output_stream.print("{}");
-        output_stream.println();
+    cursor.started = true;
+    if (count > 0) {
+        if (cursor.written_first_seq == 0) {
+            cursor.written_first_seq = cursor.next_seq;
+        }
+        cursor.next_seq += static_cast<uint32_t>(count);
+        cursor.cursor_seq = cursor.next_seq - 1;
+        cursor.entries_written += count;
+    }
+    if (cursor.next_seq > cursor.last_seq) {
+        cursor.finished = true;
+        if (!cursor.binary) {
+            written += _writeJsonFooter(output_stream, cursor.written_first_seq, cursor.cursor_seq);
+        }
     }
+    return written;
 }
 
 /**
@@ -344,11 +874,10 @@ void RemoteIDDataManager::getJsonForRegistrationNo(const String& regNo, size_t m
  * @return 最新のWi-Fiチャンネル番号。該当データがない場合は-1
  */
 int RemoteIDDataManager::getLatestChannelForTopRSSI() const {
-    std::vector<std::pair<int, String>> sorted_rids = getSortedRIDsByRSSI();
-    if (!sorted_rids.empty()) {
-        String top_rid_str = sorted_rids[0].second; // RSSIが最も高いRID
+    const String* top_rid = _topRSSIRID();
+    if (top_rid != nullptr) {
         RemoteIDEntry latest_entry;
-        if (getLatestEntryForRID(top_rid_str, latest_entry)) {
+        if (getLatestEntryForRID(*top_rid, latest_entry)) {
             return latest_entry.channel; // そのRIDの最新エントリのチャンネルを返す
         }
     }
@@ -373,3 +902,39 @@ int RemoteIDDataManager::getLatestChannelForRegistrationNo(const String& regNo)
     }
     return -1; // 指定された登録記号のRIDが見つからない、またはデータがない場合
 }
+
+/**
+ * @brief 指定された登録記号を持つRIDの識別子を取得します
+ *        最初に見つかった登録記号に合致するRIDを返します
+ * @param regNo 検索する機体登録記号
+ * @return 合致したRID文字列。見つからない場合は空文字列
+ */
+String RemoteIDDataManager::getRIDForRegistrationNo(const String& regNo) const {
+    if (regNo.isEmpty()) {
+        return ""; // 登録記号が空の場合は空文字列
+    }
+    for (const auto& pair : _data_store) {
+        const RIDDataContainer& container = pair.second;
+        // 最新エントリの登録記号をチェック
+        if (!container.entries.empty() && container.entries.back().registrationNo == regNo) {
+            return pair.first;
+        }
+    }
+    return ""; // 指定された登録記号のRIDが見つからない場合
+}
+
+/**
+ * @brief 指定されたRIDの送信ビーコンレートを取得します
+ *        最新のビーコンが示すビーコン間隔 (TU = 1024マイクロ秒) から求めます
+ *        受信数から求めると、滞在時間を長く割り当てたチャンネルほど受信数が増えてさらに長く割り当てられるため、
+ *        送信側のレートを使います
+ * @param rid レートを取得したいRIDの識別子
+ * @return 送信レート (ビーコン/秒)。RIDが存在しない場合やビーコン間隔が不明な場合は0
+ */
+float RemoteIDDataManager::getBeaconRateForRID(const String& rid) const {
+    auto it = _data_store.find(rid);
+    if (it == _data_store.end() || it->second.beacon_interval_tu == 0) {
+        return 0.0f;
+    }
+    return 1000000.0f / (static_cast<float>(it->second.beacon_interval_tu) * 1024.0f);
+}
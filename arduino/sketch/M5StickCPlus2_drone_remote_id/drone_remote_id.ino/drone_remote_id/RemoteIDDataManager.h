@@ -5,10 +5,10 @@
 #include <vector>
 #include <deque>
 #include <map>
+#include <set>
 #include <algorithm> // std::sort
 #include <climits>   // INT_MIN (C++11以降)
 #include <ctime>     // time_t (C++ style)
-#include <ArduinoJson.h>
 
 /**
  * @file RemoteIDDataManager.h
@@ -47,6 +47,42 @@ struct RemoteIDEntry {
         : rssi(r), timestamp(ts), beaconTimestamp(bTs), channel(ch), registrationNo(regNo), latitude(lat), longitude(lon), pressureAltitude(pa), gpsAltitude(ga) {}
 };
 
+/// @brief RemoteIDDataManager::beginExport() / writeExportChunk() による分割出力の進行状況を保持する構造体
+///
+/// 出力範囲は開始時のシーケンス番号で確定するため、チャンクの間にセマフォを解放しても出力内容は変わりません
+struct RIDExportCursor {
+    String rid;                 ///< 出力するRIDの識別子
+    String regNo;               ///< 出力に含める登録記号 (開始時点の最新エントリのもの)
+    bool binary;                ///< trueの場合はバイナリ (COBSフレーム) 形式、falseの場合はJSON形式
+    bool found;                 ///< 開始時にRIDが存在したかどうか
+    bool started;               ///< JSONの先頭を出力済みかどうか
+    bool finished;              ///< 出力が完了したかどうか
+    uint32_t first_seq;         ///< 出力範囲の最初のシーケンス番号 (範囲が空の場合は0)
+    uint32_t next_seq;          ///< 次に出力するシーケンス番号
+    uint32_t last_seq;          ///< 出力範囲の最後のシーケンス番号 (next_seq > last_seq で範囲を出力し終えた状態)
+    uint32_t written_first_seq; ///< 実際に最初に出力したエントリのシーケンス番号 (未出力の場合は0)
+    uint32_t cursor_seq;        ///< 最後に出力したエントリのシーケンス番号 (未出力の場合は開始時の since_seq)
+    size_t entries_written;     ///< 出力したエントリ数
+    size_t skipped_entries;     ///< 出力中にリングバッファから削除されたため読み飛ばしたエントリ数
+    bool more_pending;          ///< 出力件数の上限または中止により、範囲より新しいエントリが残っているかどうか
+
+    /// @brief デフォルトコンストラクタ。空の範囲で初期化します
+    RIDExportCursor() : rid(""), regNo(""), binary(false), found(false), started(false), finished(false),
+                        first_seq(0), next_seq(1), last_seq(0), written_first_seq(0), cursor_seq(0),
+                        entries_written(0), skipped_entries(0), more_pending(false) {}
+
+    /// @brief 出力範囲の総エントリ数を取得します
+    size_t totalEntries() const { return last_seq >= first_seq && first_seq > 0 ? last_seq - first_seq + 1 : 0; }
+
+    /// @brief 出力を打ち切ります。JSON形式では次の writeExportChunk() でオブジェクトの末尾だけを出力して完了します
+    void cancel() {
+        if (next_seq > 0 && last_seq >= next_seq) {
+            last_seq = next_seq - 1;
+            more_pending = true;
+        }
+    }
+};
+
 /// @brief リモートIDデータを管理するクラス
 ///
 /// 複数のリモートID (RID) からのデータを格納し、クエリ機能を提供します
@@ -69,7 +105,9 @@ public:
     /// @param lon 経度
     /// @param pAlt 気圧高度
     /// @param gAlt GPS高度
-    void addData(const String& rid, int rssi, time_t timestamp, uint64_t beaconTimestamp, int channel, const String& registrationNo, float lat, float lon, float pAlt, float gAlt);
+    /// @param beaconIntervalTU ビーコンフレームのビーコン間隔 (TU = 1024マイクロ秒)。0の場合は不明
+    void addData(const String& rid, int rssi, time_t timestamp, uint64_t beaconTimestamp, int channel, const String& registrationNo, float lat, float lon, float pAlt, float gAlt,
+                 uint16_t beaconIntervalTU = 0);
 
     /// @brief 指定時刻から過去1分以内にデータ記録があるRIDのリストを取得します
     /// @param currentTime 現在時刻 (UNIX秒)。この時刻を基準に過去1分間を評価します
@@ -86,6 +124,21 @@ public:
     /// @return RIDの総数
     int getRIDCount() const;
 
+    /// @brief 指定されたRIDが保持しているデータエントリの数を返します (エントリのコピーは行いません)
+    /// @param rid 対象のRIDの識別子
+    /// @return 保持しているエントリ数。RIDが存在しない場合は0
+    size_t getEntryCountForRID(const String& rid) const;
+
+    /// @brief 全RIDが保持しているデータエントリの合計数を返します (リングバッファの使用量の監視用)
+    /// @return エントリの合計数
+    size_t getTotalEntryCount() const;
+
+    /// @brief データストアの内容が変わるたびに増えるバージョン番号を返します
+    /// @details 表示側は前回の値と比べるだけで、再描画が必要かどうかを判定できます
+    ///          32bitの読み出しはアトミックなため、セマフォを取得せずに呼び出しても構いません
+    /// @return データバージョン
+    uint32_t getDataVersion() const { return _data_version; }
+
     /// @brief インデックスを指定して、該当するRIDの全データ（時系列順）を取得します
     ///        インデックスは、全RIDを最新データのRSSI降順でソートした時の順位に基づきます
     /// @param index 取得したいRIDのインデックス (0から始まる)
@@ -121,19 +174,91 @@ public:
     /// @return RSSI降順、その後RID文字列昇順でソートされたペアのベクター
     std::vector<std::pair<int, String>> getSortedRIDsByRSSI() const;
 
+    /// @brief RSSI順位の範囲を指定して、{最新RSSI, RID文字列} のペアを取得します
+    ///        並び順は getSortedRIDsByRSSI() と同じです
+    /// @details addData() で差分更新しているRSSI順位インデックスを先頭から辿るだけで、全RIDのソートは行いません
+    ///          画面に表示する範囲だけを取得する用途を想定しています
+    /// @param first 取得する最初の順位 (0から始まる)
+    /// @param count 取得する最大件数
+    /// @param[out] out 取得したペアを格納するベクター (内容は置き換えられます)
+    /// @return 順位付けされているRIDの総数
+    size_t getRIDsByRSSIRank(size_t first, size_t count, std::vector<std::pair<int, String>>& out) const;
+
     /// @brief RSSIが最も高い上位 `count` 件のRIDデータを、受け取ったストリームに出力します
     ///        現状の実装では `count` は実質1として動作し、最もRSSIが高い1つのRIDのデータを返します
     /// @param count 取得する上位RIDの数 (現在は1に固定して利用されることを想定)
     /// @param max_log_entries 1つのRIDに対してJSONに含めるデータエントリの最大数
     /// @param output_stream 出力ストリームを受け取る
-    void getJsonForTopRSSI(int count, size_t max_log_entries, Print& output_stream) const;
+    /// @return 出力したバイト数
+    size_t getJsonForTopRSSI(int count, size_t max_log_entries, Print& output_stream) const;
 
     /// @brief 指定された登録記号を持つRIDのデータを、受け取ったストリームに出力します
     ///        最初に見つかった登録記号に合致するRIDのデータを返します
     /// @param regNo 検索する機体登録記号
     /// @param max_log_entries JSONに含めるデータエントリの最大数
     /// @param output_stream 出力ストリームを受け取る
-    void getJsonForRegistrationNo(const String& regNo, size_t max_log_entries, Print& output_stream) const;
+    /// @return 出力したバイト数
+    size_t getJsonForRegistrationNo(const String& regNo, size_t max_log_entries, Print& output_stream) const;
+
+    /// @brief RSSIが最も高いRIDのデータを、COBSフレームのバイナリ形式でストリームに出力します
+    ///        フレーム形式は RIDBinaryExport.h を参照してください。該当RIDがない場合はエントリ数0のフレームを出力します
+    /// @param max_log_entries フレームに含めるデータエントリの最大数
+    /// @param output_stream 出力ストリームを受け取る
+    /// @return 出力したバイト数
+    size_t getBinaryForTopRSSI(size_t max_log_entries, Print& output_stream) const;
+
+    /// @brief 指定された登録記号を持つRIDのデータを、COBSフレームのバイナリ形式でストリームに出力します
+    ///        最初に見つかった登録記号に合致するRIDのデータを出力します
+    /// @param regNo 検索する機体登録記号
+    /// @param max_log_entries フレームに含めるデータエントリの最大数
+    /// @param output_stream 出力ストリームを受け取る
+    /// @return 出力したバイト数
+    size_t getBinaryForRegistrationNo(const String& regNo, size_t max_log_entries, Print& output_stream) const;
+
+    /// @brief 指定されたRIDの最新エントリのシーケンス番号を取得します
+    ///        シーケンス番号はRIDごとに1から始まり、エントリを受信するたびに1ずつ増える単調増加の値です
+    ///        リングバッファから削除されたエントリの分も番号は進みます
+    /// @param rid シーケンス番号を取得したいRIDの識別子
+    /// @return 最新エントリのシーケンス番号。RIDが存在しない場合は0
+    uint32_t getLatestSeqForRID(const String& rid) const;
+
+    /// @brief 指定されたRIDの、シーケンス番号が `since_seq` より新しいエントリだけをJSONとしてストリームに出力します
+    ///        ホストが前回受け取った "seq" をカーソルとして渡すことで、差分だけを取得できます
+    ///        `since_seq` が最新のシーケンス番号より大きい場合 (デバイスの再起動などでリセットされた場合) は、保持している全エントリを対象にします
+    /// @param rid 出力するRIDの識別子
+    /// @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+    /// @param max_log_entries 1回に出力するエントリの最大数。超えた分は古い順に切り出し、残りは次回のカーソルで取得します。0の場合は全件
+    /// @param output_stream 出力ストリームを受け取る
+    /// @return 出力したバイト数
+    size_t getJsonForRIDSince(const String& rid, uint32_t since_seq, size_t max_log_entries, Print& output_stream) const;
+
+    /// @brief getJsonForRIDSince() のバイナリ (COBSフレーム) 版です
+    /// @param rid 出力するRIDの識別子
+    /// @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+    /// @param max_log_entries 1回に出力するエントリの最大数。0の場合は全件
+    /// @param output_stream 出力ストリームを受け取る
+    /// @return 出力したバイト数
+    size_t getBinaryForRIDSince(const String& rid, uint32_t since_seq, size_t max_log_entries, Print& output_stream) const;
+
+    /// @brief 分割出力を開始します。この時点のリングバッファから出力するシーケンス番号の範囲を確定します
+    ///        以降は writeExportChunk() を `cursor.finished` がtrueになるまで呼び出します
+    ///        各呼び出しの間はセマフォを解放してよいので、シリアル送信待ちの間も受信処理を止めません
+    /// @param rid 出力するRIDの識別子
+    /// @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+    /// @param max_log_entries 出力するエントリの最大数。0の場合は全件
+    /// @param binary trueの場合はバイナリ (COBSフレーム) 形式、falseの場合はJSON形式
+    /// @param[out] cursor 初期化するカーソル
+    /// @return RIDが存在すればtrue
+    bool beginExport(const String& rid, uint32_t since_seq, size_t max_log_entries, bool binary, RIDExportCursor& cursor) const;
+
+    /// @brief beginExport() で確定した範囲のうち、次の最大 `max_entries` 件をストリームに出力します
+    ///        JSON形式では全チャンクを連結して1つのJSONになり、バイナリ形式ではチャンクごとに1フレームになります
+    ///        (最後のフレームに RID_BINARY_FLAG_LAST、続きがある場合は RID_BINARY_FLAG_MORE も立てます)
+    /// @param cursor beginExport() で初期化したカーソル
+    /// @param max_entries この呼び出しで出力するエントリの最大数
+    /// @param output_stream 出力ストリームを受け取る
+    /// @return 出力したバイト数
+    size_t writeExportChunk(RIDExportCursor& cursor, size_t max_entries, Print& output_stream) const;
 
     /// @brief RSSIが最も高いRIDの最新データが受信されたWi-Fiチャンネルを取得します
     /// @return 最新のWi-Fiチャンネル番号。該当データがない場合は-1
@@ -144,6 +269,18 @@ public:
     /// @return 最新のWi-Fiチャンネル番号。該当データがない場合は-1
     int getLatestChannelForRegistrationNo(const String& regNo) const;
 
+    /// @brief 指定された登録記号を持つRIDの識別子を取得します
+    ///        最初に見つかった登録記号に合致するRIDを返します
+    /// @param regNo 検索する機体登録記号
+    /// @return 合致したRID文字列。見つからない場合は空文字列
+    String getRIDForRegistrationNo(const String& regNo) const;
+
+    /// @brief 指定されたRIDの送信ビーコンレートを取得します
+    ///        最新のビーコンが示すビーコン間隔から求めるため、受信できた数 (そのチャンネルに滞在した時間) には左右されません
+    /// @param rid レートを取得したいRIDの識別子
+    /// @return 送信レート (ビーコン/秒)。RIDが存在しない場合やビーコン間隔が不明な場合は0
+    float getBeaconRateForRID(const String& rid) const;
+
 private:
     /// @brief RIDごとのデータと設定を保持する内部構造体
     ///
@@ -154,10 +291,12 @@ private:
         size_t max_size;                   ///< このコンテナが保持できるデータエントリの最大数
         int latest_rssi;                   ///< 最新データエントリのRSSI値 (ソート用)
         time_t latest_timestamp;           ///< 最新データエントリのタイムスタンプ (フィルタリング用)
+        uint16_t beacon_interval_tu;       ///< 最新のビーコンのビーコン間隔 (TU)。0の場合は不明
+        uint32_t received_count;           ///< これまでに受信したデータエントリの総数 (リングバッファから削除された分も含む)
 
         /// @brief RIDDataContainerのコンストラクタ
         /// @param maxSize このコンテナが保持するエントリの最大数
-        RIDDataContainer(size_t maxSize) : max_size(maxSize), latest_rssi(INT_MIN), latest_timestamp(0) {}
+        RIDDataContainer(size_t maxSize) : max_size(maxSize), latest_rssi(INT_MIN), latest_timestamp(0), beacon_interval_tu(0), received_count(0) {}
 
         /// @brief 新しいデータエントリをコンテナに追加します
         ///        エントリ数が `max_size` を超える場合は、最も古いエントリが削除されます
@@ -172,6 +311,7 @@ private:
                 latest_rssi = entries.back().rssi;
                 latest_timestamp = entries.back().timestamp;
             }
+            received_count++;
         }
     };
 
@@ -185,6 +325,26 @@ private:
     ///        これが主要なデータストアとなります
     std::map<String, RIDDataContainer> _data_store;
 
+    /// @brief RSSI順位インデックスのキー
+    ///        RSSIの降順、RSSIが同じ場合はRID文字列の昇順に並びます
+    struct RSSIRankKey {
+        int rssi;           ///< 最新データエントリのRSSI値
+        const String* rid;  ///< _data_store のキー (std::mapの要素は削除されるまでアドレスが変わらない)
+
+        bool operator<(const RSSIRankKey& other) const {
+            if (rssi != other.rssi) {
+                return rssi > other.rssi; // RSSI降順
+            }
+            return *rid < *other.rid; // RSSIが同じ場合はRID文字列で昇順
+        }
+    };
+
+    /// @brief エントリを持つ全RIDのRSSI順位インデックス
+    ///        addData() で最新RSSIが変わったRIDだけを付け替えるため、順位の参照にソートは不要です
+    std::set<RSSIRankKey> _rssi_rank;
+
+    volatile uint32_t _data_version; ///< データストアの内容が変わるたびに増えるバージョン番号
+
     /// @brief 指定されたRIDが `_target_rid_value` と一致するかどうかを判定するヘルパーメソッド
     /// @param rid 判定するRIDの識別子
     /// @return `_target_rid_value` と一致すればtrue、そうでなければfalse
@@ -192,11 +352,85 @@ private:
         return rid == _target_rid_value;
     }
 
-    /// @brief RemoteIDEntryの内容をJsonObjectに格納するプライベートヘルパーメソッド
+    /// @brief RSSIが最も高いRIDを取得します
+    /// @return RID文字列へのポインタ (_data_store のキー)。RIDがない場合はnullptr
+    const String* _topRSSIRID() const {
+        return _rssi_rank.empty() ? nullptr : _rssi_rank.begin()->rid;
+    }
+
+    /// @brief 1つのRemoteIDEntryをJSONオブジェクトとしてストリームへ出力するプライベートヘルパーメソッド
     ///        JSONのキー名は短縮形を使用します
-    /// @param jsonObj 格納先のJsonObject
-    /// @param entry 格納するRemoteIDEntryデータ
-    void _populateJsonEntry(JsonObject jsonObj, const RemoteIDEntry& entry) const;
+    /// @param output_stream 出力先ストリーム
+    /// @param entry 出力するRemoteIDEntryデータ
+    /// @param leading_comma trueの場合、オブジェクトの前に配列要素の区切り `,` を付けます
+    /// @return 出力したバイト数
+    size_t _writeJsonEntry(Print& output_stream, const RemoteIDEntry& entry, bool leading_comma) const;
+
+    /// @brief コンテナ内の指定位置のエントリのシーケンス番号を計算するヘルパーメソッド
+    ///        エントリは連番で格納されるため、受信総数と位置から求まります (エントリごとに番号は保持しません)
+    /// @param container 対象のデータコンテナ
+    /// @param index entries内の位置 (0が最も古いエントリ)
+    /// @return シーケンス番号
+    static uint32_t _seqAt(const RIDDataContainer& container, size_t index) {
+        return container.received_count - static_cast<uint32_t>(container.entries.size()) + 1 + static_cast<uint32_t>(index);
+    }
+
+    /// @brief 最新の `max_log_entries` 件を出力する場合の開始位置を計算するヘルパーメソッド
+    /// @param container 対象のデータコンテナ
+    /// @param max_log_entries 出力するエントリの最大数。0の場合は全件
+    /// @param[out] count 出力するエントリ数
+    /// @return entries内の開始位置
+    static size_t _tailRange(const RIDDataContainer& container, size_t max_log_entries, size_t& count);
+
+    /// @brief シーケンス番号が `since_seq` より新しいエントリを古い順に出力する場合の範囲を計算するヘルパーメソッド
+    /// @param container 対象のデータコンテナ
+    /// @param since_seq ホストが受信済みの最後のシーケンス番号
+    /// @param max_log_entries 出力するエントリの最大数。0の場合は全件
+    /// @param[out] count 出力するエントリ数
+    /// @return entries内の開始位置
+    static size_t _sinceRange(const RIDDataContainer& container, uint32_t since_seq, size_t max_log_entries, size_t& count);
+
+    /// @brief JSONオブジェクトの先頭 (`{"rid":..,"reg":..,"elm":[`) をストリームへ出力するプライベートヘルパーメソッド
+    /// @param output_stream 出力先ストリーム
+    /// @param rid 出力するRIDの識別子
+    /// @param regNo ルートに出力する登録記号。空の場合は "reg" キーを省略します
+    /// @return 出力したバイト数
+    size_t _writeJsonHeader(Print& output_stream, const String& rid, const String& regNo) const;
+
+    /// @brief JSONオブジェクトの末尾 (`],"from":..,"seq":..}` と改行) をストリームへ出力するプライベートヘルパーメソッド
+    /// @param output_stream 出力先ストリーム
+    /// @param from_seq 最初に出力したエントリのシーケンス番号。0の場合は "from" キーを省略します
+    /// @param cursor_seq 次回の差分取得に使うカーソル
+    /// @return 出力したバイト数
+    size_t _writeJsonFooter(Print& output_stream, uint32_t from_seq, uint32_t cursor_seq) const;
+
+    /// @brief 1つのRIDのデータをJSONとしてストリームへ逐次出力するプライベートヘルパーメソッド
+    ///        DynamicJsonDocumentを構築せず、リングバッファから1エントリずつ直接書き出します
+    /// @param output_stream 出力先ストリーム
+    /// @param rid 出力するRIDの識別子
+    /// @param regNo ルートに出力する登録記号。空の場合は "reg" キーを省略します
+    /// @param container 出力するRIDのデータコンテナ
+    /// @param start_index 出力を開始するentries内の位置
+    /// @param count 出力するエントリ数
+    /// @param cursor_seq エントリが0件の場合にルートの "seq" として返すカーソル値
+    /// @return 出力したバイト数
+    size_t _writeJsonForContainer(Print& output_stream, const String& rid, const String& regNo,
+                                  const RIDDataContainer& container, size_t start_index, size_t count,
+                                  uint32_t cursor_seq) const;
+
+    /// @brief 1つのRIDのデータをバイナリフレームとしてストリームへ逐次出力するプライベートヘルパーメソッド
+    /// @param output_stream 出力先ストリーム
+    /// @param rid 出力するRIDの識別子 (空の場合はエントリ数0のフレーム)
+    /// @param regNo フレームのヘッダに格納する登録記号
+    /// @param container 出力するRIDのデータコンテナ。nullptrの場合はエントリ数0のフレーム
+    /// @param start_index 出力を開始するentries内の位置
+    /// @param count 出力するエントリ数
+    /// @param cursor_seq エントリが0件の場合にヘッダの "seq" として返すカーソル値
+    /// @param flags ヘッダに格納するフラグ (RID_BINARY_FLAG_*)
+    /// @return 出力したバイト数
+    size_t _writeBinaryForContainer(Print& output_stream, const String& rid, const String& regNo,
+                                    const RIDDataContainer* container, size_t start_index, size_t count,
+                                    uint32_t cursor_seq, uint8_t flags) const;
 };
 
 #endif // REMOTE_ID_DATA_MANAGER_H
\ No newline at end of file
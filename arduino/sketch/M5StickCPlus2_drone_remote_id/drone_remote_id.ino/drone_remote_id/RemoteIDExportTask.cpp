@@ -0,0 +1,162 @@
+/**
+ * @file RemoteIDExportTask.cpp
+ * @brief RemoteIDExportTaskクラスの実装ファイル
+ */
+#include "RemoteIDExportTask.h"
+#include <M5Unified.h>
+
+/**
+ * @brief コンストラクタ
+ * @param dataManager 出力するデータを保持するRemoteIDDataManager
+ * @param semaphore dataManagerへのアクセスを保護するセマフォ
+ * @param output 出力先のシリアル
+ * @param telemetry チャンクの書き出し時間と出力全体の時間を記録する先 (nullptrの場合は記録しない)
+ */
+RemoteIDExportTask::RemoteIDExportTask(RemoteIDDataManager& dataManager, SemaphoreHandle_t& semaphore, HardwareSerial& output,
+                                       RIDTelemetry* telemetry)
+    : _dataManager(dataManager), _semaphore(semaphore), _out(output), _telemetry(telemetry), _task(nullptr),
+      _running(false), _cancelRequested(false), _totalEntries(0), _doneEntries(0), _bytesSent(0) {
+}
+
+/**
+ * @brief 出力タスクを作成します
+ * @param priority タスクの優先度
+ * @param core タスクを実行するコア
+ * @return 作成に成功すればtrue
+ */
+bool RemoteIDExportTask::begin(UBaseType_t priority, BaseType_t core) {
+    if (_task != nullptr) {
+        return true;
+    }
+    return xTaskCreatePinnedToCore(_taskEntry, "ridExport", STACK_SIZE, this, priority, &_task, core) == pdPASS;
+}
+
+/**
+ * @brief 出力を開始します
+ * @details セマフォを取得して出力範囲を確定させたあと、タスクへ通知します。シリアルへの送信はタスク側で行います
+ * @param rid 出力するRIDの識別子
+ * @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+ * @param max_log_entries 出力するエントリの最大数。0の場合は全件
+ * @param binary trueの場合はバイナリ (COBSフレーム) 形式、falseの場合はJSON形式
+ * @return 開始できればtrue
+ */
+bool RemoteIDExportTask::start(const String& rid, uint32_t since_seq, size_t max_log_entries, bool binary) {
+    if (_task == nullptr || _running) {
+        return false;
+    }
+    if (xSemaphoreTake(_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;
+    }
+    _dataManager.beginExport(rid, since_seq, max_log_entries, binary, _cursor);
+    xSemaphoreGive(_semaphore);
+    _totalEntries = _cursor.totalEntries();
+    _doneEntries = 0;
+    _bytesSent = 0;
+    _cancelRequested = false;
+    _running = true;
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+/**
+ * @brief 出力の中止を要求します
+ */
+void RemoteIDExportTask::cancel() {
+    if (_running) {
+        _cancelRequested = true;
+    }
+}
+
+/**
+ * @brief 出力の進捗を取得します
+ * @return 0～100 (%)
+ */
+uint8_t RemoteIDExportTask::getProgressPercent() const {
+    size_t total = _totalEntries;
+    if (total == 0) {
+        return _running ? 0 : 100;
+    }
+    return (uint8_t)min((size_t)100, _doneEntries * 100 / total);
+}
+
+/**
+ * @brief FreeRTOSタスクのエントリポイント
+ * @param arg RemoteIDExportTaskのインスタンス
+ */
+void RemoteIDExportTask::_taskEntry(void* arg) {
+    static_cast<RemoteIDExportTask*>(arg)->_run();
+}
+
+/**
+ * @brief タスク本体。start()からの通知を待ち、1回分の出力を行います
+ */
+void RemoteIDExportTask::_run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        _export();
+        _running = false;
+    }
+}
+
+/**
+ * @brief 1回分の出力を最後まで行います
+ * @details 出力中は、ログの文字列がJSONやCOBSフレームの途中に混ざらないようにシリアルへのログ出力を止めます
+ *          (フレームはTXバッファの空きに合わせて分けて書くため、区切りの間にログが入るとそのフレームが壊れます)
+ */
+void RemoteIDExportTask::_export() {
+    const esp_log_level_t saved_level = M5.Log.getLogLevel(m5::log_target_serial);
+    M5.Log.setLogLevel(m5::log_target_serial, ESP_LOG_NONE);
+    const size_t chunk_entries = _cursor.binary ? BINARY_CHUNK_ENTRIES : JSON_CHUNK_ENTRIES;
+    const unsigned long start_ms = millis();
+    bool cancelled = false;
+    _chunk.resetOverflow();
+    while (!_cursor.finished) {
+        if (_cancelRequested && !cancelled) {
+            _cursor.cancel();
+            cancelled = true;
+        }
+        if (xSemaphoreTake(_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
+            continue; // スニッファ側が保持中。次の機会に再試行
+        }
+        const uint32_t chunk_start_us = micros();
+        _chunk.clear();
+        _dataManager.writeExportChunk(_cursor, chunk_entries, _chunk);
+        xSemaphoreGive(_semaphore);
+        if (_telemetry) {
+            _telemetry->record(RIDTelemetry::EXPORT_CHUNK_US, micros() - chunk_start_us); // セマフォを保持していた時間
+        }
+        _drainChunk();
+        _doneEntries = _cursor.entries_written + _cursor.skipped_entries;
+    }
+    M5.Log.setLogLevel(m5::log_target_serial, saved_level);
+    if (_telemetry) {
+        _telemetry->record(RIDTelemetry::EXPORT_MS, millis() - start_ms);
+    }
+    M5.Log.printf("%s export %s: RID '%s', %u entries (%u skipped), %u bytes in %lu ms\n",
+                  _cursor.binary ? "Binary" : "JSON", cancelled ? "cancelled" : "done",
+                  _cursor.rid.c_str(), _cursor.entries_written, _cursor.skipped_entries,
+                  _bytesSent, millis() - start_ms);
+    if (_chunk.overflowed()) {
+        M5.Log.println("[ERROR] Export chunk buffer overflowed. Output is truncated.");
+    }
+}
+
+/**
+ * @brief チャンクバッファの内容を、シリアルのTXバッファの空きに合わせて送信します
+ * @details TXバッファが一杯の間は1tickずつ待つため、送信待ちでCPUを占有しません
+ */
+void RemoteIDExportTask::_drainChunk() {
+    const uint8_t* data = _chunk.data();
+    size_t remaining = _chunk.length();
+    while (remaining > 0) {
+        int space = _out.availableForWrite();
+        if (space <= 0) {
+            vTaskDelay(1);
+            continue;
+        }
+        size_t n = _out.write(data, min(remaining, (size_t)space));
+        data += n;
+        remaining -= n;
+        _bytesSent += n;
+    }
+}
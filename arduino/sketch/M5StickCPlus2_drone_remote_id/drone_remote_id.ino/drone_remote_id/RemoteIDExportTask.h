@@ -0,0 +1,119 @@
+#ifndef REMOTE_ID_EXPORT_TASK_H
+#define REMOTE_ID_EXPORT_TASK_H
+
+#include <Arduino.h>
+#include "RemoteIDDataManager.h"
+#include "RIDTelemetry.h"
+
+/**
+ * @file RemoteIDExportTask.h
+ * @brief リモートID履歴のJSON/バイナリ出力をバックグラウンドで行うRemoteIDExportTaskクラスの定義
+ */
+
+/**
+ * @class RemoteIDExportTask
+ * @brief リモートID履歴のシリアル出力を専用のFreeRTOSタスクで行うクラス
+ *
+ * 出力範囲は開始時のシーケンス番号で確定し (スナップショット)、数エントリずつチャンクバッファへ書き出します
+ * セマフォを保持するのはチャンクバッファへの書き出し中だけで、シリアルへの送信はセマフォを解放してから
+ * TXバッファの空きに合わせて行うため、出力中もスニッファ・チャンネル切り替え・画面更新は止まりません
+ */
+class RemoteIDExportTask {
+public:
+    /// @brief コンストラクタ
+    /// @param dataManager 出力するデータを保持するRemoteIDDataManager
+    /// @param semaphore dataManagerへのアクセスを保護するセマフォ (setup()で作成されるため参照で受け取る)
+    /// @param output 出力先のシリアル
+    /// @param telemetry チャンクの書き出し時間と出力全体の時間を記録する先 (nullptrの場合は記録しない)
+    RemoteIDExportTask(RemoteIDDataManager& dataManager, SemaphoreHandle_t& semaphore, HardwareSerial& output,
+                       RIDTelemetry* telemetry = nullptr);
+
+    /// @brief 出力タスクを作成します
+    /// @param priority タスクの優先度
+    /// @param core タスクを実行するコア
+    /// @return 作成に成功すればtrue
+    bool begin(UBaseType_t priority = 1, BaseType_t core = 1);
+
+    /// @brief 出力を開始します。出力範囲はこの時点のリングバッファから確定します
+    /// @param rid 出力するRIDの識別子
+    /// @param since_seq ホストが受信済みの最後のシーケンス番号 (0の場合は保持している全エントリ)
+    /// @param max_log_entries 出力するエントリの最大数。0の場合は全件
+    /// @param binary trueの場合はバイナリ (COBSフレーム) 形式、falseの場合はJSON形式
+    /// @return 開始できればtrue。出力中、またはセマフォを取得できなかった場合はfalse
+    bool start(const String& rid, uint32_t since_seq, size_t max_log_entries, bool binary);
+
+    /// @brief 出力の中止を要求します。JSON形式では、それまでに出力したエントリで閉じた有効なJSONになります
+    void cancel();
+
+    /// @brief 出力中かどうかを取得します
+    bool isRunning() const { return _running; }
+
+    /// @brief 出力の進捗を取得します
+    /// @return 0～100 (%)
+    uint8_t getProgressPercent() const;
+
+    /// @brief 最後に開始した出力でシリアルへ送信したバイト数を取得します
+    size_t getBytesSent() const { return _bytesSent; }
+
+private:
+    /// @brief チャンク1回分の出力を溜める固定長バッファ
+    class ChunkBuffer : public Print {
+    public:
+        ChunkBuffer() : _len(0), _overflow(false) {}
+        size_t write(uint8_t b) override {
+            if (_len >= sizeof(_buf)) {
+                _overflow = true;
+                return 0;
+            }
+            _buf[_len++] = b;
+            return 1;
+        }
+        size_t write(const uint8_t* data, size_t len) override {
+            size_t n = min(len, sizeof(_buf) - _len);
+            memcpy(_buf + _len, data, n);
+            _len += n;
+            if (n < len) _overflow = true;
+            return n;
+        }
+        void clear() { _len = 0; }
+        const uint8_t* data() const { return _buf; }
+        size_t length() const { return _len; }
+        bool overflowed() const { return _overflow; }
+        void resetOverflow() { _overflow = false; }
+    private:
+        uint8_t _buf[2048]; ///< JSON 1エントリは最大256バイトなので、JSON_CHUNK_ENTRIES件とヘッダが収まる大きさ
+        size_t _len;
+        bool _overflow;
+    };
+
+    static const size_t JSON_CHUNK_ENTRIES = 6;    ///< JSON形式で1チャンクに書き出すエントリ数
+    static const size_t BINARY_CHUNK_ENTRIES = 32; ///< バイナリ形式で1チャンク (1フレーム) に書き出すエントリ数
+    static const uint32_t STACK_SIZE = 4096;       ///< タスクのスタックサイズ (バイト)
+
+    RemoteIDDataManager& _dataManager;  ///< 出力するデータを保持するRemoteIDDataManager
+    SemaphoreHandle_t& _semaphore;      ///< dataManagerへのアクセスを保護するセマフォ
+    HardwareSerial& _out;               ///< 出力先のシリアル
+    RIDTelemetry* _telemetry;           ///< 計測値の記録先 (nullptrの場合は記録しない)
+    TaskHandle_t _task;                 ///< 出力タスクのハンドル
+    RIDExportCursor _cursor;            ///< 出力中の範囲と進行状況 (start()で初期化し、以降はタスクだけが更新)
+    ChunkBuffer _chunk;                 ///< チャンクバッファ
+    volatile bool _running;             ///< 出力中かどうか
+    volatile bool _cancelRequested;     ///< 中止が要求されたかどうか
+    volatile size_t _totalEntries;      ///< 出力範囲の総エントリ数 (進捗表示用)
+    volatile size_t _doneEntries;       ///< 出力済み (読み飛ばしを含む) のエントリ数 (進捗表示用)
+    volatile size_t _bytesSent;         ///< シリアルへ送信したバイト数
+
+    /// @brief FreeRTOSタスクのエントリポイント
+    static void _taskEntry(void* arg);
+
+    /// @brief タスク本体。start()からの通知を待ち、1回分の出力を行います
+    void _run();
+
+    /// @brief 1回分の出力を最後まで行います
+    void _export();
+
+    /// @brief チャンクバッファの内容を、シリアルのTXバッファの空きに合わせて送信します
+    void _drainChunk();
+};
+
+#endif // REMOTE_ID_EXPORT_TASK_H
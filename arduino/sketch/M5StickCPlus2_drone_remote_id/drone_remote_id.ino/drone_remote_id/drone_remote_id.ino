@@ -23,12 +23,27 @@
 #include "nvs_flash.h"         // ESP-IDF Non-Volatile Storage (未使用だが標準的にインクルードされることあり)
 #include "RemoteIDDataManager.h" // カスタムクラス: リモートIDデータを管理
 #include "M5CanvasTextDisplayController.h" // カスタムクラス: M5GFXのCanvasを使ったテキスト表示制御
+#include "RemoteIDExportTask.h"          // カスタムクラス: JSON/バイナリ出力をバックグラウンドで行うタスク
+#include "RIDTelemetry.h"                // カスタムクラス: 処理時間・キュー深さ・ヒープ残量のヒストグラム
 
 #define WIFI_CHANNEL_SWITCH_INTERVAL  (500)  ///< Wi-Fiチャンネルを切り替える間隔 (ミリ秒)
 #define WIFI_CHANNEL_MAX               (13)  ///< スキャンするWi-Fiチャンネルの最大数 (日本の一般的なチャンネルは1-13ch)
 #define MAX_SSID_LEN                   (32)  ///< SSIDの最大長 (esp_wifi_types.hに基づく)
 #define SEND_MODE_TOP_RSSI 1               ///< JSON送信モード制御フラグ。1: RSSI上位1件のデータを送信, 0: 指定登録記号のデータを送信
                                            // SEND_MODE_TOP_RSSI を 0 にすると指定登録記号モードになります
+#define DISPLAY_FRAME_STATS 0              ///< 1: 表示の転送コスト (show()の統計) を定期的にログ出力する
+#define DISPLAY_FRAME_STATS_INTERVAL 10000 ///< 表示の転送コストをログ出力する間隔 (ミリ秒)
+#define UI_FRAME_INTERVAL 50               ///< UIフレームスケジューラが再描画の要否を確認する周期 (ミリ秒)。最大フレームレートを決める
+#define UI_TIMER_FIELD_INTERVAL 1000       ///< 表示内容に変化がなくても、ヒープ残量などのタイマー表示を更新する周期 (ミリ秒)
+#define UI_DEBUG_OVERLAY 0                 ///< 1: 画面の最下行にUIフレームの描画時間とスキップ数を表示する
+#define DISPLAY_GLYPH_BENCHMARK 0          ///< 1: 起動時に文字描画の速度 (グリフキャッシュ有り/無し) を測定してログ出力する
+#define RADAR_RANGE_M 1000                 ///< レーダー表示の半径 (メートル)。表示領域の短辺の半分がこの距離になる
+#define RADAR_USE_HOME_POINT 0             ///< レーダー表示の中心。1: 固定地点 (RADAR_HOME_LAT/LON), 0: RSSI最大のRID (位置を持つもの)
+#define RADAR_HOME_LAT 35.681236           ///< レーダー表示の中心とする固定地点の緯度 (RADAR_USE_HOME_POINT == 1 の場合)
+#define RADAR_HOME_LON 139.767125          ///< レーダー表示の中心とする固定地点の経度 (RADAR_USE_HOME_POINT == 1 の場合)
+#define TELEMETRY_SAMPLE_INTERVAL 1000     ///< ヒープ残量とキュー深さ (RID数・エントリ数) をテレメトリに記録する周期 (ミリ秒)
+#define SEND_FORMAT_BINARY 0               ///< 送信フォーマット制御フラグ。1: COBSフレームのバイナリ形式 (RIDBinaryExport.h), 0: JSON形式
+                                           // バイナリ形式は tools/rid_binary_decode.py でJSON/CSVに変換できます
 
 const char* TARGET_REG_NO_FOR_JSON = "JA.TEST012345"; ///< 指定登録記号モードの場合にJSON送信対象とする登録記号
 const size_t MAX_ENTRIES_IN_JSON = 400; ///< 1つのRIDに対してJSONに含める履歴データの最大エントリ数 (メモリ使用量に影響)
@@ -39,17 +54,89 @@ M5CanvasTextDisplayController* displayController_ptr = nullptr; ///< ディス
 static wifi_country_t wifi_country = {.cc = "JP", .schan = 1, .nchan = WIFI_CHANNEL_MAX};
 int channel = 1; ///< 現在スキャン中のWi-Fiチャンネル
 SemaphoreHandle_t dataManagerSemaphore; ///< dataManagerへのアクセスを保護するためのセマフォ
+RIDTelemetry telemetry; ///< 処理時間・キュー深さ・ヒープ残量のヒストグラム (デバッグページとシリアルコマンド `telemetry` で確認)
+RemoteIDExportTask exportTask(dataManager, dataManagerSemaphore, Serial, &telemetry); ///< JSON/バイナリ出力をバックグラウンドで行うタスク
 const uint8_t ASTM_OUI[] = {0xFA, 0x0B, 0xBC};      ///< ASTM規格でリモートIDに使われるOUI (Organizationally Unique Identifier)
 const uint8_t ASTM_OUI_TYPE_RID = 0x0D;           ///< ASTM OUI内のリモートIDを示すタイプ値
 const int HEADER_LINES = 2;         ///< 画面表示のヘッダ情報が使用する行数 (例: "Ch: RIDs: Heap:", "-------")
 const int LINES_PER_RID_ENTRY = 5;  ///< 1つのRID情報を表示するために必要な行数
 int max_rids_to_display_calculated = 0; ///< 画面に表示可能な最大RIDエントリ数 (setup時に計算)
+size_t uiListFirstRank = 0;             ///< RID一覧の表示開始順位 (RSSI順位、ボタンBのクリックでページ送り)
+const size_t RADAR_MAX_BLIPS = 32;      ///< レーダー表示に描画するRIDの最大数 (RSSI上位から)
+const int RADAR_CELL_W = 6;             ///< 文字セルの幅 (レーダー表示の縦横比の補正用、フォント0の比率)
+const int RADAR_CELL_H = 8;             ///< 文字セルの高さ (レーダー表示の縦横比の補正用、フォント0の比率)
+const int RADAR_CIRCLE_POINTS = 64;     ///< レーダー表示の距離円 (半径 RADAR_RANGE_M) の分割数
+
+/** @brief 画面の表示モード (ボタンAの長押しで切り替え) */
+enum UiView {
+    UI_VIEW_LIST,   ///< RID一覧 (RSSI順)
+    UI_VIEW_RADAR,    ///< レーダー表示 (中心からの相対位置)
+    UI_VIEW_TELEMETRY ///< テレメトリのデバッグページ
+};
+UiView uiView = UI_VIEW_LIST; ///< 現在の表示モード
+
+/**
+ * @struct UiStateKey
+ * @brief 画面に表示する状態の要約。UIフレームスケジューラは前回描画時の要約と異なる場合だけ再描画する
+ */
+struct UiStateKey {
+    uint32_t dataVersion = 0;   ///< dataManagerのデータバージョン
+    uint32_t timerTick = 0;     ///< タイマー表示 (ヒープ残量) の更新周期の番号
+    int channel = 0;            ///< スキャン中のチャンネル
+    int lockedChannel = -1;     ///< 固定中のチャンネル
+    int scheduleLen = 0;        ///< チャンネル固定モードのラウンドロビン対象のチャンネル数
+    bool lockMode = false;      ///< チャンネル固定モードが有効かどうか
+    int exportProgress = -1;    ///< 出力の進捗 (%)。出力中でない場合は-1
+    size_t listFirstRank = 0;   ///< RID一覧の表示開始順位
+    UiView view = UI_VIEW_LIST; ///< 表示モード
+
+    bool operator==(const UiStateKey& other) const {
+        return dataVersion == other.dataVersion && timerTick == other.timerTick &&
+               channel == other.channel && lockedChannel == other.lockedChannel &&
+               scheduleLen == other.scheduleLen && lockMode == other.lockMode &&
+               exportProgress == other.exportProgress && listFirstRank == other.listFirstRank &&
+               view == other.view;
+    }
+};
+
+/**
+ * @struct UiFrameStats
+ * @brief UIフレームスケジューラの統計情報 (デバッグオーバーレイとログ出力用)
+ */
+struct UiFrameStats {
+    uint32_t frames = 0;       ///< 再描画したフレーム数
+    uint32_t skipped = 0;      ///< 状態が変わっていなかったため再描画しなかった確認周期の数
+    uint32_t lastFrameUs = 0;  ///< 直近のフレームの描画時間 (マイクロ秒)
+    uint32_t maxFrameUs = 0;   ///< フレームの最大描画時間 (マイクロ秒)
+};
+UiFrameStats uiFrameStats; ///< UIフレームスケジューラの統計情報
 
 // --- チャンネル固定モード用変数 ---
 bool channelLockModeActive = false; ///< チャンネル固定モードが有効かどうかのフラグ
 int lockedChannel = -1;             ///< 固定中のチャンネル番号 (-1の場合は固定されていない)
 unsigned long lastChannelLockCheck = 0; ///< チャンネル固定モード時にターゲットチャンネルを再確認した最後の時刻
 const unsigned long CHANNEL_LOCK_CHECK_INTERVAL = 5000; ///< チャンネル固定モード時にターゲットチャンネルを再確認する間隔 (ミリ秒)
+const size_t CHANNEL_LOCK_MAX_TARGETS = 4;             ///< ウォッチリストが空の場合に追跡するRSSI上位RIDの最大数
+const unsigned long CHANNEL_LOCK_CYCLE_MS = 1000;      ///< ラウンドロビン1周の長さ (ミリ秒)。各チャンネルの滞在時間はこれをビーコンレートで按分する
+const unsigned long CHANNEL_LOCK_MIN_DWELL_MS = 100;   ///< 1チャンネルあたりの最小滞在時間 (ミリ秒)。ビーコン間隔 (通常100ms) を下回らないようにする
+const float CHANNEL_LOCK_MIN_BEACON_RATE = 0.5f;       ///< ビーコン間隔が不明または極端に長いRIDにも最低限の滞在時間を割り当てるための下限レート (ビーコン/秒)
+const size_t CHANNEL_LOCK_MAX_WATCH_RIDS = 8;          ///< ウォッチリストに登録できるRIDの最大数
+/// @brief チャンネル固定モードで追跡するRIDのウォッチリスト。空の場合はRSSI上位 `CHANNEL_LOCK_MAX_TARGETS` 件を自動選択
+///        シリアルコマンドの `watch <rid>` / `unwatch [rid]` で変更します (handleSerialCommand())
+std::vector<String> channelLockWatchRids = {};
+
+/**
+ * @struct ChannelDwellSlot
+ * @brief チャンネル固定モードのラウンドロビンスケジュールの1スロット
+ */
+struct ChannelDwellSlot {
+    int channel;              ///< 滞在するWi-Fiチャンネル
+    unsigned long dwell_ms;   ///< このチャンネルに滞在する時間 (ミリ秒)
+};
+ChannelDwellSlot channelLockSchedule[WIFI_CHANNEL_MAX]; ///< ラウンドロビンスケジュール (チャンネル昇順)
+int channelLockScheduleLen = 0;         ///< スケジュールの有効スロット数 (0の場合はターゲット未検出)
+int channelLockScheduleIndex = 0;       ///< 現在滞在中のスロット番号
+unsigned long lastChannelSlotSwitch = 0; ///< 現在のスロットに切り替えた時刻
 
 #pragma pack(push,1) // 構造体のパディングを無効にし、メンバーが密に配置されるようにする (メモリ節約とデータ構造の正確なマッピングのため)
 
@@ -191,6 +278,7 @@ void wifi_sniffer_packet_handler(void* buf, wifi_promiscuous_pkt_type_t type) {
     if (type != WIFI_PKT_MGMT) {
         return;
     }
+    const uint32_t parse_start_us = micros(); // 解析時間の計測開始 (記録するのはRIDのBeaconのみ)
     wifi_promiscuous_pkt_t *ppkt = (wifi_promiscuous_pkt_t*)buf;
     wifi_mac_hdr_t *mac_hdr = (wifi_mac_hdr_t *)ppkt->payload;
     // Beaconフレーム (Type 0, SubType 8, Frame Control = 0x8000) 以外は無視
@@ -281,7 +369,11 @@ void wifi_sniffer_packet_handler(void* buf, wifi_promiscuous_pkt_type_t type) {
                     String registration_number_from_payload = String(reg_no_buf);
                     registration_number_from_payload.trim();
                     // セマフォで保護しながらdataManagerにデータを追加
+                    const uint32_t lock_start_us = micros();
+                    telemetry.record(RIDTelemetry::PARSE_US, lock_start_us - parse_start_us);
                     if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
+                        const uint32_t add_start_us = micros();
+                        telemetry.record(RIDTelemetry::LOCK_WAIT_US, add_start_us - lock_start_us);
                         dataManager.addData(
                             rid_from_payload,                   // RID (シリアルナンバー等)
                             ppkt->rx_ctrl.rssi,                 // RSSI値
@@ -292,13 +384,17 @@ void wifi_sniffer_packet_handler(void* buf, wifi_promiscuous_pkt_type_t type) {
                             latitude,                           // 緯度
                             longitude,                          // 経度
                             pressure_alt,                       // 気圧高度
-                            gps_alt                             // GPS高度
+                            gps_alt,                            // GPS高度
+                            mac_hdr->interval                   // ビーコン間隔 (チャンネル固定モードの滞在時間の配分用)
                         );
+                        const uint32_t add_end_us = micros();
                         xSemaphoreGive(dataManagerSemaphore);
+                        telemetry.record(RIDTelemetry::ADD_DATA_US, add_end_us - add_start_us);
                         // デバッグログ (必要に応じてコメント解除)
                         // M5.Log.printf("RID: %s, Ch: %d, RSSI: %d, BcnTS: %llu, Lat: %.4f, Lon: %.4f, PAlt: %.1f, GAlt: %.1f\n",
                         //    rid_from_payload.c_str(), channel, ppkt->rx_ctrl.rssi, mac_hdr->timestamp, latitude, longitude, pressure_alt, gps_alt);
                     } else {
+                        telemetry.countLockTimeout();
                         M5.Log.printf("[WARNING] Failed to take dataManagerSemaphore in sniffer_cb\n");
                     }
                     return; // RIDデータ処理完了
@@ -342,6 +438,247 @@ void wifi_sniffer_init(void) {
   M5.Log.printf("Wi-Fi Sniffer initialized on Channel %d.\n", channel);
 }
 
+/**
+ * @brief チャンネル固定モードのラウンドロビンスケジュールを再構築します
+ * @note 呼び出し元で dataManagerSemaphore を取得済みであること
+ *       ウォッチリスト (空ならRSSI上位のRID) の最新チャンネルを集め、
+ *       各チャンネルの滞在時間をそのチャンネル上のターゲットのビーコンレート合計に比例して配分します
+ */
+void buildChannelLockSchedule() {
+    std::vector<String> targets;
+    for (const auto& rid : channelLockWatchRids) {
+        if (dataManager.hasRID(rid)) {
+            targets.push_back(rid);
+        }
+    }
+#   if SEND_MODE_TOP_RSSI == 0
+        // 指定登録記号モードでは、その登録記号のRIDも必ず追跡対象に含める
+        String reg_rid = dataManager.getRIDForRegistrationNo(String(TARGET_REG_NO_FOR_JSON));
+        if (!reg_rid.isEmpty() && std::find(targets.begin(), targets.end(), reg_rid) == targets.end()) {
+            targets.push_back(reg_rid);
+        }
+#   endif
+    if (targets.empty()) {
+        // ウォッチリストのRIDが見つからない場合は、RSSI上位のRIDを追跡する
+        std::vector<std::pair<int, String>> sorted_rids = dataManager.getSortedRIDsByRSSI();
+        for (size_t i = 0; i < sorted_rids.size() && i < CHANNEL_LOCK_MAX_TARGETS; ++i) {
+            targets.push_back(sorted_rids[i].second);
+        }
+    }
+    // チャンネルごとのビーコンレート合計 (インデックス = チャンネル番号)
+    float channel_weight[WIFI_CHANNEL_MAX + 1] = {0};
+    float total_weight = 0.0f;
+    for (const auto& rid : targets) {
+        RemoteIDEntry latest_entry;
+        if (!dataManager.getLatestEntryForRID(rid, latest_entry)) {
+            continue;
+        }
+        if (latest_entry.channel < 1 || latest_entry.channel > WIFI_CHANNEL_MAX) {
+            continue;
+        }
+        float rate = dataManager.getBeaconRateForRID(rid);
+        if (rate < CHANNEL_LOCK_MIN_BEACON_RATE) rate = CHANNEL_LOCK_MIN_BEACON_RATE;
+        channel_weight[latest_entry.channel] += rate;
+        total_weight += rate;
+    }
+    channelLockScheduleLen = 0;
+    for (int ch = 1; ch <= WIFI_CHANNEL_MAX && total_weight > 0.0f; ++ch) {
+        if (channel_weight[ch] <= 0.0f) {
+            continue;
+        }
+        unsigned long dwell = (unsigned long)(CHANNEL_LOCK_CYCLE_MS * channel_weight[ch] / total_weight);
+        if (dwell < CHANNEL_LOCK_MIN_DWELL_MS) dwell = CHANNEL_LOCK_MIN_DWELL_MS;
+        channelLockSchedule[channelLockScheduleLen].channel = ch;
+        channelLockSchedule[channelLockScheduleLen].dwell_ms = dwell;
+        channelLockScheduleLen++;
+    }
+    if (channelLockScheduleIndex >= channelLockScheduleLen) {
+        channelLockScheduleIndex = 0;
+    }
+}
+
+/**
+ * @brief チャンネル固定モードのスケジュールに従い、滞在時間を過ぎたら次のスロットのチャンネルへ切り替えます
+ * @param force trueの場合は滞在時間に関わらず現在のスロットのチャンネルを設定します (スケジュール再構築直後など)
+ */
+void serviceChannelLockSchedule(bool force = false) {
+    if (channelLockScheduleLen == 0) {
+        return;
+    }
+    if (!force) {
+        if (millis() - lastChannelSlotSwitch < channelLockSchedule[channelLockScheduleIndex].dwell_ms) {
+            return; // まだ滞在時間内
+        }
+        channelLockScheduleIndex = (channelLockScheduleIndex + 1) % channelLockScheduleLen;
+    }
+    lastChannelSlotSwitch = millis();
+    int targetChannel = channelLockSchedule[channelLockScheduleIndex].channel;
+    if (lockedChannel == targetChannel) {
+        return; // 1チャンネルのみのスケジュールでは esp_wifi_set_channel の頻繁な呼び出しを避ける
+    }
+    esp_err_t err = esp_wifi_set_channel(targetChannel, WIFI_SECOND_CHAN_NONE);
+    if (err == ESP_OK) {
+        lockedChannel = targetChannel; // 固定チャンネルを更新
+        channel = lockedChannel;       // 受信チャンネル/表示用のグローバル変数も更新
+    } else {
+        M5.Log.printf("[ERROR] Failed to lock channel to %d: %s\n", targetChannel, esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief JSON/バイナリ出力の対象とするRIDを取得します (SEND_MODE_TOP_RSSI に従う)
+ * @note 呼び出し元で dataManagerSemaphore を取得済みであること
+ * @return 対象のRID文字列。該当RIDがない場合は空文字列
+ */
+String getExportTargetRID() {
+#   if SEND_MODE_TOP_RSSI == 1
+        std::vector<std::pair<int, String>> sorted_rids = dataManager.getSortedRIDsByRSSI();
+        return sorted_rids.empty() ? String("") : sorted_rids[0].second;
+#   else
+        return dataManager.getRIDForRegistrationNo(String(TARGET_REG_NO_FOR_JSON));
+#   endif
+}
+
+/**
+ * @brief シリアルから受け取ったコマンドを処理します (1行1コマンド、改行で確定)
+ *        `since <seq> [rid]`: シーケンス番号 `seq` より新しいエントリだけを出力します (差分取得)
+ *                             `rid` を省略した場合はボタンAと同じ対象 (SEND_MODE_TOP_RSSI) のRIDを使います
+ *        出力のルートの "seq" (バイナリではヘッダのカーソル) を次回の `seq` に渡すことで、差分だけを受け取れます
+ *        出力はexportTaskがバックグラウンドで行います (出力中のコマンドは無視されます)
+ *        `telemetry`: テレメトリのヒストグラムを1行のJSONで出力します (RIDTelemetry::dumpJson())
+ *        `telemetry reset`: テレメトリの記録を消去します
+ *        `watch <rid>`: チャンネル固定モードのウォッチリストにRIDを追加します
+ *        `unwatch [rid]`: ウォッチリストからRIDを削除します。`rid` を省略した場合は全て削除し、RSSI上位の自動選択に戻します
+ *        ウォッチリストを変更すると、チャンネル固定モードのスケジュールは次の周期で再構築されます
+ */
+void handleSerialCommand() {
+    static char line[64];      // 受信中のコマンド行
+    static size_t line_len = 0;
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (line_len < sizeof(line) - 1) {
+                line[line_len++] = c;
+            }
+            continue;
+        }
+        if (line_len == 0) {
+            continue; // 空行 (CRLFのLFなど)
+        }
+        line[line_len] = '\0';
+        line_len = 0;
+        if (strcmp(line, "telemetry") == 0) {
+            if (exportTask.isRunning()) {
+                M5.Log.println("[WARN] Export busy. Telemetry command ignored."); // 出力中のJSONに混ざらないようにする
+            } else {
+                telemetry.dumpJson(Serial);
+            }
+            continue;
+        }
+        if (strcmp(line, "telemetry reset") == 0) {
+            telemetry.reset();
+            M5.Log.println("Telemetry reset.");
+            continue;
+        }
+        // ウォッチリストとスケジュールはloop()からのみ参照するため、セマフォは不要
+        if (strncmp(line, "watch ", 6) == 0) {
+            String rid(line + 6);
+            rid.trim();
+            if (rid.isEmpty()) {
+                M5.Log.println("[WARN] Usage: watch <rid>");
+            } else if (std::find(channelLockWatchRids.begin(), channelLockWatchRids.end(), rid) == channelLockWatchRids.end()) {
+                if (channelLockWatchRids.size() < CHANNEL_LOCK_MAX_WATCH_RIDS) {
+                    channelLockWatchRids.push_back(rid);
+                    channelLockScheduleLen = 0; // スケジュールは次の周期で再構築
+                    channelLockScheduleIndex = 0;
+                } else {
+                    M5.Log.printf("[WARN] Watch list is full (%u RIDs).\n", CHANNEL_LOCK_MAX_WATCH_RIDS);
+                }
+            }
+            M5.Log.printf("Watch list: %u RID(s)\n", channelLockWatchRids.size());
+            continue;
+        }
+        if (strcmp(line, "unwatch") == 0 || strncmp(line, "unwatch ", 8) == 0) {
+            String rid(line + 7);
+            rid.trim();
+            if (rid.isEmpty()) {
+                channelLockWatchRids.clear();
+            } else {
+                auto found = std::find(channelLockWatchRids.begin(), channelLockWatchRids.end(), rid);
+                if (found != channelLockWatchRids.end()) {
+                    channelLockWatchRids.erase(found);
+                }
+            }
+            channelLockScheduleLen = 0; // スケジュールは次の周期で再構築
+            channelLockScheduleIndex = 0;
+            M5.Log.printf("Watch list: %u RID(s)%s\n", channelLockWatchRids.size(),
+                          channelLockWatchRids.empty() ? " (top RSSI)" : "");
+            continue;
+        }
+        if (strncmp(line, "since ", 6) != 0) {
+            M5.Log.printf("[WARN] Unknown serial command: %s\n", line);
+            continue;
+        }
+        char* p = line + 6;
+        uint32_t since_seq = (uint32_t)strtoul(p, &p, 10);
+        while (*p == ' ') p++;
+        String rid(p);
+        if (rid.isEmpty()) {
+            if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
+                M5.Log.println("[ERROR] Could not obtain semaphore for since export.");
+                continue;
+            }
+            rid = getExportTargetRID();
+            xSemaphoreGive(dataManagerSemaphore);
+        }
+        if (!exportTask.start(rid, since_seq, MAX_ENTRIES_IN_JSON, SEND_FORMAT_BINARY == 1)) {
+            M5.Log.println("[WARN] Export busy. Since command ignored.");
+        }
+    }
+}
+
+#if DISPLAY_GLYPH_BENCHMARK == 1
+/**
+ * @brief 文字描画の速度をグリフキャッシュ有り/無しで測定し、ログ出力します
+ * @details ラスタライズのみ (benchmarkRaster) と、print() で全画面を書き換えて show() するまでの2通りを測定します
+ *          後者はSPI転送を含むため、画面の更新にかかる実際の時間の目安になります
+ * @param dc 測定対象のディスプレイコントローラ
+ */
+void runGlyphBenchmark(M5CanvasTextDisplayController& dc)
+{
+    const uint32_t RASTER_ROWS = 2000; // ラスタライズの測定で描画する行数
+    const int PRINT_FRAMES = 20;       // print() + show() の測定で描画するフレーム数
+    char line[64];
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool use_cache = (pass == 0);
+        dc.setGlyphCacheEnabled(use_cache);
+        const uint32_t raster_cps = dc.benchmarkRaster(use_cache, RASTER_ROWS);
+        uint32_t chars = 0;
+        const uint32_t start_us = micros();
+        for (int frame = 0; frame < PRINT_FRAMES; ++frame) {
+            dc.clearDrawingCanvas();
+            for (int row = 0; row < dc.getRows(); ++row) {
+                // フレームごとに内容を変えて、全行が転送されるようにする
+                for (int col = 0; col < dc.getCols() && col < (int)sizeof(line) - 1; ++col) {
+                    line[col] = (char)(' ' + 1 + (row + col + frame) % 94);
+                    line[col + 1] = '\0';
+                }
+                dc.setCursor(row, 0);
+                chars += dc.print(line);
+            }
+            dc.show();
+        }
+        const uint32_t elapsed_us = micros() - start_us;
+        M5.Log.printf("[BENCH] glyph cache %s: raster %u chars/s, print+show %u chars/s (%u us/frame)\n",
+                      use_cache ? "on " : "off", raster_cps,
+                      elapsed_us ? (uint32_t)((uint64_t)chars * 1000000ULL / elapsed_us) : 0,
+                      elapsed_us / PRINT_FRAMES);
+    }
+    dc.setGlyphCacheEnabled(true);
+    dc.fillScreen();
+}
+#endif
+
 /**
  * @brief Arduinoのセットアップ関数。起動時に一度だけ実行されます
  *        ハードウェア初期化、ディスプレイ設定、Wi-Fiスニッファ初期化などを行います
@@ -360,12 +697,15 @@ void setup()
     if (!displayController_ptr->begin(1, false, GREEN, BLACK, 1)) {
         Serial.println("[FATAL] Failed to initialize Display Controller with rotation 1!");
         // ここで失敗する場合、begin()内部のcreateSpriteで問題が起きている可能性
-        // M5CanvasTextDisplayController.h の _recreateCanvases() 内の
-        // Serial.printf("Error: Failed to create canvas1/2...") のログが出るか確認
+        // M5CanvasTextDisplayController.h の _recreateStrips() 内の
+        // Serial.printf("Error: Failed to create strip buffer...") のログが出るか確認
         while(1);
     }
     M5CanvasTextDisplayController& dc = *displayController_ptr; // 以降、dc経由でアクセスするためのエイリアス
     Serial.println("Attempted to show initial canvas content.");
+#   if DISPLAY_GLYPH_BENCHMARK == 1
+    runGlyphBenchmark(dc);
+#   endif
     // ヒープ残量を表示
     uint32_t freeHeap = ESP.getFreeHeap();
     uint32_t minFreeHeap = ESP.getMinFreeHeap(); // プログラム実行中の最小ヒープ残量
@@ -377,7 +717,7 @@ void setup()
     Serial.printf("  Largest Free Block: %u bytes\n", largestBlock);
     Serial.println("--------------------------------------");
     // 画面に表示可能な最大RID数を計算 (ヘッダ行数を考慮)
-    int available_rows_for_rids = dc.getRows() - HEADER_LINES;
+    int available_rows_for_rids = dc.getRows() - HEADER_LINES - (UI_DEBUG_OVERLAY == 1 ? 1 : 0); // デバッグオーバーレイは最下行を使う
     if (available_rows_for_rids < 0) available_rows_for_rids = 0;
     max_rids_to_display_calculated = available_rows_for_rids / LINES_PER_RID_ENTRY;
     if (max_rids_to_display_calculated < 0) max_rids_to_display_calculated = 0;
@@ -393,6 +733,9 @@ void setup()
         dc.show();
         while(1); // 致命的エラーなので停止
     }
+    if (!exportTask.begin()) {
+        M5.Log.printf("[ERROR] Failed to create export task. JSON export is disabled.\n");
+    }
     M5.Log.printf("[INFO] Setting up RTC and system time...\n");
     // RTCから時刻を取得し、システム時刻に設定
     auto dt = M5.Rtc.getDateTime();
@@ -443,8 +786,8 @@ void setup()
     dc.clearDrawingCanvas(); // 既存のメッセージをクリア
     dc.setCursor(0, dc.getRows() / 3); // 画面中央やや上にカーソル移動
     dc.println("Setup Complete!");
-    dc.println("A: Send JSON");
-    dc.println("B: Ch Lock");
+    dc.println("A: Send JSON / Hold: View");
+    dc.println("B: Next page / Hold: Ch Lock");
     dc.println("C: Reset Device");
     dc.show(); // 描画内容をLCDに反映
     //M5.Log.setLogLevel(m5::log_target_serial, ESP_LOG_VERBOSE);
@@ -452,6 +795,435 @@ void setup()
     delay(3000); // 初期メッセージ表示時間
 }
 
+/**
+ * @brief 現在の表示に関わる状態の要約を取得します
+ * @return 状態の要約
+ */
+UiStateKey captureUiStateKey()
+{
+    UiStateKey key;
+    key.dataVersion = dataManager.getDataVersion(); // セマフォ不要 (32bitの読み出し)
+    key.timerTick = millis() / UI_TIMER_FIELD_INTERVAL;
+    key.channel = channel;
+    key.lockedChannel = lockedChannel;
+    key.scheduleLen = channelLockScheduleLen;
+    key.lockMode = channelLockModeActive;
+    key.exportProgress = exportTask.isRunning() ? exportTask.getProgressPercent() : -1;
+    key.listFirstRank = uiListFirstRank;
+    key.view = uiView;
+    return key;
+}
+
+/**
+ * @brief 緯度・経度 (度) を1e-7度単位の整数に変換します (レーダー表示の投影用)
+ * @param deg 緯度または経度 (度)
+ * @return 1e-7度単位の値
+ */
+int32_t radarToE7(double deg)
+{
+    return (int32_t)lround(deg * 1e7);
+}
+
+/**
+ * @brief 符号を考慮して四捨五入する整数除算 (レーダー表示の投影用)
+ * @param num 被除数
+ * @param den 除数 (正の値)
+ * @return num / den を四捨五入した値
+ */
+int32_t radarRoundDiv(int64_t num, int64_t den)
+{
+    return (int32_t)((num >= 0 ? num + den / 2 : num - den / 2) / den);
+}
+
+/**
+ * @struct RadarCircle
+ * @brief レーダー表示の距離円 (半径 RADAR_RANGE_M) を描く文字セルの、表示領域の中心からのオフセット
+ * @details 表示領域の大きさ (文字サイズや回転で変わる) ごとに1回だけ計算し、フレームごとには計算しません
+ */
+struct RadarCircle {
+    int areaRows = 0;                       ///< 計算したときの表示領域の行数 (0: 未計算)
+    int cols = 0;                           ///< 計算したときの表示領域の列数
+    int count = 0;                          ///< 文字セルの数 (同じセルに重なった点は1つにまとめる)
+    int16_t rowOffset[RADAR_CIRCLE_POINTS]; ///< 中心からの行のオフセット (下が正)
+    int16_t colOffset[RADAR_CIRCLE_POINTS]; ///< 中心からの列のオフセット (右が正)
+};
+
+/**
+ * @brief 表示領域の大きさが変わった場合だけ、距離円の文字セルを計算し直します
+ * @param circle 計算結果の保存先 (前回の結果を保持する)
+ * @param area_rows 表示領域の行数
+ * @param cols 表示領域の列数
+ */
+void radarUpdateCircle(RadarCircle& circle, int area_rows, int cols)
+{
+    if (circle.areaRows == area_rows && circle.cols == cols) {
+        return;
+    }
+    circle.areaRows = area_rows;
+    circle.cols = cols;
+    circle.count = 0;
+    const float radius_px = min((area_rows / 2) * RADAR_CELL_H, (cols / 2) * RADAR_CELL_W);
+    for (int k = 0; k < RADAR_CIRCLE_POINTS; ++k) {
+        const float angle = k * (2.0f * PI / RADAR_CIRCLE_POINTS);
+        const int16_t row = (int16_t)-lroundf(sinf(angle) * radius_px / RADAR_CELL_H);
+        const int16_t col = (int16_t)lroundf(cosf(angle) * radius_px / RADAR_CELL_W);
+        bool duplicate = false;
+        for (int i = 0; i < circle.count && !duplicate; ++i) {
+            duplicate = circle.rowOffset[i] == row && circle.colOffset[i] == col;
+        }
+        if (!duplicate) {
+            circle.rowOffset[circle.count] = row;
+            circle.colOffset[circle.count] = col;
+            circle.count++;
+        }
+    }
+}
+
+/**
+ * @brief レーダー表示 (中心からの相対位置にRIDを点で描画) を文字グリッドに描画します
+ * @details 中心はRSSI最大のRID (RADAR_USE_HOME_POINT == 1 の場合は固定地点) の最新位置で、北が上です。
+ *          投影は中心の緯度での正距円筒図法です。cos(緯度) はフレームごとに1回だけQ15の整数にし、
+ *          各RIDの位置は整数の乗除算だけで文字セルに変換します。
+ *          距離円の文字セルは表示領域の大きさが変わったときだけ計算します (radarUpdateCircle)。
+ *          点は文字セルとして置くため、show() の行差分により、点が動いた行だけがLCDへ転送されます。
+ *          点の記号はRSSI順位 ('1'～'9'、10位以降は'*') で、RID一覧の順位と対応します
+ * @param dc 描画先のディスプレイコントローラ (カーソル行から凡例の行の手前までを使用)
+ */
+void renderRadarView(M5CanvasTextDisplayController& dc)
+{
+    const int top_row = dc.getPrintCursorRow();
+    const int legend_row = dc.getRows() - 1 - (UI_DEBUG_OVERLAY == 1 ? 1 : 0); // 最下行 (オーバーレイ使用時はその上) は凡例
+    const int area_rows = legend_row - top_row;
+    const int cols = dc.getCols();
+    if (area_rows < 3 || cols < 3) {
+        return;
+    }
+    // セマフォで保護しながら、RSSI上位のRIDの最新位置だけを取り出す (描画はセマフォの外で行う)
+    struct RadarBlip {
+        int32_t lat_e7;  ///< 緯度 (1e-7度)
+        int32_t lon_e7;  ///< 経度 (1e-7度)
+        char mark;       ///< 表示する記号
+    };
+    RadarBlip blips[RADAR_MAX_BLIPS];
+    size_t blip_count = 0;
+    unsigned no_fix = 0; // 位置を受信していないRIDの数
+    if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) {
+        std::vector<std::pair<int, String>> ranked_rids;
+        dataManager.getRIDsByRSSIRank(0, RADAR_MAX_BLIPS, ranked_rids);
+        for (size_t i = 0; i < ranked_rids.size(); ++i) {
+            RemoteIDEntry latest_entry;
+            if (!dataManager.getLatestEntryForRID(ranked_rids[i].second, latest_entry)) {
+                continue;
+            }
+            if (latest_entry.latitude == 0.0f && latest_entry.longitude == 0.0f) {
+                no_fix++; // Location/Vectorメッセージ未受信
+                continue;
+            }
+            RadarBlip& blip = blips[blip_count++];
+            blip.lat_e7 = radarToE7(latest_entry.latitude);
+            blip.lon_e7 = radarToE7(latest_entry.longitude);
+            blip.mark = i < 9 ? (char)('1' + i) : '*';
+        }
+        xSemaphoreGive(dataManagerSemaphore);
+    } else {
+        M5.Log.printf("[WARNING] Failed to take dataManagerSemaphore for radar.\n");
+        dc.println("Failed to get data...");
+        return;
+    }
+    char legend_buf[48];
+#   if RADAR_USE_HOME_POINT == 1
+        const int32_t ref_lat_e7 = radarToE7(RADAR_HOME_LAT);
+        const int32_t ref_lon_e7 = radarToE7(RADAR_HOME_LON);
+        const char ref_mark = 'H';
+#   else
+        if (blip_count == 0) {
+            snprintf(legend_buf, sizeof(legend_buf), "No position yet. nofix:%u", no_fix);
+            dc.setText(legend_row, 0, legend_buf);
+            return;
+        }
+        const int32_t ref_lat_e7 = blips[0].lat_e7;
+        const int32_t ref_lon_e7 = blips[0].lon_e7;
+        const char ref_mark = blips[0].mark;
+#   endif
+    // 表示領域の中心と、RADAR_RANGE_M に対応するピクセル数 (文字セルの縦横比で補正して円にする)
+    const int center_row = top_row + area_rows / 2;
+    const int center_col = cols / 2;
+    const int64_t radius_px = min((area_rows / 2) * RADAR_CELL_H, (cols / 2) * RADAR_CELL_W);
+    const int64_t range_mm = (int64_t)RADAR_RANGE_M * 1000;
+    // 経度方向の縮尺 cos(緯度) (Q15)。フレームごとの三角関数はこの1回だけ
+    const int64_t cos_lat_q15 = (int64_t)(cosf(ref_lat_e7 * 1e-7f * DEG_TO_RAD) * 32768.0f);
+    char mark_buf[2] = {0, 0};
+    // 半径 RADAR_RANGE_M の円 (文字セルのオフセットは表示領域の大きさが変わったときだけ計算する)
+    static RadarCircle circle;
+    radarUpdateCircle(circle, area_rows, cols);
+    mark_buf[0] = '.';
+    for (int i = 0; i < circle.count; ++i) {
+        const int row = center_row + circle.rowOffset[i];
+        if (row >= top_row && row < legend_row) {
+            dc.setText(row, center_col + circle.colOffset[i], mark_buf);
+        }
+    }
+    mark_buf[0] = '+';
+    dc.setText(center_row, center_col, mark_buf);
+    // 順位の低いRIDから描画し、同じセルに重なった場合は順位の高いRIDを表示する
+    unsigned out_of_view = 0;
+    for (size_t i = blip_count; i-- > 0;) {
+        // 1e-7度 = 11.132mm (緯度方向)。経度方向はさらに cos(緯度) 倍
+        const int64_t north_mm = (int64_t)(blips[i].lat_e7 - ref_lat_e7) * 11132 / 1000;
+        const int64_t east_mm = (((int64_t)blips[i].lon_e7 - ref_lon_e7) * 11132 / 1000 * cos_lat_q15) >> 15;
+        const int row = center_row - radarRoundDiv(north_mm * radius_px, range_mm * RADAR_CELL_H);
+        const int col = center_col + radarRoundDiv(east_mm * radius_px, range_mm * RADAR_CELL_W);
+        if (row < top_row || row >= legend_row || col < 0 || col >= cols) {
+            out_of_view++;
+            continue;
+        }
+        mark_buf[0] = blips[i].mark;
+        dc.setText(row, col, mark_buf);
+    }
+    snprintf(legend_buf, sizeof(legend_buf), "C:%c R:%dm in:%u out:%u nofix:%u",
+             ref_mark, RADAR_RANGE_M, (unsigned)(blip_count - out_of_view), out_of_view, no_fix);
+    dc.setText(legend_row, 0, legend_buf);
+}
+
+/**
+ * @brief テレメトリのデバッグページ (計測項目ごとの記録回数・パーセンタイル・最大値とヒープ残量の水位) を文字グリッドに描画します
+ * @details パーセンタイルは2のべき乗幅のバケットの上限のため、実際の値の最大2倍の値になります
+ * @param dc 描画先のディスプレイコントローラ (カーソル行から使用)
+ */
+void renderTelemetryView(M5CanvasTextDisplayController& dc)
+{
+    // 表示名は dc.getCols() が40 (横向き、文字サイズ1) で1行に収まるように短縮する
+    static const char* const LABELS[RIDTelemetry::METRIC_COUNT] = {
+        "parse us", "lock us", "add us", "frame us", "expchk us", "export ms", "RIDs", "entries", "heap KB"
+    };
+    dc.printf("%-10s%7s%7s%7s%8s\n", "", "n", "p50", "p99", "max");
+    for (uint8_t m = 0; m < RIDTelemetry::METRIC_COUNT; ++m) {
+        RIDTelemetry::Histogram h;
+        telemetry.snapshot((RIDTelemetry::Metric)m, h);
+        dc.printf("%-10s%7u%7u%7u%8u\n", LABELS[m], h.count, h.percentile(50), h.percentile(99), h.max);
+    }
+    const RIDTelemetry::HeapWatermarks heap = telemetry.getHeapWatermarks();
+    dc.printf("lock timeouts:%u\n", telemetry.getLockTimeouts());
+    dc.printf("heap min:%u blk:%u/%u\n", heap.minFreeHeap, heap.largestFreeBlock, heap.minLargestFreeBlock);
+}
+
+/**
+ * @brief ステータス画面 (ヘッダ、区切り線、RID一覧・レーダー表示・テレメトリのいずれか) を文字グリッドに描画し、LCDへ反映します
+ * @details 描画内容はすべてdataManagerとチャンネル制御の状態から作り直します
+ *          呼び出すかどうかは serviceUiScheduler() が判断します
+ * @param dc 描画先のディスプレイコントローラ
+ */
+void renderStatusScreen(M5CanvasTextDisplayController& dc)
+{
+    dc.clearDrawingCanvas(); // 描画キャンバスをクリア
+    dc.setCursor(0, 0);      // カーソルを左上にリセット
+    int current_rid_count_total = 0; // データストア内の総RID数
+    int top_rid_entry_count = 0;   // Top RSSIのRIDが持つエントリ数
+    if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) { // セマフォ取得時間を少し伸ばす可能性も考慮
+        current_rid_count_total = dataManager.getRIDCount();
+        // Top RSSIのRIDのエントリ数を取得 (SEND_MODE_TOP_RSSI == 1 の場合)
+        // #if SEND_MODE_TOP_RSSI == 1 // このプリプロセッサはJSON送信モード用なので、表示は常にTopRSSIを基準にするか、別途指定が必要
+            std::vector<std::pair<int, String>> top_rid;
+            dataManager.getRIDsByRSSIRank(0, 1, top_rid);
+            if (!top_rid.empty()) {
+                // エントリをコピーせずに件数だけを取得する
+                top_rid_entry_count = dataManager.getEntryCountForRID(top_rid[0].second);
+            }
+        // #endif
+        // もしSEND_MODE_TOP_RSSI が 0 の場合、TARGET_REG_NO_FOR_JSON のエントリ数を表示するなら、
+        // そのためのロジックもここに追加する必要がある。
+        // ここでは簡略化のため、常にTop RSSIのエントリ数を表示対象とする。
+        xSemaphoreGive(dataManagerSemaphore);
+    } else {
+        M5.Log.println("[WARNING] Failed to take dataManagerSemaphore for display counts.");
+    }
+
+    // ヘッダ情報表示
+    char header_buf[120];
+    if (channelLockModeActive) {
+        if (lockedChannel != -1) {
+            // Ch:XX(LN) RIDs:Y H:ZZZZ Ents:W  (N: ラウンドロビン対象のチャンネル数)
+            snprintf(header_buf, sizeof(header_buf), "Ch:%2d(L%d) RIDs:%d H:%u Ents:%d",
+                     lockedChannel, channelLockScheduleLen, current_rid_count_total, ESP.getFreeHeap(), top_rid_entry_count);
+        } else {
+            // Ch:Lock? RIDs:Y H:ZZZZ Ents:W
+            snprintf(header_buf, sizeof(header_buf), "Ch:Lock? RIDs:%d H:%u Ents:%d",
+                     current_rid_count_total, ESP.getFreeHeap(), top_rid_entry_count);
+        }
+    } else {
+        // Ch:XX(S) RIDs:Y H:ZZZZ Ents:W
+        snprintf(header_buf, sizeof(header_buf), "Ch:%2d(S) RIDs:%d H:%u Ents:%d",
+                 channel, current_rid_count_total, ESP.getFreeHeap(), top_rid_entry_count);
+    }
+    dc.println(header_buf);
+    // RIDが減って表示開始順位が範囲外になった場合は、最後のページに戻す
+    const size_t page_size = max_rids_to_display_calculated > 0 ? max_rids_to_display_calculated : 1;
+    if (uiListFirstRank >= (size_t)current_rid_count_total) {
+        uiListFirstRank = current_rid_count_total > 0 ? ((current_rid_count_total - 1) / page_size) * page_size : 0;
+    }
+    // 区切り線表示
+    if (exportTask.isRunning()) {
+        // 出力中は区切り線の位置に進捗を表示する
+        dc.printf("-- EXPORT %3u%% A:cancel ", exportTask.getProgressPercent());
+    } else if (uiView == UI_VIEW_RADAR) {
+        dc.printf("-- RADAR %dm ", RADAR_RANGE_M);
+    } else if (uiView == UI_VIEW_TELEMETRY) {
+        dc.print("-- TELEMETRY ");
+    } else if ((size_t)current_rid_count_total > page_size) {
+        // 1ページに収まらない場合は、表示中の順位の範囲を表示する
+        dc.printf("-- %u-%u/%d B:next ", (unsigned)(uiListFirstRank + 1),
+                  (unsigned)min(uiListFirstRank + page_size, (size_t)current_rid_count_total), current_rid_count_total);
+    }
+    dc.printRepeat('-', dc.getCols() - dc.getPrintCursorCol());
+    dc.println();
+    // セマフォで保護しながらdataManagerから表示用データを取得し描画
+    if (uiView == UI_VIEW_RADAR) {
+        renderRadarView(dc); // セマフォはrenderRadarView()内で取得する
+    } else if (uiView == UI_VIEW_TELEMETRY) {
+        renderTelemetryView(dc); // dataManagerは参照しない
+    } else if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) {
+        // 表示中のページの範囲だけを、RSSI順位インデックスから取得 (RSSI値, RID文字列 のペア)
+        // RIDがいくつあっても、1フレームで扱うのは画面に表示できる件数だけ
+        std::vector<std::pair<int, String>> sorted_rids_info;
+        int rid_count_available = dataManager.getRIDsByRSSIRank(uiListFirstRank, max_rids_to_display_calculated, sorted_rids_info);
+        int displayed_count = 0;
+        // 実際に表示するRID数を決定 (取得できたRID数と画面に表示可能な最大数のうち小さい方)
+        int rids_to_actually_display = min((int)sorted_rids_info.size(), max_rids_to_display_calculated);
+        if (rids_to_actually_display > 0) {
+            for (int i = 0; i < rids_to_actually_display && displayed_count < max_rids_to_display_calculated; ++i) {
+                // 次のRID情報を表示するための行数が画面内に収まるかチェック
+                if (dc.getPrintCursorRow() + LINES_PER_RID_ENTRY > dc.getRows()) {
+                    break; // 画面からはみ出るならループ中断
+                }
+                const String& current_rid_str = sorted_rids_info[i].second;
+                if (!current_rid_str.isEmpty()) {
+                    RemoteIDEntry latest_entry; // 最新の受信データを格納する構造体
+                    if (dataManager.getLatestEntryForRID(current_rid_str, latest_entry)) {
+                        // 1行目: RID (RSSI, Ch)
+                        // " (RSSI,Ch:XX)" のために約15文字消費 + マージンを考慮。長いRIDは精度指定で切り詰める
+                        int max_rid_len_for_line = dc.getCols() - 16;
+                        if (max_rid_len_for_line < 1) max_rid_len_for_line = 1;
+                        dc.printf("%.*s (%d,Ch:%d)\n", max_rid_len_for_line, current_rid_str.c_str(), latest_entry.rssi, latest_entry.channel);
+                        // 2行目: 登録記号
+                        if (!latest_entry.registrationNo.isEmpty()) {
+                            // "Reg:" のために4文字消費
+                            int max_reg_len = dc.getCols() - 4;
+                            if (max_reg_len < 1) max_reg_len = 1;
+                            dc.printf("Reg:%.*s\n", max_reg_len, latest_entry.registrationNo.c_str());
+                        } else {
+                            dc.println("Reg:N/A");
+                        }
+                        // 3行目: 緯度/経度
+                        dc.printf("L:%.3f Lo:%.3f\n", latest_entry.latitude, latest_entry.longitude);
+                        // 4行目: 高度情報と受信時刻 (M5StickC時刻)
+                        char time_str[10] = "N/A Time";
+                        time_t entry_time = latest_entry.timestamp; // これはM5StickCのシステム時刻
+                        struct tm *tm_info = localtime(&entry_time);
+                        if (tm_info) {
+                             snprintf(time_str, sizeof(time_str), "%02d:%02d:%02d", tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
+                        }
+                        dc.printf("P:%.0fm G:%.0fm %s\n", latest_entry.pressureAltitude, latest_entry.gpsAltitude, time_str);
+                        // 5行目: Beacon TSF タイムスタンプ (下位桁のみ表示)
+                        dc.printf("BcnTS: ..%03llu.%06llu\n",
+                                  (unsigned long long)((latest_entry.beaconTimestamp / 1000000ULL) % 1000ULL),
+                                  (unsigned long long)(latest_entry.beaconTimestamp % 1000000ULL));
+                        displayed_count++;
+                    }
+                }
+            }
+        }
+        // 表示するデータがなかった場合のメッセージ
+        if (displayed_count == 0 && rid_count_available == 0) {
+             if (dc.getPrintCursorRow() < dc.getRows()) { // 画面に空き行があれば
+                dc.println("No RID data yet.");
+             }
+        } else if (displayed_count == 0 && rid_count_available > 0) { // データはあるが表示スペースがなかった場合
+            if (dc.getPrintCursorRow() < dc.getRows()) {
+                dc.println("No space to show RIDs");
+            }
+        }
+        xSemaphoreGive(dataManagerSemaphore);
+    } else {
+        M5.Log.printf("[WARNING] Failed to take dataManagerSemaphore for display.\n");
+        if (dc.getPrintCursorRow() < dc.getRows()) { // 画面に空き行があれば
+            dc.println("Failed to get data...");
+        }
+    }
+#   if UI_DEBUG_OVERLAY == 1
+        // 最下行 (RID表示用の行数から除外済み) に、UIフレームスケジューラの統計を表示する
+        char overlay_buf[48];
+        snprintf(overlay_buf, sizeof(overlay_buf), "F:%u S:%u %uus max:%uus",
+                 uiFrameStats.frames, uiFrameStats.skipped, uiFrameStats.lastFrameUs, uiFrameStats.maxFrameUs);
+        dc.setText(dc.getRows() - 1, 0, overlay_buf);
+#   endif
+    dc.show(); // 全ての描画が終わったら、文字グリッドの内容をLCDに転送
+#   if DISPLAY_FRAME_STATS == 1
+        static unsigned long lastFrameStatsLog = 0;
+        if (millis() - lastFrameStatsLog >= DISPLAY_FRAME_STATS_INTERVAL) {
+            lastFrameStatsLog = millis();
+            const M5CanvasTextDisplayController::FrameStats& fs = dc.getFrameStats();
+            M5.Log.printf("[DISPLAY] frames:%u pushed:%u unchanged:%u clean:%u bytes:%u last:%uus max:%uus\n",
+                          fs.frames, fs.rowsPushed, fs.rowsUnchanged, fs.rowsClean, fs.bytesPushed, fs.lastShowUs, fs.maxShowUs);
+            M5.Log.printf("[UI] frames:%u skipped:%u last:%uus max:%uus\n",
+                          uiFrameStats.frames, uiFrameStats.skipped, uiFrameStats.lastFrameUs, uiFrameStats.maxFrameUs);
+            dc.resetFrameStats();
+        }
+#   endif
+}
+
+/**
+ * @brief UIフレームスケジューラ。UI_FRAME_INTERVAL ごとに状態の要約を確認し、変わっていた場合だけ再描画します
+ * @details チャンネル切り替えとは独立した周期で動くため、受信データの変化は次の確認周期で画面に反映されます
+ *          何も変わっていない周期は再描画せず、スキップ数として数えます
+ * @param dc 描画先のディスプレイコントローラ
+ */
+void serviceUiScheduler(M5CanvasTextDisplayController& dc)
+{
+    static unsigned long last_ui_check = 0;
+    static UiStateKey last_drawn_key;
+    static bool has_drawn = false;
+    if (millis() - last_ui_check < UI_FRAME_INTERVAL) {
+        return;
+    }
+    last_ui_check = millis();
+    // 描画前に要約を取るため、描画中に届いたデータは次の周期で検出される
+    const UiStateKey key = captureUiStateKey();
+    if (has_drawn && key == last_drawn_key) {
+        uiFrameStats.skipped++;
+        return;
+    }
+    const uint32_t start_us = micros();
+    renderStatusScreen(dc);
+    uiFrameStats.lastFrameUs = micros() - start_us;
+    telemetry.record(RIDTelemetry::UI_FRAME_US, uiFrameStats.lastFrameUs);
+    if (uiFrameStats.lastFrameUs > uiFrameStats.maxFrameUs) {
+        uiFrameStats.maxFrameUs = uiFrameStats.lastFrameUs;
+    }
+    uiFrameStats.frames++;
+    last_drawn_key = key;
+    has_drawn = true;
+}
+
+/**
+ * @brief TELEMETRY_SAMPLE_INTERVAL ごとに、ヒープ残量とキュー深さ (RID数・エントリ数) をテレメトリに記録します
+ */
+void serviceTelemetrySampler()
+{
+    static unsigned long last_sample = 0;
+    if (millis() - last_sample < TELEMETRY_SAMPLE_INTERVAL) {
+        return;
+    }
+    last_sample = millis();
+    telemetry.sampleHeap();
+    if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
+        const int rid_count = dataManager.getRIDCount();
+        const size_t entry_count = dataManager.getTotalEntryCount();
+        xSemaphoreGive(dataManagerSemaphore);
+        telemetry.record(RIDTelemetry::RID_DEPTH, rid_count);
+        telemetry.record(RIDTelemetry::ENTRY_DEPTH, entry_count);
+    }
+}
+
 /**
  * @brief Arduinoのメインループ関数。setup()後に繰り返し実行されます
  *        ボタン入力処理、チャンネル制御、画面表示更新などを行います
@@ -461,42 +1233,54 @@ void loop()
     M5.update(); // M5Unifiedのボタン状態などを更新
     if (!displayController_ptr) return; // displayControllerが初期化失敗していたら何もしない
     M5CanvasTextDisplayController& dc = *displayController_ptr; // エイリアス
-    // --- ボタンA: JSONデータをシリアル送信 ---
-    if (M5.BtnA.wasPressed()) {
-        M5.Log.println("Button A pressed. Preparing JSON data...");
-        dc.clearDrawingCanvas();
-        dc.setCursor(0,0);
-        dc.println("BTN_A: Sending JSON...");
-        dc.show();
-        if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
+    // --- シリアルコマンド: 差分 (since) 出力 ---
+    handleSerialCommand();
+    // --- ボタンA (クリック): JSONデータをシリアル送信 (出力中に押すと中止) ---
+    // 送信はexportTaskがバックグラウンドで行い、進捗は区切り線の位置に表示する
+    if (M5.BtnA.wasClicked()) {
+        if (exportTask.isRunning()) {
+            M5.Log.println("Button A pressed. Cancelling export...");
+            exportTask.cancel();
+        } else if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
+            // ボタンAでは最新の MAX_ENTRIES_IN_JSON 件を出力する
+            String rid = getExportTargetRID();
+            uint32_t latest_seq = dataManager.getLatestSeqForRID(rid);
+            xSemaphoreGive(dataManagerSemaphore);
+            uint32_t since_seq = latest_seq > MAX_ENTRIES_IN_JSON ? latest_seq - MAX_ENTRIES_IN_JSON : 0;
 #           if SEND_MODE_TOP_RSSI == 1
-                M5.Log.printf("Mode: Top RSSI, Max Entries: %u\n", MAX_ENTRIES_IN_JSON);
-                dataManager.getJsonForTopRSSI(1, MAX_ENTRIES_IN_JSON, Serial);
+                M5.Log.printf("Button A pressed. Mode: Top RSSI, Max Entries: %u\n", MAX_ENTRIES_IN_JSON);
 #           else
-                M5.Log.printf("Mode: Reg No '%s', Max Entries: %u\n", TARGET_REG_NO_FOR_JSON, MAX_ENTRIES_IN_JSON);
-                dataManager.getJsonForRegistrationNo(String(TARGET_REG_NO_FOR_JSON), MAX_ENTRIES_IN_JSON, Serial);
+                M5.Log.printf("Button A pressed. Mode: Reg No '%s', Max Entries: %u\n", TARGET_REG_NO_FOR_JSON, MAX_ENTRIES_IN_JSON);
 #           endif
-            xSemaphoreGive(dataManagerSemaphore);
-            M5.Log.println("JSON data streamed to Serial.");
-            dc.clearDrawingCanvas();
-            dc.setCursor(0,0);
-            dc.println("JSON Sent (Streamed)");
-            dc.println("Check PC.");
-            dc.show();
-            delay(2500);
+            if (!exportTask.start(rid, since_seq, MAX_ENTRIES_IN_JSON, SEND_FORMAT_BINARY == 1)) {
+                M5.Log.println("[ERROR] Could not start export.");
+            }
         } else {
             M5.Log.println("[ERROR] Could not obtain semaphore for JSON data generation.");
-            dc.clearDrawingCanvas();
-            dc.setCursor(0,0);
-            dc.println("Error: Semaphore busy.");
-            dc.println("Try again.");
-            dc.show();
-            delay(2000);
         }
     }
-    // --- ボタンB: チャンネル固定モード切り替え ---
-    if (M5.BtnB.wasPressed()) {
+    // --- ボタンA (長押し): 表示の切り替え (RID一覧 → レーダー表示 → テレメトリ → RID一覧) ---
+    if (M5.BtnA.wasHold()) {
+        uiView = uiView == UI_VIEW_LIST ? UI_VIEW_RADAR : (uiView == UI_VIEW_RADAR ? UI_VIEW_TELEMETRY : UI_VIEW_LIST);
+        M5.Log.printf("View: %s\n", uiView == UI_VIEW_RADAR ? "radar" : (uiView == UI_VIEW_TELEMETRY ? "telemetry" : "list"));
+    }
+    // --- ボタンB (クリック): RID一覧のページ送り (最後のページの次は先頭へ戻る) ---
+    if (M5.BtnB.wasClicked()) {
+        const size_t page_size = max_rids_to_display_calculated > 0 ? max_rids_to_display_calculated : 1;
+        if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) {
+            const size_t rid_count = (size_t)dataManager.getRIDCount();
+            xSemaphoreGive(dataManagerSemaphore);
+            uiListFirstRank += page_size;
+            if (uiListFirstRank >= rid_count) {
+                uiListFirstRank = 0;
+            }
+        }
+    }
+    // --- ボタンB (長押し): チャンネル固定モード切り替え ---
+    if (M5.BtnB.wasHold()) {
         channelLockModeActive = !channelLockModeActive; // モードをトグル
+        channelLockScheduleLen = 0;   // スケジュールは次の周期で再構築
+        channelLockScheduleIndex = 0;
         if (channelLockModeActive) {
             M5.Log.println("Channel lock mode ACTIVATED.");
             lockedChannel = -1; // 最初は固定チャンネル未定
@@ -506,8 +1290,7 @@ void loop()
             lockedChannel = -1; // 固定解除
             // 次の通常のチャンネル切り替えタイミングでスキャンが再開される
         }
-        // 即座に画面更新するために、表示更新タイマーをリセットすることも検討可能
-        // last_display_update = 0; // これにより次のloopで即座に画面更新
+        // 表示はUIフレームスケジューラが状態の変化を検出して更新する
     }
     // --- ボタンC (M5StickCPlus2では電源ボタン): リセット ---
     if (M5.BtnPWR.wasPressed()) { // M5.BtnC は M5StickCPlusではサイドボタン。M5StickCPlus2の物理ボタンCに該当するのはBtnPWR
@@ -519,70 +1302,39 @@ void loop()
         delay(1000); // メッセージ表示のための短い遅延
         ESP.restart(); // ESP32を再起動
     }
-    // --- 定期的な画面表示更新処理 (WIFI_CHANNEL_SWITCH_INTERVALごと) ---
-    static unsigned long last_display_update = 0;
-    if (millis() - last_display_update > WIFI_CHANNEL_SWITCH_INTERVAL) {
-        last_display_update = millis();
+    // --- チャンネル固定モードのラウンドロビン (滞在時間は表示更新周期より短い場合があるため毎回確認) ---
+    if (channelLockModeActive) {
+        serviceChannelLockSchedule();
+    }
+    // --- 定期的なチャンネル切り替え処理 (WIFI_CHANNEL_SWITCH_INTERVALごと) ---
+    static unsigned long last_channel_switch = 0;
+    if (millis() - last_channel_switch > WIFI_CHANNEL_SWITCH_INTERVAL) {
+        last_channel_switch = millis();
         // --- チャンネル制御ロジック ---
         if (channelLockModeActive) {
             // チャンネル固定モードが有効な場合
-            if (lockedChannel == -1 || (millis() - lastChannelLockCheck > CHANNEL_LOCK_CHECK_INTERVAL)) {
-                // 固定チャンネルが未設定、または定期的なターゲット再確認のタイミング
+            if (channelLockScheduleLen == 0 || (millis() - lastChannelLockCheck > CHANNEL_LOCK_CHECK_INTERVAL)) {
+                // スケジュールが未構築、または定期的なターゲット再確認のタイミング
                 lastChannelLockCheck = millis();
-                int targetChannel = -1; // 固定対象とするチャンネル
-                // セマフォで保護しながらdataManagerから情報を取得
+                // セマフォで保護しながらdataManagerからウォッチリストのチャンネルとビーコンレートを取得
                 if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) {
-#                   if SEND_MODE_TOP_RSSI == 1
-                        // RSSIが最も強いRIDの最新チャンネルをターゲットとする
-                        std::vector<std::pair<int, String>> sorted_rids = dataManager.getSortedRIDsByRSSI();
-                        if (!sorted_rids.empty()) {
-                            RemoteIDEntry latest_entry;
-                            if (dataManager.getLatestEntryForRID(sorted_rids[0].second, latest_entry)) {
-                                targetChannel = latest_entry.channel;
-                            }
-                        }
-#                   else
-                        // 指定された登録記号のRIDの最新チャンネルをターゲットとする
-                        // 注: RemoteIDDataManagerにこのための直接的なヘルパー関数がない場合、
-                        //     _data_storeへのアクセスが必要になるが、これはカプセル化の観点からは非推奨。
-                        //     理想的にはdataManagerに `getChannelForRegistrationNo` のような関数を追加する。
-                        //     ここでは簡易的に内部データ構造を参照する例を示す（要RemoteIDDataManager.hの実装確認）。
-                        RemoteIDEntry latest_entry;
-                        if (dataManager.getLatestEntryForRegistrationNo(String(TARGET_REG_NO_FOR_JSON), latest_entry)) {
-                            targetChannel = latest_entry.channel;
-                        }
-#                   endif
+                    buildChannelLockSchedule();
                     xSemaphoreGive(dataManagerSemaphore);
-                } else {
-                    M5.Log.println("[WARNING] Failed to take semaphore for channel lock target check.");
-                }
-                if (targetChannel != -1 && targetChannel >= 1 && targetChannel <= WIFI_CHANNEL_MAX) {
-                    // 有効なターゲットチャンネルが見つかった場合
-                    if (lockedChannel != targetChannel) { // 現在の固定チャンネルと異なる場合のみ設定変更
-                        esp_err_t err = esp_wifi_set_channel(targetChannel, WIFI_SECOND_CHAN_NONE);
-                        if (err == ESP_OK) {
-                            M5.Log.printf("Channel locked to: %d\n", targetChannel);
-                            lockedChannel = targetChannel; // 固定チャンネルを更新
-                            channel = lockedChannel;       // 表示用のグローバル変数も更新
-                        } else {
-                            M5.Log.printf("[ERROR] Failed to lock channel to %d: %s\n", targetChannel, esp_err_to_name(err));
-                            // lockedChannel = -1; // 設定失敗した場合、ロック解除するかどうかはポリシーによる
-                        }
+                    if (channelLockScheduleLen > 0) {
+                        M5.Log.printf("Channel lock schedule rebuilt: %d channel(s)\n", channelLockScheduleLen);
+                        serviceChannelLockSchedule(true); // 新しいスケジュールの現在スロットへ即座に移動
                     }
                 } else {
-                    // ターゲットが見つからない場合。lockedChannelは変更しない（以前の値または-1を維持）。
-                    // M5.Log.println("Target for channel lock not found or invalid. Maintaining current state.");
+                    M5.Log.println("[WARNING] Failed to take semaphore for channel lock target check.");
                 }
             }
-            // lockedChannelが有効なら、そのチャンネルを維持（esp_wifi_set_channelの頻繁な呼び出しを避ける）。
-            // 表示用の 'channel' 変数はlockedChannelの値を使用。
-            if (lockedChannel != -1) {
-                 channel = lockedChannel; // 表示用チャンネルを固定チャンネルに合わせる
-            } else {
+            if (channelLockScheduleLen == 0) {
                  // ターゲットが見つからず、まだロックできていない場合は、通常のチャンネルスキャンを1ステップ進める
+                 lockedChannel = -1;
                  channel = (channel % WIFI_CHANNEL_MAX) + 1;
                  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
             }
+            // スケジュールが有効な場合のスロット切り替えは、loop()毎に serviceChannelLockSchedule() で行う
         } else {
             // 通常のチャンネルスキャンモード
             channel = (channel % WIFI_CHANNEL_MAX) + 1; // チャンネルを1からWIFI_CHANNEL_MAXまで巡回
@@ -592,138 +1344,9 @@ void loop()
             }
             lockedChannel = -1; // 固定モードではないので-1にリセット
         }
-        // --- 画面表示更新 ---
-        dc.clearDrawingCanvas(); // 描画キャンバスをクリア
-        dc.setCursor(0, 0);      // カーソルを左上にリセット
-        int current_rid_count_total = 0; // データストア内の総RID数
-        int top_rid_entry_count = 0;   // Top RSSIのRIDが持つエントリ数
-        if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) { // セマフォ取得時間を少し伸ばす可能性も考慮
-            current_rid_count_total = dataManager.getRIDCount();
-            // Top RSSIのRIDのエントリ数を取得 (SEND_MODE_TOP_RSSI == 1 の場合)
-            // #if SEND_MODE_TOP_RSSI == 1 // このプリプロセッサはJSON送信モード用なので、表示は常にTopRSSIを基準にするか、別途指定が必要
-                std::vector<std::pair<int, String>> sorted_rids = dataManager.getSortedRIDsByRSSI();
-                if (!sorted_rids.empty()) {
-                    String top_rid_str = sorted_rids[0].second;
-                    // getAllDataForRIDで全件取得し、そのサイズを見るのが確実
-                    // (max_entries=0 は全件取得を意味する)
-                    std::vector<RemoteIDEntry> entries = dataManager.getAllDataForRID(top_rid_str, 0);
-                    top_rid_entry_count = entries.size();
-                }
-            // #endif
-            // もしSEND_MODE_TOP_RSSI が 0 の場合、TARGET_REG_NO_FOR_JSON のエントリ数を表示するなら、
-            // そのためのロジックもここに追加する必要がある。
-            // ここでは簡略化のため、常にTop RSSIのエントリ数を表示対象とする。
-            xSemaphoreGive(dataManagerSemaphore);
-        } else {
-            M5.Log.println("[WARNING] Failed to take dataManagerSemaphore in loop for display counts.");
-        }
-
-        // ヘッダ情報表示
-        char header_buf[120];
-        if (channelLockModeActive) {
-            if (lockedChannel != -1) {
-                // Ch:XX(L) RIDs:Y H:ZZZZ Ents:W
-                snprintf(header_buf, sizeof(header_buf), "Ch:%2d(L) RIDs:%d H:%u Ents:%d",
-                         lockedChannel, current_rid_count_total, ESP.getFreeHeap(), top_rid_entry_count);
-            } else {
-                // Ch:Lock? RIDs:Y H:ZZZZ Ents:W
-                snprintf(header_buf, sizeof(header_buf), "Ch:Lock? RIDs:%d H:%u Ents:%d",
-                         current_rid_count_total, ESP.getFreeHeap(), top_rid_entry_count);
-            }
-        } else {
-            // Ch:XX(S) RIDs:Y H:ZZZZ Ents:W
-            snprintf(header_buf, sizeof(header_buf), "Ch:%2d(S) RIDs:%d H:%u Ents:%d",
-                     channel, current_rid_count_total, ESP.getFreeHeap(), top_rid_entry_count);
-        }
-        dc.println(header_buf);
-        // 区切り線表示
-        String separator = "";
-        for (int i = 0; i < dc.getCols(); ++i) {
-            separator += "-";
-        }
-        dc.println(separator);
-        // セマフォで保護しながらdataManagerから表示用データを取得し描画
-        if (xSemaphoreTake(dataManagerSemaphore, pdMS_TO_TICKS(50)) == pdTRUE) {
-            // RSSI降順でソートされたRIDのリストを取得 (RSSI値, RID文字列 のペア)
-            std::vector<std::pair<int, String>> sorted_rids_info = dataManager.getSortedRIDsByRSSI();
-            int rid_count_available = sorted_rids_info.size();
-            int displayed_count = 0;
-            // 実際に表示するRID数を決定 (利用可能なRID数と画面に表示可能な最大数のうち小さい方)
-            int rids_to_actually_display = min(rid_count_available, max_rids_to_display_calculated);
-            if (rid_count_available > 0) {
-                for (int i = 0; i < rids_to_actually_display && displayed_count < max_rids_to_display_calculated; ++i) {
-                    // 次のRID情報を表示するための行数が画面内に収まるかチェック
-                    if (dc.getPrintCursorRow() + LINES_PER_RID_ENTRY > dc.getRows()) {
-                        break; // 画面からはみ出るならループ中断
-                    }
-                    String current_rid_str = sorted_rids_info[i].second;
-                    if (!current_rid_str.isEmpty()) {
-                        RemoteIDEntry latest_entry; // 最新の受信データを格納する構造体
-                        if (dataManager.getLatestEntryForRID(current_rid_str, latest_entry)) {
-                            char line_buf[128]; // 各行表示用バッファ
-                            // 1行目: RID (RSSI, Ch)
-                            String rid_to_display = current_rid_str;
-                            // " (RSSI,Ch:XX)" のために約15文字消費 + マージンを考慮
-                            int max_rid_len_for_line = dc.getCols() - 16;
-                            if (max_rid_len_for_line < 1) max_rid_len_for_line = 1;
-                            if (rid_to_display.length() > (unsigned int)max_rid_len_for_line) {
-                                rid_to_display = rid_to_display.substring(0, max_rid_len_for_line);
-                            }
-                            snprintf(line_buf, sizeof(line_buf), "%s (%d,Ch:%d)", rid_to_display.c_str(), latest_entry.rssi, latest_entry.channel);
-                            dc.println(line_buf);
-                            // 2行目: 登録記号
-                            if (!latest_entry.registrationNo.isEmpty()) {
-                                String reg_no_to_display = latest_entry.registrationNo;
-                                // "Reg:" のために4文字消費
-                                int max_reg_len = dc.getCols() - 4;
-                                if (max_reg_len < 1) max_reg_len = 1;
-                                if (reg_no_to_display.length() > (unsigned int)max_reg_len) {
-                                    reg_no_to_display = reg_no_to_display.substring(0, max_reg_len);
-                                }
-                                snprintf(line_buf, sizeof(line_buf), "Reg:%s", reg_no_to_display.c_str());
-                                dc.println(line_buf);
-                            } else {
-                                dc.println("Reg:N/A");
-                            }
-                            // 3行目: 緯度/経度
-                            snprintf(line_buf, sizeof(line_buf), "L:%.3f Lo:%.3f", latest_entry.latitude, latest_entry.longitude);
-                            dc.println(line_buf);
-                            // 4行目: 高度情報と受信時刻 (M5StickC時刻)
-                            char time_str[10] = "N/A Time";
-                            time_t entry_time = latest_entry.timestamp; // これはM5StickCのシステム時刻
-                            struct tm *tm_info = localtime(&entry_time);
-                            if (tm_info) {
-                                 snprintf(time_str, sizeof(time_str), "%02d:%02d:%02d", tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
-                            }
-                            snprintf(line_buf, sizeof(line_buf), "P:%.0fm G:%.0fm %s", latest_entry.pressureAltitude, latest_entry.gpsAltitude, time_str);
-                            dc.println(line_buf);
-                            // 5行目: Beacon TSF タイムスタンプ (下位桁のみ表示)
-                            snprintf(line_buf, sizeof(line_buf), "BcnTS: ..%03llu.%06llu",
-                                     (unsigned long long)((latest_entry.beaconTimestamp / 1000000ULL) % 1000ULL),
-                                     (unsigned long long)(latest_entry.beaconTimestamp % 1000000ULL));
-                            dc.println(line_buf);
-                            displayed_count++;
-                        }
-                    }
-                }
-            }
-            // 表示するデータがなかった場合のメッセージ
-            if (displayed_count == 0 && rid_count_available == 0) {
-                 if (dc.getPrintCursorRow() < dc.getRows()) { // 画面に空き行があれば
-                    dc.println("No RID data yet.");
-                 }
-            } else if (displayed_count == 0 && rid_count_available > 0) { // データはあるが表示スペースがなかった場合
-                if (dc.getPrintCursorRow() < dc.getRows()) {
-                    dc.println("No space to show RIDs");
-                }
-            }
-            xSemaphoreGive(dataManagerSemaphore);
-        } else {
-            M5.Log.printf("[WARNING] Failed to take dataManagerSemaphore in loop for display.\n");
-            if (dc.getPrintCursorRow() < dc.getRows()) { // 画面に空き行があれば
-                dc.println("Failed to get data...");
-            }
-        }
-        dc.show(); // 全ての描画が終わったら、描画キャンバスの内容をLCDに転送
     }
+    // --- テレメトリ (ヒープ残量とキュー深さ) の定期記録 ---
+    serviceTelemetrySampler();
+    // --- 画面表示更新 (チャンネル切り替えとは独立したUIフレームスケジューラ) ---
+    serviceUiScheduler(dc);
 }
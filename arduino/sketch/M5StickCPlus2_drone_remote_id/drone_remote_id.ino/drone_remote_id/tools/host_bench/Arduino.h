@@ -0,0 +1,113 @@
+#ifndef HOST_BENCH_ARDUINO_H
+#define HOST_BENCH_ARDUINO_H
+
+/**
+ * @file Arduino.h
+ * @brief ホスト (Linux) でRemoteIDDataManagerとM5CanvasTextDisplayControllerをビルドするための最小限のArduino互換ヘッダ
+ *
+ * RemoteIDDataManager.cpp / RIDBinaryExport.cpp / M5CanvasTextDisplayController.h が使う String、Print、Serial、micros() だけを
+ * std::string と標準Cライブラリで実装します
+ * ベンチマーク専用のため、ESP32版と異なる点 (String の小文字列最適化がないなど) は計測値の比較の際に考慮してください
+ */
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define DEC 10
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/// @brief Arduino の String の代替 (std::string を保持するだけ)
+class String {
+public:
+    String() {}
+    String(const char* cstr) : _s(cstr ? cstr : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(int value) : _s(std::to_string(value)) {}
+    explicit String(unsigned int value) : _s(std::to_string(value)) {}
+
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    const char* c_str() const { return _s.c_str(); }
+    bool isEmpty() const { return _s.empty(); }
+    char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    void trim() {
+        const size_t first = _s.find_first_not_of(" \t\r\n");
+        const size_t last = _s.find_last_not_of(" \t\r\n");
+        _s = first == std::string::npos ? std::string() : _s.substr(first, last - first + 1);
+    }
+    String& operator+=(const String& other) { _s += other._s; return *this; }
+    String& operator+=(const char* other) { _s += other; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    bool equals(const String& other) const { return _s == other._s; }
+    bool operator==(const String& other) const { return _s == other._s; }
+    bool operator==(const char* other) const { return _s == other; }
+    bool operator!=(const String& other) const { return _s != other._s; }
+    bool operator<(const String& other) const { return _s < other._s; }
+
+private:
+    std::string _s;
+};
+
+/// @brief Arduino の StringSumHelper の代替 (ArduinoJson の String アダプタが型として参照するだけ)
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+/// @brief Arduino の Print の代替
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* str) { return write(reinterpret_cast<const uint8_t*>(str), strlen(str)); }
+    size_t print(const char* str) { return write(str); }
+    size_t print(const String& str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned int value) { return printf("%u", value); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+    size_t println() { return write("\r\n"); }
+    template <class T> size_t println(const T& value) { return print(value) + println(); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        const int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (len <= 0) return 0;
+        return write(reinterpret_cast<const uint8_t*>(buf), min((size_t)len, sizeof(buf) - 1));
+    }
+};
+
+/// @brief Arduino の Serial の代替 (出力は捨てる)
+class HostSerial : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+};
+inline HostSerial Serial;
+
+/// @brief 起動からの経過時間 (マイクロ秒)
+inline unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // HOST_BENCH_ARDUINO_H
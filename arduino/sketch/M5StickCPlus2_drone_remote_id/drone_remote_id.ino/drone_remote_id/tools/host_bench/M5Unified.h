@@ -0,0 +1,143 @@
+#ifndef HOST_BENCH_M5UNIFIED_H
+#define HOST_BENCH_M5UNIFIED_H
+
+/**
+ * @file M5Unified.h
+ * @brief ホスト (Linux) でM5CanvasTextDisplayControllerをビルドするための最小限のM5GFX互換ヘッダ
+ *
+ * M5CanvasTextDisplayController が使う M5GFX (LCD) と M5Canvas (スプライト) のメソッドだけを実装します
+ * LCDへの転送 (pushImageDMA) は転送量を数えるだけで、画素は保持しません
+ * 文字は6x8 (テキストサイズ倍) の固定幅で、形は文字コードから決まる模様です (実際のフォントではありません)
+ */
+
+#include "Arduino.h"
+
+#define BLACK 0x0000
+#define WHITE 0xFFFF
+#define RED 0xF800
+#define GREEN 0x07E0
+#define BLUE 0x001F
+#define YELLOW 0xFFE0
+#define CYAN 0x07FF
+#define DARKGREY 0x7BEF
+
+namespace lgfx {
+/// @brief バイトスワップ済みRGB565の画素 (pushImageDMA の型の区別のため)
+struct swap565_t {
+    uint16_t raw;
+};
+} // namespace lgfx
+
+/// @brief LovyanGFX の描画先の共通部分 (テキスト設定と矩形の塗りつぶし)
+class HostGfxBase {
+public:
+    virtual ~HostGfxBase() {}
+    int width() const { return _width; }
+    int height() const { return _height; }
+    void setTextSize(float size) { _textSize = size < 1 ? 1 : (int)size; }
+    void setTextFont(int font) { _textFont = font; }
+    uint8_t getTextFont() const { return (uint8_t)_textFont; }
+    int fontHeight() const { return 8 * _textSize; }
+    int fontWidth() const { return 6 * _textSize; }
+    void setTextColor(uint32_t color) { _textColor = (uint16_t)color; }
+    void setTextColor(uint32_t color, uint32_t) { _textColor = (uint16_t)color; }
+
+protected:
+    int _width = 0;
+    int _height = 0;
+    int _textSize = 1;
+    int _textFont = 0;
+    uint16_t _textColor = WHITE;
+};
+
+/// @brief M5GFX (LCD) の代替。転送した画素数と回数だけを数えます
+class M5GFX : public HostGfxBase {
+public:
+    /// @param width 回転0の幅 (M5StickC Plus2: 135)
+    /// @param height 回転0の高さ (M5StickC Plus2: 240)
+    M5GFX(int width = 135, int height = 240) : _nativeWidth(width), _nativeHeight(height) { setRotation(0); }
+
+    void setRotation(uint8_t rotation) {
+        _rotation = rotation & 3;
+        const bool landscape = (_rotation & 1) != 0;
+        _width = landscape ? _nativeHeight : _nativeWidth;
+        _height = landscape ? _nativeWidth : _nativeHeight;
+    }
+    uint8_t getRotation() const { return _rotation; }
+    void startWrite() {}
+    void endWrite() {}
+    void waitDMA() {}
+    void fillScreen(uint32_t) { pixelsPushed += (uint32_t)_width * _height; }
+    void fillRect(int, int, int w, int h, uint32_t) { pixelsPushed += (uint32_t)(w > 0 ? w : 0) * (h > 0 ? h : 0); }
+    void pushImageDMA(int, int, int w, int h, const lgfx::swap565_t*) {
+        pixelsPushed += (uint32_t)w * h;
+        dmaTransfers++;
+    }
+
+    uint32_t pixelsPushed = 0; ///< LCDへ転送 (または塗りつぶし) した画素数
+    uint32_t dmaTransfers = 0; ///< pushImageDMA の呼び出し回数
+
+private:
+    int _nativeWidth;
+    int _nativeHeight;
+    uint8_t _rotation = 0;
+};
+
+/// @brief M5Canvas (スプライト) の代替。RGB565 (バイトスワップ済み) のバッファを持ちます
+class M5Canvas : public HostGfxBase {
+public:
+    explicit M5Canvas(M5GFX* = nullptr) {}
+    ~M5Canvas() { deleteSprite(); }
+
+    void* createSprite(int width, int height) {
+        deleteSprite();
+        _buffer = new uint16_t[(size_t)width * height]();
+        _width = width;
+        _height = height;
+        return _buffer;
+    }
+    void deleteSprite() {
+        delete[] _buffer;
+        _buffer = nullptr;
+        _width = 0;
+        _height = 0;
+    }
+    void* getBuffer() const { return _buffer; }
+    void fillSprite(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+    void fillRect(int x, int y, int w, int h, uint32_t color) {
+        const uint16_t raw = _swap((uint16_t)color);
+        for (int yy = std::max(y, 0); yy < std::min(y + h, _height); ++yy) {
+            for (int xx = std::max(x, 0); xx < std::min(x + w, _width); ++xx) {
+                _buffer[(size_t)yy * _width + xx] = raw;
+            }
+        }
+    }
+    /// @brief 文字を透過で描きます。5x7の点の有無は文字コードのビットから決めます (空白は何も描かない)
+    size_t drawChar(uint16_t ch, int x, int y, uint8_t) {
+        if (ch == ' ') return fontWidth();
+        const uint16_t raw = _swap(_textColor);
+        for (int gy = 0; gy < 7; ++gy) {
+            for (int gx = 0; gx < 5; ++gx) {
+                if (((ch * 31u + gy * 7u + gx) * 2654435761u >> 29) & 1u) {
+                    for (int sy = 0; sy < _textSize; ++sy) {
+                        for (int sx = 0; sx < _textSize; ++sx) {
+                            const int px = x + gx * _textSize + sx;
+                            const int py = y + gy * _textSize + sy;
+                            if (px >= 0 && px < _width && py >= 0 && py < _height) {
+                                _buffer[(size_t)py * _width + px] = raw;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return fontWidth();
+    }
+
+private:
+    static uint16_t _swap(uint16_t color) { return (uint16_t)((color << 8) | (color >> 8)); }
+
+    uint16_t* _buffer = nullptr;
+};
+
+#endif // HOST_BENCH_M5UNIFIED_H
@@ -0,0 +1,147 @@
+/**
+ * @file display_alloc_test.cpp
+ * @brief M5CanvasTextDisplayController の描画経路がヒープを確保しないことをホスト (Linux) で確認するテスト
+ *
+ * operator new / delete を差し替えて確保回数を数え、メイン画面と同じ形の全画面の書き換え
+ * (clearDrawingCanvas → println / printf / print(const char*, size_t) / print(int) / print(double) /
+ *  printRepeat / setText → show) をフレームごとに内容を変えて繰り返します
+ * 初期化 (begin()、最初の2フレームでの色パレットの登録) の後は、1フレームあたりの確保回数が0であることを確認し、
+ * 0でなければ終了コード1で終了します。ビルドと実行は run_display_alloc_test.sh を参照してください
+ *
+ * 使い方:
+ *   display_alloc_test [--frames=N] [--rotation=0-3] [--text-size=N]
+ */
+#include "M5CanvasTextDisplayController.h"
+#include <cstdlib>
+#include <new>
+
+// ---- ヒープ確保の計測 (operator new / delete を差し替えて回数を数える) ----
+
+namespace {
+
+unsigned long g_allocations = 0; ///< operator new の呼び出し回数
+unsigned long g_frees = 0;       ///< operator delete の呼び出し回数 (nullptrを除く)
+
+void* countedNew(size_t size) {
+    g_allocations++;
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void countedDelete(void* ptr) {
+    if (ptr) g_frees++;
+    free(ptr);
+}
+
+} // namespace
+
+void* operator new(size_t size) { return countedNew(size); }
+void* operator new[](size_t size) { return countedNew(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    g_allocations++;
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    g_allocations++;
+    return malloc(size ? size : 1);
+}
+void operator delete(void* ptr) noexcept { countedDelete(ptr); }
+void operator delete[](void* ptr) noexcept { countedDelete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { countedDelete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { countedDelete(ptr); }
+
+namespace {
+
+const int LINES_PER_RID_ENTRY = 5; ///< 1つのRIDの表示に使う行数 (drone_remote_id.ino と同じ)
+
+/**
+ * @brief メイン画面 (RIDリスト) と同じ形の1フレームを描画します
+ * @details フレーム番号から内容を変え、毎フレームほぼ全行が書き換わって転送されるようにします
+ *          文字列はスタック上の配列だけを使い、String は使いません (テスト対象はコントローラの確保だけ)
+ */
+void drawFrame(M5CanvasTextDisplayController& dc, unsigned frame) {
+    dc.clearDrawingCanvas();
+    dc.setTextColor(WHITE);
+    dc.printf("Ch:%2u(S) RIDs:%u H:%u Ents:%u\n", 1 + frame % 13, 3 + frame % 5, 180000 - frame * 16, frame % 1200);
+    dc.setTextColor(frame % 2 ? YELLOW : CYAN);
+    dc.printf("-- %u-%u/%u B:next ", 1 + frame % 4, 4 + frame % 4, 12u);
+    dc.printRepeat('-', dc.getCols() - dc.getPrintCursorCol());
+    dc.println();
+    for (unsigned i = 0; dc.getPrintCursorRow() + LINES_PER_RID_ENTRY <= dc.getRows() - 1; ++i) {
+        char rid[24];
+        const int rid_len = snprintf(rid, sizeof(rid), "RID-%08u-%04u", frame * 7 + i, i);
+        dc.setTextColor(i == 0 ? GREEN : WHITE);
+        dc.print(rid, (size_t)rid_len);                     // print(const char*, size_t)
+        dc.print(" (");
+        dc.print(-40 - (int)((frame + i) % 50));            // print(int)
+        dc.printf(",Ch:%u)\n", 1 + (frame + i) % 13);
+        dc.printf("Reg:JA.%06u\n", (frame + i * 31) % 1000000);
+        dc.print("L:");
+        dc.print(35.0 + (frame + i) * 1e-3, 3);             // print(double)
+        dc.printf(" Lo:%.3f\n", 139.0 + (frame + i) * 1e-3);
+        dc.printf("P:%.0fm G:%.0fm %02u:%02u:%02u\n", 100.0 + frame, 120.0 + i, frame / 3600 % 24, frame / 60 % 60,
+                  frame % 60);
+        dc.printf("BcnTS: ..%03u.%06u\n", frame % 1000, (frame * 7919 + i) % 1000000);
+    }
+    char overlay[48];
+    snprintf(overlay, sizeof(overlay), "F:%u S:%u %uus", frame, frame / 10, 1000 + frame % 500);
+    dc.setTextColor(DARKGREY);
+    dc.setText(dc.getRows() - 1, 0, overlay);
+    dc.show();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned frames = 200;
+    int rotation = 1; // drone_remote_id.ino と同じ横向き
+    int text_size = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--frames=", 9) == 0) {
+            frames = (unsigned)atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--rotation=", 11) == 0) {
+            rotation = atoi(argv[i] + 11);
+        } else if (strncmp(argv[i], "--text-size=", 12) == 0) {
+            text_size = atoi(argv[i] + 12);
+        } else {
+            fprintf(stderr, "usage: %s [--frames=N] [--rotation=0-3] [--text-size=N]\n", argv[0]);
+            return 2;
+        }
+    }
+    M5GFX lcd; // M5StickC Plus2 (135 x 240)
+    M5CanvasTextDisplayController dc(lcd);
+    if (!dc.begin(text_size, false, GREEN, BLACK, (uint8_t)rotation)) {
+        fprintf(stderr, "begin() failed\n");
+        return 1;
+    }
+    const unsigned long setup_allocations = g_allocations;
+    // 最初の2フレーム (区切り線の色が交互に変わるため) で色パレットを登録する (新しい色の組の登録だけは確保してよい)
+    drawFrame(dc, 0);
+    drawFrame(dc, 1);
+    const unsigned long warmup_allocations = g_allocations - setup_allocations;
+
+    dc.resetFrameStats();
+    const unsigned long pixels_before = lcd.pixelsPushed;
+    const unsigned long allocations_before = g_allocations;
+    const unsigned long frees_before = g_frees;
+    for (unsigned frame = 2; frame < frames + 2; ++frame) {
+        drawFrame(dc, frame);
+    }
+    const unsigned long allocations = g_allocations - allocations_before;
+    const unsigned long frees = g_frees - frees_before;
+    const M5CanvasTextDisplayController::FrameStats& stats = dc.getFrameStats();
+    printf("screen %dx%d, %d rows x %d cols\n", lcd.width(), lcd.height(), dc.getRows(), dc.getCols());
+    printf("setup: %lu allocations, first 2 frames: %lu allocations\n", setup_allocations, warmup_allocations);
+    printf("%u frames: %lu allocations, %lu frees, %u rows pushed (%.1f/frame), %lu pixels\n", frames, allocations, frees,
+           stats.rowsPushed, frames ? (double)stats.rowsPushed / frames : 0.0, lcd.pixelsPushed - pixels_before);
+    if (stats.rowsPushed == 0) {
+        fprintf(stderr, "FAIL: no rows were pushed, the test did not exercise show()\n");
+        return 1;
+    }
+    if (allocations != 0 || frees != 0) {
+        fprintf(stderr, "FAIL: the print/show path allocated on the heap\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file legacy_json_export.cpp
+ * @brief ベンチマーク専用: ArduinoJson で構築していた以前のJSON出力
+ *
+ * JSONの構築と出力の部分は以前の RemoteIDDataManager.cpp のままです
+ * 以前の実装は RemoteIDDataManager のメンバー関数で _data_store を直接走査していましたが、
+ * ここでは公開APIだけを使うため、登録記号の検索は getSortedRIDsByRSSI() + getLatestEntryForRID() で行います
+ * (検索の分だけ以前より遅くなりますが、getJsonForTopRSSI は以前と同じ呼び出しです)
+ */
+// ホスト用の String / Print を ArduinoJson から使えるようにする (Arduino.h の互換実装)
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 1
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 1
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 0
+#define ARDUINOJSON_ENABLE_PROGMEM 0
+#include "legacy_json_export.h"
+#include <ArduinoJson.h>
+
+namespace {
+
+/**
+ * @brief RemoteIDEntryの内容をJsonObjectに格納します (以前の RemoteIDDataManager::_populateJsonEntry)
+ *        JSONのキー名は短縮形を使用します
+ */
+void populateJsonEntry(JsonObject jsonObj, const RemoteIDEntry& entry) {
+    jsonObj["rssi"] = entry.rssi;
+    // ts: UNIX timestamp (seconds) to milliseconds
+    jsonObj["ts"] = (unsigned long long)entry.timestamp * 1000ULL;
+    // bTs: beaconTimestamp (microseconds) to milliseconds (truncate)
+    jsonObj["bTs"] = entry.beaconTimestamp / 1000ULL;
+    jsonObj["ch"] = entry.channel;
+    jsonObj["lat"] = entry.latitude;
+    jsonObj["lon"] = entry.longitude;
+    jsonObj["pAlt"] = entry.pressureAltitude;
+    jsonObj["gAlt"] = entry.gpsAltitude;
+}
+
+/// @brief 空のJSON ("{}") を出力します
+size_t printEmpty(Print& output_stream) {
+    size_t written = output_stream.print("{}");
+    written += output_stream.println();
+    return written;
+}
+
+} // namespace
+
+size_t legacyJsonForTopRSSI(const RemoteIDDataManager& manager, int count, size_t max_log_entries, Print& output_stream) {
+    const size_t jsonDocSize = JSON_OBJECT_SIZE(3) + // For root: rid, reg (optional), elm
+                               JSON_OBJECT_SIZE(8) * max_log_entries + // For each entry in elm (rssi,ts,bTs,ch,lat,lon,pAlt,gAlt)
+                               JSON_ARRAY_SIZE(max_log_entries) +
+                               1024; // Extra buffer
+    DynamicJsonDocument doc(jsonDocSize);
+    JsonObject root = doc.to<JsonObject>();
+    std::vector<std::pair<int, String>> sorted_rids = manager.getSortedRIDsByRSSI();
+    if (sorted_rids.empty() || count < 1) {
+        return printEmpty(output_stream);
+    }
+    String rid_str = sorted_rids[0].second; // Get the top RID
+    std::vector<RemoteIDEntry> entries_for_rid = manager.getAllDataForRID(rid_str, max_log_entries);
+    // Always set rid if available
+    root["rid"] = rid_str;
+    // Get the registration number from the overall latest entry for this RID
+    RemoteIDEntry overall_latest_entry;
+    if (manager.getLatestEntryForRID(rid_str, overall_latest_entry)) {
+        if (!overall_latest_entry.registrationNo.isEmpty()) {
+            root["reg"] = overall_latest_entry.registrationNo;
+        }
+    }
+    JsonArray elmArray = root.createNestedArray("elm");
+    for (const auto& entry_item : entries_for_rid) {
+        JsonObject entryObj = elmArray.createNestedObject();
+        populateJsonEntry(entryObj, entry_item);
+    }
+    size_t written = serializeJson(doc, output_stream);
+    written += output_stream.println();
+    return written;
+}
+
+size_t legacyJsonForRegistrationNo(const RemoteIDDataManager& manager, const String& regNo, size_t max_log_entries,
+                                   Print& output_stream) {
+    const size_t jsonDocSize = JSON_OBJECT_SIZE(3) + // For root: rid, reg, elm
+                               JSON_OBJECT_SIZE(8) * max_log_entries + // For each entry in elm
+                               JSON_ARRAY_SIZE(max_log_entries) +
+                               1024; // Extra buffer
+    DynamicJsonDocument doc(jsonDocSize);
+    JsonObject root = doc.to<JsonObject>();
+    if (regNo.isEmpty()) {
+        return printEmpty(output_stream);
+    }
+    for (const auto& rssi_rid : manager.getSortedRIDsByRSSI()) {
+        const String& rid_str = rssi_rid.second;
+        RemoteIDEntry latest_entry;
+        // Check the latest entry's registration number
+        if (manager.getLatestEntryForRID(rid_str, latest_entry) && latest_entry.registrationNo == regNo) {
+            std::vector<RemoteIDEntry> entries_for_rid = manager.getAllDataForRID(rid_str, max_log_entries);
+            root["rid"] = rid_str;
+            root["reg"] = regNo; // The regNo we searched for
+            JsonArray elmArray = root.createNestedArray("elm");
+            for (const auto& entry_item : entries_for_rid) {
+                JsonObject entryObj = elmArray.createNestedObject();
+                populateJsonEntry(entryObj, entry_item);
+            }
+            size_t written = serializeJson(doc, output_stream);
+            written += output_stream.println();
+            return written;
+        }
+    }
+    return printEmpty(output_stream);
+}
@@ -0,0 +1,24 @@
+#ifndef HOST_BENCH_LEGACY_JSON_EXPORT_H
+#define HOST_BENCH_LEGACY_JSON_EXPORT_H
+
+/**
+ * @file legacy_json_export.h
+ * @brief ベンチマーク専用: ArduinoJson (DynamicJsonDocument) で構築していた以前のJSON出力
+ *
+ * RemoteIDDataManager::getJsonForTopRSSI / getJsonForRegistrationNo をストリーム出力に置き換える前の実装を、
+ * 比較のためにベンチマークの中だけに残したものです。スケッチからは使用しません
+ * ArduinoJson (7.x) のソースが必要なため、run_bench.sh に ARDUINOJSON_DIR を指定した場合だけビルドされます
+ */
+
+#include "RemoteIDDataManager.h"
+
+/// @brief 以前の getJsonForTopRSSI (DynamicJsonDocument を構築してから serializeJson で出力)
+/// @return 出力したバイト数
+size_t legacyJsonForTopRSSI(const RemoteIDDataManager& manager, int count, size_t max_log_entries, Print& output_stream);
+
+/// @brief 以前の getJsonForRegistrationNo (DynamicJsonDocument を構築してから serializeJson で出力)
+/// @return 出力したバイト数
+size_t legacyJsonForRegistrationNo(const RemoteIDDataManager& manager, const String& regNo, size_t max_log_entries,
+                                   Print& output_stream);
+
+#endif // HOST_BENCH_LEGACY_JSON_EXPORT_H
@@ -0,0 +1,350 @@
+/**
+ * @file rid_data_manager_bench.cpp
+ * @brief RemoteIDDataManager の各操作をホスト (Linux) で計測するマイクロベンチマーク
+ *
+ * RID数 (既定: 10/100/1000/10000) とターゲットRIDの履歴長 (1/100/1200) の組み合わせごとにデータストアを構築し、
+ * 以下の操作の1回あたりの時間を計測します
+ *   - getSortedRIDsByRSSI / getRIDsWithDataInLastMinute
+ *   - getAllDataForRID (max_entries: 0=全件/10/100)
+ *   - getJsonForTopRSSI / getJsonForRegistrationNo (max_log_entries: 0=全件/100)
+ *   - addData (既存RIDの更新 / ターゲットRIDのリングバッファへの追加)
+ *
+ * 各操作について、1回あたりの時間に加えて出力バイト数 (JSON出力のみ)、出力速度 (bytes/s)、
+ * 1回の呼び出し中のピークヒープ使用量 (呼び出し前からの増分) を出力します
+ * ヒープは malloc/free を差し替えて数えるため、std::string (String) や std::vector の確保も含みます
+ *
+ * BENCH_LEGACY_ARDUINOJSON を定義してビルドした場合 (run_bench.sh に ARDUINOJSON_DIR を指定した場合) は、
+ * ArduinoJson の DynamicJsonDocument を使っていた以前のJSON出力 (legacy_json_export.cpp) も
+ * getJsonForTopRSSI/legacy / getJsonForRegistrationNo/legacy として同じ条件で計測し、ストリーム出力と比較できます
+ *
+ * 結果は Google Benchmark の --benchmark_format=json と同じ構成のJSON (既定) またはCSVで標準出力へ書き出すため、
+ * データ構造の変更前後の結果を機械的に比較できます。ビルドと実行は run_bench.sh を参照してください
+ *
+ * 使い方:
+ *   rid_data_manager_bench [--format=json|csv] [--min_time=秒] [--rids=10,100,...] [--filter=部分文字列]
+ */
+#include "RemoteIDDataManager.h"
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <malloc.h> // malloc_usable_size (glibc)
+#include <vector>
+#ifndef BENCH_LEGACY_ARDUINOJSON
+#define BENCH_LEGACY_ARDUINOJSON 0 ///< 1の場合はArduinoJsonを使う以前のJSON出力も計測する
+#endif
+#if BENCH_LEGACY_ARDUINOJSON
+#include "legacy_json_export.h"
+#endif
+
+// ---- ヒープ使用量の計測 (glibc の malloc を包んで、確保中のバイト数とそのピークを数える) ----
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+
+long long g_heap_current = 0; ///< 確保中のバイト数 (malloc_usable_size の合計)
+long long g_heap_peak = 0;    ///< g_heap_current の最大値 (resetHeapPeak() で現在値に戻す)
+
+/// @brief 確保したブロックを数えます
+void* countAlloc(void* ptr) {
+    if (ptr) {
+        g_heap_current += malloc_usable_size(ptr);
+        if (g_heap_current > g_heap_peak) g_heap_peak = g_heap_current;
+    }
+    return ptr;
+}
+
+/// @brief 解放するブロックを数えます
+void countFree(void* ptr) {
+    if (ptr) g_heap_current -= malloc_usable_size(ptr);
+}
+
+/// @brief ピークを現在の確保量に戻し、その値を返します
+long long resetHeapPeak() {
+    g_heap_peak = g_heap_current;
+    return g_heap_current;
+}
+
+} // namespace
+
+extern "C" {
+void* malloc(size_t size) { return countAlloc(__libc_malloc(size)); }
+void* calloc(size_t count, size_t size) { return countAlloc(__libc_calloc(count, size)); }
+void* realloc(void* ptr, size_t size) {
+    countFree(ptr);
+    void* result = __libc_realloc(ptr, size);
+    if (!result && ptr && size) { // 失敗した場合は元のブロックが残る
+        countAlloc(ptr);
+        return nullptr;
+    }
+    return countAlloc(result);
+}
+void* memalign(size_t alignment, size_t size) { return countAlloc(__libc_memalign(alignment, size)); }
+void* aligned_alloc(size_t alignment, size_t size) { return countAlloc(__libc_memalign(alignment, size)); }
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    void* ptr = countAlloc(__libc_memalign(alignment, size));
+    if (!ptr) return 12; // ENOMEM
+    *out = ptr;
+    return 0;
+}
+void free(void* ptr) {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+}
+
+namespace {
+
+const char* const TARGET_RID = "RID-TARGET";       ///< 履歴を保持するターゲットRID
+const char* const TARGET_REG_NO = "JA.TARGET0001"; ///< ターゲットRIDの登録記号 (getJsonForRegistrationNo の検索対象)
+const time_t BASE_TIME = 1700000000;               ///< 受信時刻の基準 (UNIX秒)
+const size_t HISTORY_LENGTHS[] = {1, 100, 1200};   ///< ターゲットRIDの履歴長 (TARGET_RID_MAX_DATA まで)
+
+/// @brief 出力したバイト数だけを数える出力先 (JSON出力の計測用)
+class CountingPrint : public Print {
+public:
+    size_t bytes = 0;
+    size_t write(uint8_t) override { bytes++; return 1; }
+    size_t write(const uint8_t*, size_t size) override { bytes += size; return size; }
+};
+
+/// @brief 計測対象の結果を捨てられないようにするための書き込み先
+volatile size_t g_sink = 0;
+
+/// @brief コマンドラインの設定
+struct Config {
+    bool csv = false;                                   ///< trueの場合はCSV、falseの場合はJSONで出力
+    double minTimeSec = 0.2;                            ///< 1つのベンチマークの最小計測時間 (秒)
+    std::vector<int> ridCounts = {10, 100, 1000, 10000}; ///< 計測するRID数
+    std::string filter;                                 ///< 名前にこの文字列を含むベンチマークだけを実行 (空の場合は全て)
+};
+
+/// @brief 1つのベンチマークの結果
+struct Result {
+    std::string name;      ///< ベンチマーク名 (例: "BM_addData/existing/rids:100/hist:1200")
+    std::string family;    ///< 操作名 (例: "addData/existing")
+    int rids;              ///< RID数
+    size_t history;        ///< ターゲットRIDの履歴長
+    int64_t iterations;    ///< 計測した回数
+    double realNs;         ///< 1回あたりの経過時間 (ナノ秒)
+    double cpuNs;          ///< 1回あたりのCPU時間 (ナノ秒)
+    size_t bytesPerIter;   ///< 1回あたりの出力バイト数 (JSON出力以外は0)
+    long long peakHeap;    ///< 1回の呼び出し中のピークヒープ使用量 (呼び出し前からの増分、バイト)
+};
+
+/// @brief プロセスのCPU時間 (ナノ秒) を取得します
+double cpuNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief 1回の操作を計測時間が minTimeSec を超えるまで繰り返し、1回あたりの時間を求めます
+ * @details Google Benchmark と同様に、回数を最大10倍ずつ増やしながら、最小計測時間を超えた回の結果を採用します
+ * @param body 計測する操作 (戻り値は出力バイト数などで、g_sink に加算して最適化で消えないようにします)
+ */
+Result runBenchmark(const Config& config, const std::string& family, int rids, size_t history,
+                    const std::function<size_t()>& body) {
+    Result result{"BM_" + family + "/rids:" + std::to_string(rids) + "/hist:" + std::to_string(history),
+                  family, rids, history, 0, 0, 0, 0, 0};
+    // 計測の前に1回だけ呼び出して、その間のピークヒープ使用量を記録する (ウォームアップを兼ねる)
+    const long long heap_before = resetHeapPeak();
+    g_sink = g_sink + body();
+    result.peakHeap = g_heap_peak - heap_before;
+    int64_t iterations = 1;
+    for (;;) {
+        size_t bytes = 0;
+        const auto real_start = std::chrono::steady_clock::now();
+        const double cpu_start = cpuNowNs();
+        for (int64_t i = 0; i < iterations; ++i) {
+            bytes += body();
+        }
+        const double cpu_ns = cpuNowNs() - cpu_start;
+        const double real_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - real_start).count();
+        g_sink = g_sink + bytes;
+        if (real_ns >= config.minTimeSec * 1e9 || iterations >= 1000000000) {
+            result.iterations = iterations;
+            result.realNs = real_ns / iterations;
+            result.cpuNs = cpu_ns / iterations;
+            result.bytesPerIter = bytes / iterations;
+            return result;
+        }
+        // 最小計測時間の1.4倍になる回数を予測する (最大10倍)
+        const double predicted = real_ns > 0 ? config.minTimeSec * 1e9 * 1.4 / (real_ns / iterations) : iterations * 10.0;
+        iterations = (int64_t)std::min(std::max(predicted, (double)iterations + 1), iterations * 10.0);
+    }
+}
+
+/// @brief RIDの識別子を生成します ("RID-000123")
+String makeRid(int index) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "RID-%06d", index);
+    return String(buf);
+}
+
+/**
+ * @brief rids 件のRID (ターゲットRIDを含む) と、history 件の履歴を持つターゲットRIDでデータストアを構築します
+ * @details ターゲットRIDのRSSIを最も高くするため、getJsonForTopRSSI はターゲットRIDの履歴を出力します
+ *          受信時刻は0～119秒前に分散させ、getRIDsWithDataInLastMinute が約半数のRIDを返すようにします
+ */
+void buildFixture(RemoteIDDataManager& manager, int rids, size_t history) {
+    for (int i = 0; i < rids - 1; ++i) {
+        char reg_no[16];
+        snprintf(reg_no, sizeof(reg_no), "JA.%06d", i);
+        manager.addData(makeRid(i), -40 - (i % 50), BASE_TIME - (i % 120), (uint64_t)i * 102400, 1 + i % 13,
+                        String(reg_no), 35.0f + i * 1e-5f, 139.0f + i * 1e-5f, 100.0f, 120.0f);
+    }
+    for (size_t i = 0; i < history; ++i) {
+        manager.addData(String(TARGET_RID), -20, BASE_TIME - (time_t)(history - i) / 10, (uint64_t)i * 102400, 6,
+                        String(TARGET_REG_NO), 35.5f + i * 1e-6f, 139.5f + i * 1e-6f, 100.0f + i, 120.0f + i);
+    }
+}
+
+/// @brief 1つの組み合わせ (RID数、履歴長) のベンチマークをすべて実行します
+void runSuite(const Config& config, int rids, size_t history, std::vector<Result>& results) {
+    RemoteIDDataManager manager{String(TARGET_RID)};
+    buildFixture(manager, rids, history);
+    const String target_rid(TARGET_RID);
+    const String target_reg_no(TARGET_REG_NO);
+    auto add = [&](const std::string& family, const std::function<size_t()>& body) {
+        const std::string name = "BM_" + family + "/rids:" + std::to_string(rids) + "/hist:" + std::to_string(history);
+        if (!config.filter.empty() && name.find(config.filter) == std::string::npos) {
+            return;
+        }
+        results.push_back(runBenchmark(config, family, rids, history, body));
+    };
+    // 参照系 (データストアを変更しないもの) を先に計測する
+    add("getSortedRIDsByRSSI", [&] { return manager.getSortedRIDsByRSSI().size(); });
+    add("getRIDsWithDataInLastMinute", [&] { return manager.getRIDsWithDataInLastMinute(BASE_TIME).size(); });
+    for (size_t max_entries : {(size_t)0, (size_t)10, (size_t)100}) {
+        add("getAllDataForRID/max:" + std::to_string(max_entries),
+            [&, max_entries] { return manager.getAllDataForRID(target_rid, max_entries).size(); });
+    }
+    for (size_t max_entries : {(size_t)0, (size_t)100}) {
+        add("getJsonForTopRSSI/max:" + std::to_string(max_entries), [&, max_entries] {
+            CountingPrint out;
+            manager.getJsonForTopRSSI(1, max_entries, out);
+            return out.bytes;
+        });
+        add("getJsonForRegistrationNo/max:" + std::to_string(max_entries), [&, max_entries] {
+            CountingPrint out;
+            manager.getJsonForRegistrationNo(target_reg_no, max_entries, out);
+            return out.bytes;
+        });
+#if BENCH_LEGACY_ARDUINOJSON
+        add("getJsonForTopRSSI/legacy/max:" + std::to_string(max_entries), [&, max_entries] {
+            CountingPrint out;
+            legacyJsonForTopRSSI(manager, 1, max_entries, out);
+            return out.bytes;
+        });
+        add("getJsonForRegistrationNo/legacy/max:" + std::to_string(max_entries), [&, max_entries] {
+            CountingPrint out;
+            legacyJsonForRegistrationNo(manager, target_reg_no, max_entries, out);
+            return out.bytes;
+        });
+#endif
+    }
+    // 更新系。RID数は変えず、既存RIDのRSSI変化 (順位インデックスの更新を含む) とリングバッファへの追加を計測する
+    int next_rid = 0;
+    int rssi_step = 0;
+    add("addData/existing", [&] {
+        const int index = rids > 1 ? next_rid++ % (rids - 1) : 0;
+        manager.addData(rids > 1 ? makeRid(index) : target_rid, -40 - (rssi_step++ % 50), BASE_TIME, 0, 1,
+                        String("JA.000000"), 35.0f, 139.0f, 100.0f, 120.0f);
+        return (size_t)0;
+    });
+    add("addData/target", [&] {
+        manager.addData(target_rid, -20, BASE_TIME, 0, 6, target_reg_no, 35.5f, 139.5f, 100.0f, 120.0f);
+        return (size_t)0;
+    });
+}
+
+/// @brief "10,100,1000" 形式のリストを解析します
+std::vector<int> parseIntList(const char* text) {
+    std::vector<int> values;
+    while (*text) {
+        char* end = nullptr;
+        const long value = strtol(text, &end, 10);
+        if (end == text) break;
+        if (value > 0) values.push_back((int)value);
+        text = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+/// @brief 出力速度 (bytes/s) を求めます。JSON出力以外の操作は0
+double bytesPerSecond(const Result& r) {
+    return r.family.compare(0, 7, "getJson") == 0 && r.realNs > 0 ? r.bytesPerIter * 1e9 / r.realNs : 0;
+}
+
+/// @brief 結果をGoogle Benchmark と同じ構成のJSONで出力します
+void printJson(const Config& config, const std::vector<Result>& results) {
+    char date[32];
+    const time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    printf("{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": \"rid_data_manager_bench\",\n"
+           "    \"min_time_s\": %.3f,\n    \"legacy_arduinojson\": %s\n  },\n  \"benchmarks\": [\n",
+           date, config.minTimeSec, BENCH_LEGACY_ARDUINOJSON ? "true" : "false");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        printf("    {\"name\": \"%s\", \"family\": \"%s\", \"rids\": %d, \"history\": %zu, \"iterations\": %lld, "
+               "\"real_time\": %.1f, \"cpu_time\": %.1f, \"time_unit\": \"ns\", \"bytes_per_iteration\": %zu, "
+               "\"bytes_per_second\": %.0f, \"peak_heap_bytes\": %lld}%s\n",
+               r.name.c_str(), r.family.c_str(), r.rids, r.history, (long long)r.iterations,
+               r.realNs, r.cpuNs, r.bytesPerIter, bytesPerSecond(r), r.peakHeap, i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+/// @brief 結果をCSVで出力します
+void printCsv(const std::vector<Result>& results) {
+    printf("name,family,rids,history,iterations,real_time_ns,cpu_time_ns,bytes_per_iteration,bytes_per_second,peak_heap_bytes\n");
+    for (const Result& r : results) {
+        printf("%s,%s,%d,%zu,%lld,%.1f,%.1f,%zu,%.0f,%lld\n", r.name.c_str(), r.family.c_str(), r.rids, r.history,
+               (long long)r.iterations, r.realNs, r.cpuNs, r.bytesPerIter, bytesPerSecond(r), r.peakHeap);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--format=csv") == 0) {
+            config.csv = true;
+        } else if (strcmp(arg, "--format=json") == 0) {
+            config.csv = false;
+        } else if (strncmp(arg, "--min_time=", 11) == 0) {
+            config.minTimeSec = atof(arg + 11);
+        } else if (strncmp(arg, "--rids=", 7) == 0) {
+            config.ridCounts = parseIntList(arg + 7);
+        } else if (strncmp(arg, "--filter=", 9) == 0) {
+            config.filter = arg + 9;
+        } else {
+            fprintf(stderr, "usage: %s [--format=json|csv] [--min_time=SEC] [--rids=10,100,...] [--filter=TEXT]\n", argv[0]);
+            return 2;
+        }
+    }
+    std::vector<Result> results;
+    for (int rids : config.ridCounts) {
+        for (size_t history : HISTORY_LENGTHS) {
+            fprintf(stderr, "running rids:%d hist:%zu ...\n", rids, history); // 進捗は標準エラーへ (標準出力は結果のみ)
+            runSuite(config, rids, history, results);
+        }
+    }
+    if (config.csv) {
+        printCsv(results);
+    } else {
+        printJson(config, results);
+    }
+    return 0;
+}
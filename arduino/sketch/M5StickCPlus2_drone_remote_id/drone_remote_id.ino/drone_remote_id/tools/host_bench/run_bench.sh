@@ -0,0 +1,27 @@
+#!/bin/sh
+# RemoteIDDataManager のホストベンチマークをビルドして実行する
+#
+# 使い方:
+#   ./run_bench.sh                          # JSON (Google Benchmark 形式) を標準出力へ
+#   ./run_bench.sh --format=csv > out.csv   # CSV
+#   ./run_bench.sh --rids=10,100 --filter=addData --min_time=0.5
+#   ARDUINOJSON_DIR=~/Arduino/libraries/ArduinoJson/src ./run_bench.sh --filter=getJson
+#                                           # ArduinoJson を使う以前のJSON出力 (*/legacy) と比較
+#
+# 環境変数 CXX / CXXFLAGS でコンパイラとオプションを変更できます
+set -e
+HERE=$(cd "$(dirname "$0")" && pwd)
+SKETCH="$HERE/../.."
+OUT="${BENCH_BUILD_DIR:-$HERE/build}"
+mkdir -p "$OUT"
+if [ -n "$ARDUINOJSON_DIR" ]; then
+    # ArduinoJson.h のあるディレクトリ (ArduinoJson 7.x の src)
+    LEGACY="-DBENCH_LEGACY_ARDUINOJSON=1 -I$ARDUINOJSON_DIR $HERE/legacy_json_export.cpp"
+else
+    LEGACY=""
+fi
+${CXX:-c++} -std=gnu++17 ${CXXFLAGS:--O2 -DNDEBUG} -Wall \
+    -I"$HERE" -I"$SKETCH" \
+    "$HERE/rid_data_manager_bench.cpp" "$SKETCH/RemoteIDDataManager.cpp" "$SKETCH/RIDBinaryExport.cpp" $LEGACY \
+    -o "$OUT/rid_data_manager_bench"
+exec "$OUT/rid_data_manager_bench" "$@"
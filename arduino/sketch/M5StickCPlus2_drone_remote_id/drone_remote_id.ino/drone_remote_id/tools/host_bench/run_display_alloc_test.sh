@@ -0,0 +1,18 @@
+#!/bin/sh
+# M5CanvasTextDisplayController の描画経路がヒープを確保しないことを確認するテストをビルドして実行する
+#
+# 使い方:
+#   ./run_display_alloc_test.sh                       # 横向き (回転1)、文字サイズ1で200フレーム
+#   ./run_display_alloc_test.sh --rotation=0 --text-size=2
+#
+# 確保があれば終了コード1で終了します。環境変数 CXX / CXXFLAGS でコンパイラとオプションを変更できます
+set -e
+HERE=$(cd "$(dirname "$0")" && pwd)
+SKETCH="$HERE/../.."
+OUT="${BENCH_BUILD_DIR:-$HERE/build}"
+mkdir -p "$OUT"
+${CXX:-c++} -std=gnu++17 ${CXXFLAGS:--O2} -Wall \
+    -I"$HERE" -I"$SKETCH" \
+    "$HERE/display_alloc_test.cpp" \
+    -o "$OUT/display_alloc_test"
+exec "$OUT/display_alloc_test" "$@"
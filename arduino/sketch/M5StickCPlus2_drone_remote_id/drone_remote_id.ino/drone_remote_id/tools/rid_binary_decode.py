@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""drone_remote_id のバイナリ出力 (SEND_FORMAT_BINARY 1) を JSON / CSV に変換するツール
+
+フレーム形式は RIDBinaryExport.h を参照してください
+シリアルに混ざったログ文字列や壊れたフレームは CRC で検出して読み飛ばします
+
+使い方:
+    # 保存済みのキャプチャを変換
+    python3 rid_binary_decode.py capture.bin --format csv > out.csv
+    # シリアルポートから直接読む (pyserial が必要)
+    python3 rid_binary_decode.py --port /dev/ttyACM0 --baud 115200
+    # "since" コマンドで差分だけを定期的に取得し続ける
+    python3 rid_binary_decode.py --port /dev/ttyACM0 --follow 5
+"""
+import argparse
+import csv
+import json
+import struct
+import sys
+
+MAGIC = b"RB"
+VERSION = 3
+FLAG_LAST = 0x01  # 1回の出力の最後のフレーム
+FLAG_MORE = 0x02  # 出力件数の上限で打ち切ったため、まだ続きがある
+ENTRY = struct.Struct("<bBI6siihh")  # RemoteIDPackedEntry (24バイト)
+CSV_FIELDS = ["rid", "reg", "seq", "rssi", "ts", "bTs", "ch", "lat", "lon", "pAlt", "gAlt"]
+
+
+def crc16_ccitt_false(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0:
+            return None
+        block = data[i + 1:i + code]
+        if len(block) != code - 1:
+            return None
+        out += block
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_payload(payload):
+    """1フレーム分のペイロードを辞書に変換する。不正な場合は None"""
+    if payload is None or len(payload) < 10:
+        return None
+    body, crc = payload[:-2], struct.unpack_from("<H", payload, len(payload) - 2)[0]
+    if crc16_ccitt_false(body) != crc or body[:2] != MAGIC or body[2] != VERSION:
+        return None
+    flags = body[3]
+    pos = 4
+    rid_len = body[pos]
+    rid = body[pos + 1:pos + 1 + rid_len].decode("utf-8", "replace")
+    pos += 1 + rid_len
+    reg_len = body[pos]
+    reg = body[pos + 1:pos + 1 + reg_len].decode("utf-8", "replace")
+    pos += 1 + reg_len
+    count, cursor = struct.unpack_from("<HI", body, pos)
+    pos += 6
+    if len(body) != pos + count * ENTRY.size:
+        return None
+    elm = []
+    for k in range(count):
+        rssi, ch, ts, bts, lat, lon, palt, galt = ENTRY.unpack_from(body, pos + k * ENTRY.size)
+        elm.append({
+            # キー名と単位はデバイスのJSON出力に合わせる
+            "rssi": rssi,
+            "ts": ts * 1000,
+            "bTs": int.from_bytes(bts, "little") // 1000,
+            "ch": ch,
+            "lat": round(lat / 1e7, 6),
+            "lon": round(lon / 1e7, 6),
+            "pAlt": palt / 10.0,
+            "gAlt": galt / 10.0,
+        })
+    frame = {"rid": rid}
+    if reg:
+        frame["reg"] = reg
+    if count:
+        frame["from"] = cursor - count + 1
+    frame["seq"] = cursor
+    frame["last"] = bool(flags & FLAG_LAST)
+    if flags & FLAG_MORE:
+        frame["more"] = True
+    frame["elm"] = elm
+    return frame
+
+
+class FrameSplitter:
+    """受信したバイト列を 0x00 区切りで分割し、正しいフレームだけを返す"""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, chunk, keep_bad=False):
+        """keep_bad が True の場合は、読み飛ばしたフレームの位置に None を入れて返す"""
+        self.buf += chunk
+        frames = []
+        while True:
+            idx = self.buf.find(b"\x00")
+            if idx < 0:
+                return frames
+            raw = bytes(self.buf[:idx])
+            del self.buf[:idx + 1]
+            if raw:
+                frame = parse_payload(cobs_decode(raw))
+                if frame is not None or keep_bad:
+                    frames.append(frame)
+
+
+def iter_frames(chunks):
+    splitter = FrameSplitter()
+    for chunk in chunks:
+        yield from splitter.feed(chunk)
+
+
+REPLY_TIMEOUT = 5.0  # since の応答で、フレームの間隔がこれを超えたら応答が途切れたとみなす (秒)
+
+
+def follow_frames(args):
+    """since コマンドで前回のカーソル以降の差分だけを要求し続ける
+
+    1回の応答は複数のフレームに分かれるため、FLAG_LAST のフレームを受け取るまで読んでから次の since を送る
+    (途中で次を要求すると、まだ受信していないフレームと次の応答が重なり、同じエントリを二重に受け取る)
+    CRC などで読み飛ばしたフレームがあれば、その応答の残りは捨てて、最後に受け取ったカーソルから要求し直す
+    (先に進めると、読み飛ばしたエントリがリングバッファから失われたものと区別できなくなる)
+    """
+    import serial  # pyserial
+    import time
+    cursor, rid = args.since, args.rid or ""
+    splitter = FrameSplitter()
+    with serial.Serial(args.port, args.baud, timeout=0.2) as ser:
+        while True:
+            ser.write(f"since {cursor} {rid}\n".encode())
+            next_request = time.monotonic() + args.follow
+            last_frame_time = time.monotonic()
+            last = None
+            dropped = False
+            while last is None and time.monotonic() - last_frame_time < REPLY_TIMEOUT:
+                for frame in splitter.feed(ser.read(4096), keep_bad=True):
+                    last_frame_time = time.monotonic()
+                    if frame is None:
+                        dropped = True
+                        continue
+                    if frame["last"]:
+                        last = frame
+                    if dropped:
+                        continue
+                    if frame["rid"]:
+                        if frame["seq"] < cursor:
+                            print(f"# sequence reset on device ({cursor} -> {frame['seq']})", file=sys.stderr)
+                        elif frame["elm"] and frame["from"] > cursor + 1:
+                            print(f"# {frame['from'] - cursor - 1} entries lost from ring buffer", file=sys.stderr)
+                        cursor, rid = frame["seq"], frame["rid"]
+                    yield frame
+            if last is None:
+                print(f"# no end-of-export frame within {REPLY_TIMEOUT:.0f} s, requesting again", file=sys.stderr)
+                continue
+            if dropped:
+                print(f"# dropped a corrupted frame, requesting again from {cursor}", file=sys.stderr)
+                continue
+            if last.get("more"):
+                continue  # 出力件数の上限で打ち切られた続きがあるのですぐに次を要求する
+            time.sleep(max(0.0, next_request - time.monotonic()))
+
+
+def read_chunks(args):
+    if args.port:
+        import serial  # pyserial
+        with serial.Serial(args.port, args.baud, timeout=1) as ser:
+            while True:
+                yield ser.read(4096)
+    else:
+        f = open(args.input, "rb") if args.input != "-" else sys.stdin.buffer
+        while True:
+            chunk = f.read(4096)
+            if not chunk:
+                break
+            yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description="drone_remote_id のバイナリ出力を JSON / CSV に変換します")
+    parser.add_argument("input", nargs="?", default="-", help="入力ファイル (省略時は標準入力)")
+    parser.add_argument("--port", help="シリアルポートから直接読む (例: /dev/ttyACM0)")
+    parser.add_argument("--baud", type=int, default=115200, help="シリアルのボーレート")
+    parser.add_argument("--format", choices=["json", "csv"], default="json", help="出力形式")
+    parser.add_argument("--follow", type=float, metavar="SEC",
+                        help="SEC秒ごとに since コマンドを送り、差分だけを取得し続ける (--port が必要)")
+    parser.add_argument("--since", type=int, default=0, help="--follow の最初のカーソル (受信済みの最後のシーケンス番号)")
+    parser.add_argument("--rid", help="--follow で追跡するRID (省略時はデバイスの出力対象)")
+    args = parser.parse_args()
+    if args.follow and not args.port:
+        parser.error("--follow requires --port")
+
+    writer = None
+    if args.format == "csv":
+        writer = csv.DictWriter(sys.stdout, fieldnames=CSV_FIELDS)
+        writer.writeheader()
+    frames = follow_frames(args) if args.follow else iter_frames(read_chunks(args))
+    for frame in frames:
+        if writer is None:
+            print(json.dumps(frame, separators=(",", ":")), flush=True)
+        else:
+            for k, e in enumerate(frame["elm"]):
+                writer.writerow(dict(rid=frame["rid"], reg=frame.get("reg", ""), seq=frame["from"] + k, **e))
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -6,6 +6,7 @@
 #include <fuzzy_table.h>
 #include <PID_Beta6.h>
 #include <MotorWheel.h>
+#define OMNI4WD_PID_TIMER /* Omni.PIDTimerEnable() のタイマー0の割り込みをこのスケッチで定義する */
 #include <Omni4WD.h>
 #define Enable_I2C
 #ifdef Enable_I2C
@@ -21,6 +22,16 @@ TwoStickControlMotor spradcon;
 // SILENTが有効なさいに消したい処理をここに書く
 #endif
 #define VERSION_STRING "0.0.2"
+//#define PID_FEEDFORWARD /* 有効にするとモーターモデルのフィードフォワードで目標速度の変化に追従させる */
+#ifdef PID_FEEDFORWARD
+// tools/host_sim の Namiki モーターのモデルに合わせた値。実機では速度とデューティを測って合わせ直す
+#define FF_GAIN256 273 /* 目標RPM→デューティ(MAX_PWMでMAX_SPEEDRPMとしたRPM換算)の傾き x256 */
+#define FF_OFFSET_RPM 601 /* モーターの不感帯 (RPM換算) */
+#endif
+//#define PID_AUTOTUNE /* 有効にすると起動時に各ホイールのPIDゲインをオートチューニングしてEEPROMに保存する (ロボットがその場で回転する) */
+//#define PID_GAIN_SCHEDULE /* 有効にすると誤差とその変化に応じてfuzzy_table.hのルールでP,Iゲインを増減させる */
+#define PID_EEPROM_ADDR 0 /* PIDゲインを保存するEEPROMの先頭アドレス */
+#define PID_EEPROM_MAGIC 0x5044
 //以下の定義で進行方向を変える
 #define DIR_A DIR_ADVANCE
 #define DIR_B DIR_BACKOFF
@@ -59,6 +70,16 @@ MotorWheel wheel2(3,2,4,5,&irq2);
 MotorWheel wheel3(10,7,6,13,&irq3);
 MotorWheel wheel4(9,8,16,17,&irq4);
 Omni4WD Omni(&wheel1,&wheel2,&wheel3,&wheel4);
+MotorWheel* const wheels[] = {&wheel1, &wheel2, &wheel3, &wheel4};
+
+// EEPROMに保存するホイール毎のPIDゲイン
+struct PIDTunings {
+  unsigned int magic;
+  float kc[4];
+  float taui[4];
+  float taud[4];
+  unsigned char sum; // magicからtaudまでのチェックサム
+};
 
 void setup() {
   Serial.begin(115200);
@@ -72,7 +93,91 @@ void setup() {
   //TCCR0B=TCCR0B&0xf8|0x01;    // warning!! it will change millis()
   TCCR1B=TCCR1B&0xf8|0x01;    // Pin9,Pin10 PWM 31250Hz
   TCCR2B=TCCR2B&0xf8|0x01;    // Pin3,Pin11 PWM 31250Hz
+#ifdef PID_FEEDFORWARD
+  // 目標速度の変化はフィードフォワードとI項で追い、P項は測定値のみに掛ける (目標変化でのキックなし)
+  // 上限で切られた分はI項から差し戻す (アンチワインドアップ)
+  Omni.PIDEnable(0.3,0.1,0,10);
+  for (int i = 0; i < 4; i++) {
+    wheels[i]->PIDSetFeedForward(FF_GAIN256, FF_OFFSET_RPM);
+    wheels[i]->SetProportionalOnInput(true);
+    wheels[i]->PIDSetAntiWindup(1);
+  }
+#else
   Omni.PIDEnable(0.31,0.01,0,10); //float kc,float taui,float taud,unsigned int interval//P比例,I積分,D微分,T時間
+#endif
+  // 速度は最後の1パルス周期から求める (従来どおり)。SPEED_EST_AVERAGE は平均の分だけ推定が遅れ、
+  // このゲインでは低速 (500RPM) や減速のステップで発振する (tools/host_sim の --scenario=estimator と step を参照)
+  wheel1.setSpeedEstimator(SPEED_EST_PERIOD);
+  wheel2.setSpeedEstimator(SPEED_EST_PERIOD);
+  wheel3.setSpeedEstimator(SPEED_EST_PERIOD);
+  wheel4.setSpeedEstimator(SPEED_EST_PERIOD);
+  // PIDの計算を float ではなく整数で行う (ライブラリの既定は float。出力の差は2以下、tools/host_sim の --scenario=pid)
+  wheel1.SetFixedPoint(true);
+  wheel2.SetFixedPoint(true);
+  wheel3.SetFixedPoint(true);
+  wheel4.SetFixedPoint(true);
+#ifndef PID_AUTOTUNE
+  // オートチューニングの結果が保存されていれば、上のゲインの代わりに使う
+  // SetTunings() は固定小数点の係数を1つずつ書き換えるので、タイマー割り込みを始める前に呼ぶ
+  loadPIDTunings();
+#endif
+  Omni.PIDTimerEnable(); // PIDの計算はタイマー割り込みで10.24ms毎に行い、loop()の処理時間に左右されない
+#ifdef PID_AUTOTUNE
+  // 各ホイールをリレー制御で発振させ、限界ゲインと発振周期からPIDゲインを決める (Tyreus-Luyben)
+  // 求めたゲインは PIDAutoTune() がタイマーを止めて設定する
+  if (Omni.PIDAutoTune()) {
+    savePIDTunings();
+  } else {
+    Serial.print(F("PID autotune failed\r\n"));
+  }
+#endif
+#ifdef PID_GAIN_SCHEDULE
+  // 誤差256RPM、誤差の変化64RPM毎に1段階、1段階でゲインを±25% (実行中にSetGainSchedule(false)で戻せる)
+  for (int i = 0; i < 4; i++) {
+    wheels[i]->SetGainSchedule(true, 8, 6, 64);
+  }
+#endif
+#ifndef SILENT
+  for (int i = 0; i < 4; i++) {
+    Serial.print(F("wheel"));
+    Serial.print(i + 1);
+    Serial.print(F(" kc="));
+    Serial.print(wheels[i]->GetP_Param());
+    Serial.print(F(" taui="));
+    Serial.print(wheels[i]->GetI_Param(), 3);
+    Serial.print(F("\r\n"));
+  }
+#endif
+}
+
+unsigned char pidTuningsSum(const unsigned char* p, int n) {
+  unsigned char sum = 0;
+  while (n--) sum += *p++;
+  return ~sum;
+}
+
+bool loadPIDTunings() {
+  struct PIDTunings t;
+  EEPROM.get(PID_EEPROM_ADDR, t);
+  if (t.magic != PID_EEPROM_MAGIC || t.sum != pidTuningsSum((const unsigned char*)&t, sizeof(t) - 1)) {
+    return false; // 未保存
+  }
+  for (int i = 0; i < 4; i++) {
+    wheels[i]->SetTunings(t.kc[i], t.taui[i], t.taud[i]);
+  }
+  return true;
+}
+
+void savePIDTunings() {
+  struct PIDTunings t;
+  t.magic = PID_EEPROM_MAGIC;
+  for (int i = 0; i < 4; i++) {
+    t.kc[i] = wheels[i]->GetP_Param();
+    t.taui[i] = wheels[i]->GetI_Param();
+    t.taud[i] = wheels[i]->GetD_Param();
+  }
+  t.sum = pidTuningsSum((const unsigned char*)&t, sizeof(t) - 1);
+  EEPROM.put(PID_EEPROM_ADDR, t); // 値が変わったバイトだけ書き込まれる
 }
 
 void loop(){
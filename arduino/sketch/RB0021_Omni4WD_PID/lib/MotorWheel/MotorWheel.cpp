@@ -1,14 +1,33 @@
 #include<MotorWheel.h>
 
+// irqISR4X(), A leads B when advancing: 00 -> 10 -> 11 -> 01 -> 00 (A<<1|B), 202610
+const signed char quadStepTable[16]={
+//	to 00	01	10	11
+	0,	-1,	+1,	0,	// from 00
+	+1,	0,	0,	-1,	// from 01
+	-1,	0,	0,	+1,	// from 10
+	0,	+1,	-1,	0,	// from 11
+};
+
 Motor::Motor(unsigned char _pinPWM,unsigned char _pinDir,
 				unsigned char _pinIRQ,unsigned char _pinIRQB,
 				struct ISRVars* _isr)
 		:PID(&speedRPMInput,&speedRPMOutput,&speedRPMDesired,KC,TAUI,TAUD),
-		 pinPWM(_pinPWM),pinDir(_pinDir),isr(_isr) {
+		 pinPWM(_pinPWM),pinDir(_pinDir),isr(_isr),
+		 speedRPMInput(0),speedRPMOutput(0),speedRPMDesired(0),speed2DutyCycle(0),pidTimerDriven(false),
+		 speedEstimator(SPEED_EST_PERIOD),speedStallMicros(SPEED_STALL_MS*1000UL),
+		 ffGain256(0),ffOffsetRPM(0),antiWindupShift(0),atStatus(AUTOTUNE_OFF) {
 	debug();
 
 	isr->pinIRQ=_pinIRQ;
 	isr->pinIRQB=_pinIRQB;
+	// for the direct port read in irqISR(), 202610
+	isr->inIRQ=PIN_IN_REG(_pinIRQ);
+	isr->maskIRQ=PIN_IN_MASK(_pinIRQ);
+	if(_pinIRQB!=PIN_UNDEFINED) {
+		isr->inIRQB=PIN_IN_REG(_pinIRQB);
+		isr->maskIRQB=PIN_IN_MASK(_pinIRQB);
+	}
 
 /*for maple*/	
 #if defined(BOARD_maple) || defined(BOARD_maple_native) || defined(BOARD_maple_mini)
@@ -31,6 +50,10 @@ Motor::Motor(unsigned char _pinPWM,unsigned char _pinDir,
 }
 
 void Motor::setupInterrupt() {
+	if(isr->decodeMode==ISR_DECODE_4X && isr->pinIRQB!=PIN_UNDEFINED) {
+		setupInterrupt4X();
+		return;
+	}
 /*for maple*/
 #if defined(BOARD_maple) || defined(BOARD_maple_native) || defined(BOARD_maple_mini)
 	attachInterrupt(isr->pinIRQ,isr->ISRfunc,TRIGGER);	// RISING --> CHANGE 201207
@@ -52,6 +75,24 @@ void Motor::setupInterrupt() {
 #endif
 }
 
+// irqISR4X(), CHANGE of both channels, 202610
+void Motor::setupInterrupt4X() {
+	isr->quadState=(PIN_IN_READ(isr->inIRQ,isr->maskIRQ,isr->pinIRQ)<<1)|
+					PIN_IN_READ(isr->inIRQB,isr->maskIRQB,isr->pinIRQB);
+/*for maple*/
+#if defined(BOARD_maple) || defined(BOARD_maple_native) || defined(BOARD_maple_mini)
+	attachInterrupt(isr->pinIRQ,isr->ISRfunc,CHANGE);
+	attachInterrupt(isr->pinIRQB,isr->ISRfunc,CHANGE);
+
+/*for arduino*/
+#else
+	if(isr->pinIRQ==2 || isr->pinIRQ==3) attachInterrupt(isr->pinIRQ-2,isr->ISRfunc,CHANGE);
+	else PCattachInterrupt(isr->pinIRQ,isr->ISRfunc,CHANGE);
+	if(isr->pinIRQB==2 || isr->pinIRQB==3) attachInterrupt(isr->pinIRQB-2,isr->ISRfunc,CHANGE);
+	else PCattachInterrupt(isr->pinIRQB,isr->ISRfunc,CHANGE);
+#endif
+}
+
 unsigned char Motor::getPinPWM() const {
 	debug();
 	return pinPWM;
@@ -135,9 +176,10 @@ unsigned int Motor::setSpeedRPM(int speedRPM,bool dir) {
 // direction sensitive 201208	
 int Motor::getSpeedRPM() const {
 	debug();
+	unsigned int speedPPS=getSpeedPPS();
 	if(getCurrDir()==DIR_ADVANCE)
-		return SPEEDPPS2SPEEDRPM(isr->speedPPS);
-	return -SPEEDPPS2SPEEDRPM(isr->speedPPS);
+		return SPEEDPPS2SPEEDRPM(speedPPS);
+	return -SPEEDPPS2SPEEDRPM(speedPPS);
 }
 int Motor::setSpeedRPM(int speedRPM) {
 	debug();
@@ -158,6 +200,7 @@ bool Motor::PIDEnable(float kc,float taui,float taud,unsigned int sampleTime) {
 }
 bool Motor::PIDDisable() {
 	debug();
+	PIDAutoTuneCancel();
 
 	return pidCtrl=false;
 }
@@ -179,8 +222,10 @@ bool Motor::PIDSetup(float kc,float taui,float taud,unsigned int sampleTime) {
 }
 unsigned int Motor::PIDSetSpeedRPMDesired(unsigned int speedRPM) {
 	debug();
+	noInterrupts();		// read by the control timer, Omni4WD::PIDTimerEnable(), 202610
 	if(speedRPM>MAX_SPEEDRPM) speedRPMDesired=MAX_SPEEDRPM;
 	else speedRPMDesired=speedRPM;
+	interrupts();
 	return PIDGetSpeedRPMDesired();
 }
 unsigned int Motor::PIDGetSpeedRPMDesired() const {
@@ -191,27 +236,169 @@ unsigned int Motor::PIDGetSpeedRPMDesired() const {
 bool Motor::PIDRegulate(bool doRegulate) {
 	debug();
 	if(PIDGetStatus()==false) return false;
+	if(pidTimerDriven) return false;	// the control timer regulates, delayMS() and others must not, 202610
+	return PIDRegulateSpeed(updateSpeedPPS(),doRegulate,false);
+}
+// 202610, fixed rate control timer, Omni4WD::controlTick().
+// The edges were sampled together with the other wheels, and the PID computes every call.
+bool Motor::PIDRegulate(const struct EdgeSample& sample,bool doRegulate) {
+	if(PIDGetStatus()==false) return false;
+	return PIDRegulateSpeed(updateSpeedPPS(sample),doRegulate,true);
+}
+bool Motor::PIDSetTimerDriven(bool timerDriven) {
+	return pidTimerDriven=timerDriven;
+}
+bool Motor::PIDGetTimerDriven() const {
+	return pidTimerDriven;
+}
+bool Motor::PIDRegulateSpeed(unsigned int speedPPS,bool doRegulate,bool computeNow) {
 	if(getPinIRQB()!=PIN_UNDEFINED && getDesiredDir()!=getCurrDir()) {
-		speedRPMInput=-SPEEDPPS2SPEEDRPM(isr->speedPPS);
+		speedRPMInput=-SPEEDPPS2SPEEDRPM(speedPPS);
 	} else {
-		speedRPMInput=SPEEDPPS2SPEEDRPM(isr->speedPPS);
+		speedRPMInput=SPEEDPPS2SPEEDRPM(speedPPS);
 	}
 
-	PID::Compute();
+	if(computeNow) PID::ComputeNow();
+	else PID::Compute();
 	if(doRegulate && PID::JustCalculated()) {
-		speed2DutyCycle+=speedRPMOutput;
-
-		if(speed2DutyCycle>=MAX_SPEEDRPM) speed2DutyCycle=MAX_SPEEDRPM;
-		else if(speed2DutyCycle<=-MAX_SPEEDRPM)  speed2DutyCycle=-MAX_SPEEDRPM;
-		if(speed2DutyCycle>=0) {
-			runPWM(map(speed2DutyCycle,0,MAX_SPEEDRPM,0,MAX_PWM),getDesiredDir(),false);
+		if(atStatus==AUTOTUNE_RUNNING) return PIDAutoTuneRegulate();	// 202610
+		//speed2DutyCycle+=speedRPMOutput;
+		//if(speed2DutyCycle>=MAX_SPEEDRPM) speed2DutyCycle=MAX_SPEEDRPM;
+		//else if(speed2DutyCycle<=-MAX_SPEEDRPM)  speed2DutyCycle=-MAX_SPEEDRPM;
+
+		// 202610, speed2DutyCycle integrates the PID output (velocity form), the static
+		// feed-forward is added on top of it, and the part cut by the duty limit is fed
+		// back to speed2DutyCycle (back-calculation anti-windup).
+		// With no feed-forward and antiWindupShift 0 this is the clamp above.
+		long duty=speed2DutyCycle+speedRPMOutput+PIDGetFeedForward();
+		long dutySat=duty;
+		if(dutySat>=MAX_SPEEDRPM) dutySat=MAX_SPEEDRPM;
+		else if(dutySat<=-MAX_SPEEDRPM) dutySat=-MAX_SPEEDRPM;
+		speed2DutyCycle+=speedRPMOutput+((dutySat-duty)>>antiWindupShift);
+
+		if(dutySat>=0) {
+			runPWM(map(dutySat,0,MAX_SPEEDRPM,0,MAX_PWM),getDesiredDir(),false);
 		} else {
-			runPWM(map(abs(speed2DutyCycle),0,MAX_SPEEDRPM,0,MAX_PWM),!getDesiredDir(),false);
+			runPWM(map(abs(dutySat),0,MAX_SPEEDRPM,0,MAX_PWM),!getDesiredDir(),false);
 		}
 		return true;
 	}
 	return false;
 }
+// 202610, static feed-forward from the motor model:
+// duty (in RPM of MAX_SPEEDRPM at MAX_PWM) = desired RPM * gain256 / 256 + offsetRPM.
+// offsetRPM covers the dead band of the motor. gain256 0 (default) disables it.
+bool Motor::PIDSetFeedForward(unsigned int gain256,unsigned int offsetRPM) {
+	ffGain256=gain256;
+	ffOffsetRPM=offsetRPM;
+	return ffGain256!=0 || ffOffsetRPM!=0;
+}
+int Motor::PIDGetFeedForward() const {
+	if(speedRPMDesired==0) return 0;
+	return ((unsigned long)speedRPMDesired*ffGain256>>8)+ffOffsetRPM;
+}
+// the time constant of the anti-windup tracking, 2^trackShift sample times.
+// 0 (default) takes back all the excess at once.
+unsigned char Motor::PIDSetAntiWindup(unsigned char trackShift) {
+	if(trackShift>7) trackShift=7;
+	return antiWindupShift=trackShift;
+}
+
+// 202610, relay feedback auto-tune (Astrom-Hagglund).
+// Run the wheel at the speed to tune for with the PID enabled, wait until it settles, then
+// start. The relay replaces the PID output: duty = the settled duty +-relayRPM, switched
+// when the speed crosses the desired speed +-hystRPM. The wheel oscillates at the period
+// where the loop has 180 degrees of phase lag (the ultimate period Tu), with an amplitude
+// a that gives the ultimate gain Ku = 4 * relayRPM / (PI * sqrt(a^2 - hystRPM^2)).
+// The PID is still computed every sample, so it resumes bumpless with the old tunings;
+// PIDAutoTuneGetTunings() proposes new ones, PID::SetTunings() applies them.
+bool Motor::PIDAutoTuneStart(unsigned int relayRPM,unsigned int hystRPM,unsigned char cycles) {
+	if(PIDGetStatus()==false || speedRPMDesired==0 || relayRPM==0 || cycles==0) return false;
+	noInterrupts();		// the control timer may run PIDRegulate()
+	atHigh=true;
+	atCycles=cycles;
+	atSwitches=0;
+	atRelayRPM=relayRPM;
+	atHystRPM=hystRPM;
+	atBias=speed2DutyCycle+PIDGetFeedForward();
+	atMax=atMin=speedRPMInput;
+	atPeakSum=0;
+	atStartMS=millis();
+	atStatus=AUTOTUNE_RUNNING;
+	interrupts();
+	return true;
+}
+void Motor::PIDAutoTuneCancel() {
+	noInterrupts();
+	if(atStatus==AUTOTUNE_RUNNING) PIDAutoTuneStop(AUTOTUNE_OFF);
+	interrupts();
+}
+unsigned char Motor::PIDAutoTuneGetStatus() const {
+	return atStatus;
+}
+void Motor::PIDAutoTuneStop(unsigned char status) {
+	speed2DutyCycle=atBias-PIDGetFeedForward();	// back to the duty before the relay
+	atStatus=status;
+}
+bool Motor::PIDAutoTuneRegulate() {
+	unsigned long now=millis();
+	int speed=speedRPMInput;
+	if(speed>atMax) atMax=speed;
+	if(speed<atMin) atMin=speed;
+	if(atHigh && speed>speedRPMDesired+atHystRPM) {
+		atHigh=false;
+	} else if(!atHigh && speed<speedRPMDesired-atHystRPM) {
+		atHigh=true;		// a cycle ends at every low --> high switch
+		++atSwitches;
+		if(atSwitches==2) {
+			atFirstMS=now;	// the cycle up to the first switch was not a full one, the next one warmed up
+		} else if(atSwitches>2) {
+			atPeakSum+=atMax-atMin;
+			if(atSwitches-2>=atCycles) {
+				atLastMS=now;
+				PIDAutoTuneStop(AUTOTUNE_DONE);
+				return false;
+			}
+		}
+		atMax=atMin=speed;
+	}
+	if(now-atStartMS>AUTOTUNE_TIMEOUT_MS) {	// no oscillation, the relay is too small for the dead band?
+		PIDAutoTuneStop(AUTOTUNE_FAILED);
+		return false;
+	}
+
+	long duty=atHigh?atBias+atRelayRPM:atBias-atRelayRPM;
+	if(duty>=MAX_SPEEDRPM) duty=MAX_SPEEDRPM;
+	else if(duty<=-MAX_SPEEDRPM) duty=-MAX_SPEEDRPM;
+	if(duty>=0) {
+		runPWM(map(duty,0,MAX_SPEEDRPM,0,MAX_PWM),getDesiredDir(),false);
+	} else {
+		runPWM(map(-duty,0,MAX_SPEEDRPM,0,MAX_PWM),!getDesiredDir(),false);
+	}
+	return true;
+}
+bool Motor::PIDAutoTuneGetResult(float& ku,float& tuSec) const {
+	if(atStatus!=AUTOTUNE_DONE) return false;
+	float a=(float)atPeakSum/(2*atCycles);	// amplitude of the speed
+	if(a<=atHystRPM) return false;
+	ku=4*atRelayRPM/(PI*sqrt(a*a-(float)atHystRPM*atHystRPM));
+	tuSec=(atLastMS-atFirstMS)/(1000.0*atCycles);
+	return true;
+}
+bool Motor::PIDAutoTuneGetTunings(float& kc,float& taui,float& taud,unsigned char rule) const {
+	float ku,tu;
+	if(!PIDAutoTuneGetResult(ku,tu)) return false;
+	switch(rule) {
+		case AUTOTUNE_RULE_ZN_PI:
+			kc=0.45*ku; taui=tu/1.2; taud=0; break;
+		case AUTOTUNE_RULE_ZN_PID:
+			kc=0.6*ku; taui=tu/2; taud=tu/8; break;
+		case AUTOTUNE_RULE_TL_PI:
+		default:
+			kc=ku/3.2; taui=2.2*tu; taud=0; break;
+	}
+	return true;
+}
 /*
 bool Motor::PIDRegulate(bool doRegulate) {
 	debug();
@@ -265,8 +452,90 @@ int Motor::getAccPPSS() const {
 }
  */
 int Motor::getSpeedPPS() const {
+	if(PIDGetStatus()==false) return updateSpeedPPS();
+	// 202610, updated by PIDRegulate(), maybe in the control timer
+	noInterrupts();
+	unsigned int speedPPS=isr->speedPPS;
+	interrupts();
+	return speedPPS;
+}
+// 202610, irqISR() records the edge times only, the period is converted to speedPPS here.
+// The division runs once per call with new edges, instead of once per edge in the ISR.
+unsigned int Motor::updateSpeedPPS() const {
+	struct EdgeSample sample;
+	noInterrupts();		// edgeMicros[] is 32 bits, not atomic on AVR
+	sampleEdges(sample);
+	interrupts();
+	return updateSpeedPPS(sample);
+}
+// number of periods to average for the edges up to head
+unsigned char Motor::speedPeriods(unsigned char head) const {
+	unsigned int edges=isr->speedEdges+(unsigned char)(head-isr->speedEdgeHead);
+	if(speedEstimator!=SPEED_EST_AVERAGE || edges<2) return 1;
+	if(edges>EDGE_RING_SIZE) edges=EDGE_RING_SIZE;
+	return (edges>SPEED_AVG_PERIODS)?SPEED_AVG_PERIODS:edges-1;
+}
+// call with interrupts disabled
+void Motor::sampleEdges(struct EdgeSample& sample) const {
+	sample.nowMicros=micros();
+	sample.head=isr->edgeHead;
+	unsigned char periods=speedPeriods(sample.head);
+	sample.lastMicros=isr->edgeMicros[(unsigned char)(sample.head-1)&EDGE_RING_MASK];
+	sample.firstMicros=isr->edgeMicros[(unsigned char)(sample.head-1-periods)&EDGE_RING_MASK];
+}
+unsigned int Motor::updateSpeedPPS(const struct EdgeSample& sample) const {
+	unsigned char head=sample.head;
+	unsigned char newEdges=head-isr->speedEdgeHead;
+	unsigned char prevEdges=isr->speedEdges;
+	unsigned char periods=speedPeriods(head);
+	unsigned char edgesPerPulse=(isr->decodeMode==ISR_DECODE_4X)?QUAD_EDGES_PER_PULSE:1;
+	unsigned int edges=prevEdges+newEdges;
+	if(edges>EDGE_RING_SIZE) edges=EDGE_RING_SIZE;
+	unsigned long lastMicros=sample.lastMicros;
+	unsigned long firstMicros=sample.firstMicros;
+
+	isr->speedEdgeHead=head;
+	isr->speedEdges=edges;
+	if(newEdges>0) {
+		if(edges>=2) {
+			// SPEED_EST_AVERAGE, more pulses than SPEED_AVG_PERIODS since last time:
+			// count them all, from the latest edge of last time
+			if(speedEstimator==SPEED_EST_AVERAGE && newEdges>periods && prevEdges>0) {
+				periods=newEdges;
+				firstMicros=isr->speedEdgeMicros;
+			}
+			unsigned long span=lastMicros-firstMicros;	// unsigned, correct across micros() overflow
+			span*=edgesPerPulse;	// irqISR4X() edges --> TRIGGER pulses
+			if(span>0) isr->speedPPS=(unsigned long)periods*MICROS_PER_SEC/span;
+		}
+		isr->speedEdgeMicros=lastMicros;
+	}
+
+	// both estimators: the period only grows while no pulse comes, so a stopping wheel
+	// would keep its last speed. The timeout follows the last period, a valid low speed
+	// is not cut, and the division runs only past the SPEED_STALL_MS floor.
+	if(edges>=2) {
+		unsigned long sinceLast=sample.nowMicros-lastMicros;
+		if(sinceLast>=speedStallMicros &&
+		   sinceLast/SPEED_STALL_PERIODS>=(lastMicros-firstMicros)/periods) {
+			isr->speedPPS=0;	// stalled, and start again from the next 2 edges
+			isr->speedEdges=0;
+		} else if((unsigned long)isr->speedPPS*edgesPerPulse*sinceLast>2*MICROS_PER_SEC) {
+			// no pulse for 2 periods, the wheel is slower than that.
+			// 1 period is too short, the long half period of CHANGE exceeds it while running.
+			isr->speedPPS=2*MICROS_PER_SEC/(sinceLast*edgesPerPulse);
+		}
+	}
 	return isr->speedPPS;
 }
+unsigned char Motor::setSpeedEstimator(unsigned char estimator,unsigned int stallMS) {
+	speedEstimator=estimator;
+	speedStallMicros=stallMS*1000UL;
+	return getSpeedEstimator();
+}
+unsigned char Motor::getSpeedEstimator() const {
+	return speedEstimator;
+}
 long Motor::getCurrPulse() const {
 	return isr->pulses;
 }
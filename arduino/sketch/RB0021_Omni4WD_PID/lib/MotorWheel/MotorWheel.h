@@ -21,6 +21,17 @@ V1.4	201209	Not Released
 
 V1.5	201209	Omni4WD is re-implemented, and now return value of Omni4WD::getSpeedMMPS() is correct.
 
+V1.6	202610
+1. irqISR() only records the edge time into a ring (ISRVars::edgeMicros), no division in the ISR.
+   speedPPS is calculated from the ring by Motor::updateSpeedPPS(), called from PIDRegulate() and the getters.
+2. irqISR() reads the encoder pins from the port input registers directly, see PIN_IN_READ().
+3. Motor::setSpeedEstimator(), SPEED_EST_AVERAGE averages the last periods. Both estimators decay to 0 when the wheel stops.
+4. irqISR4X(), full quadrature decoding on both encoder channels.
+5. PID::SetFixedPoint(true), Compute() without float (float stays the default). Omni4WD::PIDTimerEnable(), fixed rate control by timer0.
+6. Motor::PIDSetFeedForward(), PIDSetAntiWindup(), PID::SetDerivativeFilter().
+7. Motor::PIDAutoTuneStart(), relay auto-tune of each wheel. Omni4WD::PIDAutoTune().
+8. PID::SetGainSchedule(), fuzzy gain scheduling with the rule tables of fuzzy_table.h.
+
  */
 
 /*for maple*/
@@ -70,11 +81,13 @@ V1.5	201209	Omni4WD is re-implemented, and now return value of Omni4WD::getSpeed
 	#define  CPR 4	// Namiki motor
 	#define  DIR_INVERSE
 	#define  REDUCTION_RATIO 80
+	#define  QUAD_EDGES_PER_PULSE 2	// irqISR4X() edges per TRIGGER edge, 202610
 #else
 	#define	 TRIGGER RISING
 	#define  CPR 12	// Faulhaber motor
 	#define  DIR_INVERSE !
 	#define  REDUCTION_RATIO 64
+	#define  QUAD_EDGES_PER_PULSE 4
 #endif
 
 #define  MAX_SPEEDRPM 8000
@@ -90,6 +103,28 @@ V1.5	201209	Omni4WD is re-implemented, and now return value of Omni4WD::getSpeed
 //#define  MAX_SPEEDPPS ((MAX_SPEEDRPM*CPR)/SEC_PER_MIN)
 //#define  MIN_SPEEDPPS 0
 
+// speed estimators, Motor::setSpeedEstimator()	202610
+// Both decay when the pulses stop, and read 0 after SPEED_STALL_PERIODS of the last period.
+#define  SPEED_EST_PERIOD	0	// the last pulse period only, as before (default)
+#define  SPEED_EST_AVERAGE	1	// average of the last periods. Lags about 2 periods more,
+								// too slow for a 10ms loop below ~2000 RPM (tools/host_sim --scenario=estimator)
+#define  SPEED_AVG_PERIODS	4	// < EDGE_RING_SIZE, even: with CHANGE the high and low half periods differ
+#define  SPEED_STALL_PERIODS	3	// no pulse for this many periods of the last speed --> 0 PPS
+#define  SPEED_STALL_MS		20	// but not before this, 2 samples of the 10ms loop
+
+// relay auto-tune, Motor::PIDAutoTuneStart()	202610
+#define  AUTOTUNE_OFF		0
+#define  AUTOTUNE_RUNNING	1
+#define  AUTOTUNE_DONE		2
+#define  AUTOTUNE_FAILED	3
+#define  AUTOTUNE_RULE_ZN_PI	0	// Ziegler-Nichols PI: kc 0.45Ku, taui Tu/1.2
+#define  AUTOTUNE_RULE_TL_PI	1	// Tyreus-Luyben PI: kc Ku/3.2, taui 2.2Tu, less overshoot
+#define  AUTOTUNE_RULE_ZN_PID	2	// Ziegler-Nichols PID: kc 0.6Ku, taui Tu/2, taud Tu/8
+#define  AUTOTUNE_RELAY_RPM	1000	// relay amplitude, RPM of the duty
+#define  AUTOTUNE_HYST_RPM	100		// relay hysteresis, above the noise of the speed
+#define  AUTOTUNE_CYCLES	4		// measured cycles, after one warm-up cycle
+#define  AUTOTUNE_TIMEOUT_MS	3000
+
 #define  KC           0.31
 #define  TAUI         0.02
 #define  TAUD         0.00
@@ -170,36 +205,91 @@ struct ISRVars {
  */
 
 
-// Interrupt Type: RISING --> CHANGE	201207
+// Direct port read in ISR	202610
+// digitalRead() looks up the port, the bit mask and the timer of the pin in flash on every call.
+// Motor::Motor() looks up the input register and the bit mask of the encoder pins once,
+// and the ISR reads the register directly.
+// Any core which defines portInputRegister() and digitalPinToBitMask() as macros
+// (AVR, or a host simulation with fake port registers) gets the direct read,
+// the others (maple) fall back to digitalRead().
+#if !defined(BOARD_maple) && !defined(BOARD_maple_native) && !defined(BOARD_maple_mini) \
+	&& defined(portInputRegister) && defined(digitalPinToPort) && defined(digitalPinToBitMask)
+	#define PIN_IN_DIRECT
+	#define PIN_IN_REG(pin) portInputRegister(digitalPinToPort(pin))
+	#define PIN_IN_MASK(pin) digitalPinToBitMask(pin)
+	#define PIN_IN_READ(reg,mask,pin) ((*(reg)&(mask))!=0)
+#else
+	#define PIN_IN_REG(pin) 0
+	#define PIN_IN_MASK(pin) 0
+	#define PIN_IN_READ(reg,mask,pin) (digitalRead(pin)==HIGH)
+#endif
+
+// No division in ISR	202610
+// The 32-bit division (hundreds of cycles on AVR) ran for every edge of 4 wheels.
+// Now the ISR only records the edge time into a ring, and Motor::updateSpeedPPS()
+// converts the latest period to speedPPS once per PID sample.
+#define EDGE_RING_SIZE 8	// must be a power of 2
+#define EDGE_RING_MASK (EDGE_RING_SIZE-1)
 #define irqISR(y,x) \
     void x(); \
     struct ISRVars y={x}; \
     void x() { \
-        static bool first_pulse=true; \
-        y.pulseEndMicros=micros(); \
-        if(first_pulse==false && y.pulseEndMicros>y.pulseStartMicros) { \
-            y.speedPPS=MICROS_PER_SEC/(y.pulseEndMicros-y.pulseStartMicros); \
-			/* y.accPPSS=(y.speedPPS-y.lastSpeedPPS)*y.speedPPS; */ \
-        } else first_pulse=false; \
-        y.pulseStartMicros=y.pulseEndMicros; \
-		/* y.lastSpeedPPS=y.speedPPS; */ \
+        unsigned char head=y.edgeHead; \
+        y.edgeMicros[head&EDGE_RING_MASK]=micros(); \
+        y.edgeHead=head+1; \
 		if(y.pinIRQB!=PIN_UNDEFINED) \
-			y.currDirection=DIR_INVERSE(digitalRead(y.pinIRQ)^digitalRead(y.pinIRQB)); \
+			y.currDirection=DIR_INVERSE(PIN_IN_READ(y.inIRQ,y.maskIRQ,y.pinIRQ)^ \
+										PIN_IN_READ(y.inIRQB,y.maskIRQB,y.pinIRQB)); \
+		y.currDirection==DIR_ADVANCE?++y.pulses:--y.pulses; \
+    } 
+
+// Full quadrature (4x) decoding	202610
+// irqISR4X() is attached to CHANGE of both pinIRQ and pinIRQB, and looks up the step
+// from the previous and the current A/B state. Every edge of both channels counts,
+// QUAD_EDGES_PER_PULSE times the edges of irqISR(), so getCurrPulse() has that much
+// finer resolution for position control. speedPPS stays in the units of CPR.
+// Needs pinIRQB, and encoders with the two channels 90 degrees apart
+// (the optical sensors of some Namiki motors are not, use irqISR() for them).
+#define ISR_DECODE_1X 0	// irqISR(), edges of pinIRQ only
+#define ISR_DECODE_4X 1	// irqISR4X()
+extern const signed char quadStepTable[16];	// [(last A/B state)<<2|(A/B state)] --> +1 advance, -1 backoff, 0 none or invalid
+#define irqISR4X(y,x) \
+    void x(); \
+    struct ISRVars y={x,ISR_DECODE_4X}; \
+    void x() { \
+        unsigned char state=(PIN_IN_READ(y.inIRQ,y.maskIRQ,y.pinIRQ)<<1)| \
+							PIN_IN_READ(y.inIRQB,y.maskIRQB,y.pinIRQB); \
+        signed char step=quadStepTable[(y.quadState<<2)|state]; \
+        y.quadState=state; \
+        if(step==0) return; \
+        unsigned char head=y.edgeHead; \
+        y.edgeMicros[head&EDGE_RING_MASK]=micros(); \
+        y.edgeHead=head+1; \
+		y.currDirection=DIR_INVERSE(step>0); \
 		y.currDirection==DIR_ADVANCE?++y.pulses:--y.pulses; \
     } 
 
 struct ISRVars {
 	void (*ISRfunc)();
+	unsigned char decodeMode;	// ISR_DECODE_1X / ISR_DECODE_4X, 202610
+	unsigned char quadState;	// last A/B state of irqISR4X()
 	//volatile unsigned long pulses;
 	volatile long pulses;	// 201104, direction sensitive
-	volatile unsigned long pulseStartMicros;
-	volatile unsigned long pulseEndMicros;
-	volatile unsigned int  speedPPS;
+	volatile unsigned long edgeMicros[EDGE_RING_SIZE];	// micros() of the latest edges, 202610
+	volatile unsigned char edgeHead;	// number of edges (mod 256), edgeMicros[(edgeHead-1)&EDGE_RING_MASK] is the latest
+	unsigned char speedEdgeHead;	// edgeHead when speedPPS was calculated (not used by ISR)
+	unsigned char speedEdges;	// valid entries of edgeMicros[], saturates at EDGE_RING_SIZE (not used by ISR)
+	unsigned long speedEdgeMicros;	// the latest edge when speedPPS was calculated (not used by ISR)
+	unsigned int  speedPPS;	// calculated by Motor::updateSpeedPPS()
 	//volatile unsigned int  lastSpeedPPS;
 	//volatile int accPPSS;	// acceleration, Pulse Per Sec^2
 	volatile bool currDirection;
 	unsigned char pinIRQB;
 	unsigned char pinIRQ;	// pinIRQA 201207
+	volatile unsigned char* inIRQB;	// PIN_IN_REG(pinIRQB), 202610
+	volatile unsigned char* inIRQ;	// PIN_IN_REG(pinIRQ)
+	unsigned char maskIRQB;	// PIN_IN_MASK(pinIRQB)
+	unsigned char maskIRQ;	// PIN_IN_MASK(pinIRQ)
 };
  
 
@@ -237,6 +327,14 @@ struct ISRVars {
 };
  */
 
+// edges of one wheel sampled at one time, Motor::sampleEdges()	202610
+struct EdgeSample {
+	unsigned long nowMicros;
+	unsigned long lastMicros;	// the latest edge
+	unsigned long firstMicros;	// the edge Motor::speedPeriods() periods before
+	unsigned char head;	// ISRVars::edgeHead
+};
+
 class Motor: public PID {
 public:
 	Motor(unsigned char _pinPWM,unsigned char _pinDir,
@@ -278,14 +376,31 @@ public:
 	bool PIDDisable();
 	bool PIDReset();
 	bool PIDRegulate(bool doRegulate=true);
+	bool PIDRegulate(const struct EdgeSample& sample,bool doRegulate=true);	// 202610
+	bool PIDSetTimerDriven(bool timerDriven);	// PIDRegulate() without sample does nothing, Omni4WD::PIDTimerEnable()
+	bool PIDGetTimerDriven() const;
 	unsigned int PIDSetSpeedRPMDesired(unsigned int speedRPM);
 	unsigned int PIDGetSpeedRPMDesired() const;
+	bool PIDSetFeedForward(unsigned int gain256=256,unsigned int offsetRPM=0);	// 202610
+	int PIDGetFeedForward() const;
+	unsigned char PIDSetAntiWindup(unsigned char trackShift=0);
+	bool PIDAutoTuneStart(unsigned int relayRPM=AUTOTUNE_RELAY_RPM,unsigned int hystRPM=AUTOTUNE_HYST_RPM,
+							unsigned char cycles=AUTOTUNE_CYCLES);	// 202610
+	void PIDAutoTuneCancel();
+	unsigned char PIDAutoTuneGetStatus() const;
+	bool PIDAutoTuneGetResult(float& ku,float& tuSec) const;
+	bool PIDAutoTuneGetTunings(float& kc,float& taui,float& taud,unsigned char rule=AUTOTUNE_RULE_TL_PI) const;
 
 	void delayMS(unsigned int ms,bool debug=false);
 	void debugger() const;
 
 	//int getAccPPSS() const;
 	int getSpeedPPS() const;
+	unsigned int updateSpeedPPS() const;	// 202610, period -> speedPPS, outside of ISR
+	void sampleEdges(struct EdgeSample& sample) const;	// interrupts disabled
+	unsigned int updateSpeedPPS(const struct EdgeSample& sample) const;
+	unsigned char setSpeedEstimator(unsigned char estimator,unsigned int stallMS=SPEED_STALL_MS);	// stallMS: the shortest stall timeout
+	unsigned char getSpeedEstimator() const;
 	long getCurrPulse() const;
 	long setCurrPulse(long _pulse);
 	long resetCurrPulse();
@@ -306,7 +421,8 @@ private:
 	int speedRPMOutput;		// RPM
 	int speedRPMDesired;	// RPM
 	//float PWMEC;
-	float speed2DutyCycle;
+	//float speed2DutyCycle;
+	long speed2DutyCycle;	// integral of the PID output, 202610
 /*
 	// the followings are defined in struct ISRvars, 
 	// because ISR must be a global function, without parameters and no return value
@@ -316,6 +432,35 @@ private:
 	volatile unsigned long pulseEndMicros;
  */
 	bool pidCtrl;
+	volatile bool pidTimerDriven;	// PIDSetTimerDriven(), 202610
+
+	void setupInterrupt4X();	// 202610
+	unsigned char speedPeriods(unsigned char head) const;
+	bool PIDRegulateSpeed(unsigned int speedPPS,bool doRegulate,bool computeNow);
+
+	unsigned char speedEstimator;	// SPEED_EST_PERIOD / SPEED_EST_AVERAGE, 202610
+	unsigned long speedStallMicros;
+
+	unsigned int ffGain256;		// PIDSetFeedForward(), 202610
+	unsigned int ffOffsetRPM;
+	unsigned char antiWindupShift;	// PIDSetAntiWindup()
+
+	// PIDAutoTuneStart(), 202610
+	bool PIDAutoTuneRegulate();
+	void PIDAutoTuneStop(unsigned char status);
+	volatile unsigned char atStatus;
+	bool atHigh;				// relay output, duty above atBias
+	unsigned char atCycles;
+	unsigned char atSwitches;	// number of low --> high switches
+	int atRelayRPM;
+	int atHystRPM;
+	long atBias;				// duty when started
+	int atMax;					// speed peaks of the current cycle
+	int atMin;
+	long atPeakSum;				// sum of the peak-to-peak of the measured cycles
+	unsigned long atStartMS;
+	unsigned long atFirstMS;	// the first measured cycle started
+	unsigned long atLastMS;		// the last measured cycle ended
 
 	Motor();
 
@@ -6,7 +6,8 @@
 Omni4WD::Omni4WD(MotorWheel* wheelUL,MotorWheel* wheelLL,
 			MotorWheel* wheelLR,MotorWheel* wheelUR,unsigned int wheelspan):
 			_wheelUL(wheelUL),_wheelLL(wheelLL),
-			_wheelLR(wheelLR),_wheelUR(wheelUR),_wheelspan(wheelspan) {
+			_wheelLR(wheelLR),_wheelUR(wheelUR),_wheelspan(wheelspan),
+			_timerEnabled(false),_tickDivider(1),_tickCount(0),_tickBusy(false),_tickOverruns(0) {
 	setSwitchMotorsStat(MOTORS_FB);
 }
 unsigned char Omni4WD::getSwitchMotorsStat() const {
@@ -23,12 +24,14 @@ unsigned char Omni4WD::switchMotors() {
 	} else {
 		setSwitchMotorsStat(MOTORS_FB);
 	}
+	noInterrupts();		// controlTick() uses the wheels, 202610
 	MotorWheel* temp=_wheelUL;
 	_wheelUL=_wheelLR;
 	_wheelLR=temp;
 	temp=_wheelLL;
 	_wheelLL=_wheelUR;
 	_wheelUR=temp;
+	interrupts();
 
 	return getSwitchMotorsStat();
 }
@@ -305,6 +308,7 @@ bool Omni4WD::PIDEnable(float kc,float taui,float taud,unsigned int interval) {
 			_wheelUR->PIDEnable(kc,taui,taud,interval);
 }
 bool Omni4WD::PIDDisable() {
+	PIDTimerDisable();
 	setCarStat(STAT_UNKNOWN);
 	_wheelUL->PIDDisable(); _wheelUL->runPWM(0,DIR_ADVANCE);
 	_wheelLL->PIDDisable(); _wheelLL->runPWM(0,DIR_ADVANCE);
@@ -325,8 +329,115 @@ float Omni4WD::PIDGetD_Param() {
 	return _wheelUL->GetD_Param();
 }
 bool Omni4WD::PIDRegulate() {
+	if(PIDTimerGetStatus()) return false;	// the control timer regulates, 202610
 	return _wheelUL->PIDRegulate() && _wheelLL->PIDRegulate() && _wheelLR->PIDRegulate() && _wheelUR->PIDRegulate();
 }
+
+// Fixed rate control timer	202610
+// PIDRegulate() from delayMS() runs whenever loop() gets there, so the sample time
+// jitters with everything else loop() does. With PIDTimerEnable(), the compare match A
+// interrupt of timer0 drives the control instead. Timer0 runs millis() and comes every
+// 1.024ms, the compare match does not change millis() nor the PWM of timer1/timer2.
+// analogWrite() must not be used on pin 6 (OC0A), an encoder input of wheel3 here.
+// The sample time becomes a whole number of 1.024ms ticks, 10ms --> 10 ticks (10.24ms).
+// The ISR is defined by Omni4WD.h in the sketch which defines OMNI4WD_PID_TIMER,
+// so the other sketches keep TIMER0_COMPA_vect free for other libraries.
+Omni4WD* Omni4WD::_timerOmni=0;
+bool Omni4WD::_timerISR=false;
+bool Omni4WD::PIDTimerEnable() {
+	if(!PIDGetStatus()) return false;
+	_tickDivider=((unsigned long)_wheelUL->GetSampleTime()*125+64)/128;	// ms --> 1.024ms ticks
+	if(_tickDivider==0) _tickDivider=1;
+	_tickCount=0;
+	_tickOverruns=0;
+#if defined(__AVR__) && defined(OCIE0A)
+	if(!_timerISR) return false;	// no OMNI4WD_PID_TIMER, the vector would reset the board
+	_timerOmni=this;
+	_wheelUL->PIDSetTimerDriven(true);
+	_wheelLL->PIDSetTimerDriven(true);
+	_wheelLR->PIDSetTimerDriven(true);
+	_wheelUR->PIDSetTimerDriven(true);
+	OCR0A=0x80;
+	TIFR0=_BV(OCF0A);
+	TIMSK0|=_BV(OCIE0A);
+	return _timerEnabled=true;
+#else
+	return false;	// no timer, call controlTick() every sample time
+#endif
+}
+bool Omni4WD::PIDTimerDisable() {
+#if defined(__AVR__) && defined(OCIE0A)
+	TIMSK0&=~_BV(OCIE0A);
+#endif
+	_timerOmni=0;
+	_wheelUL->PIDSetTimerDriven(false);
+	_wheelLL->PIDSetTimerDriven(false);
+	_wheelLR->PIDSetTimerDriven(false);
+	_wheelUR->PIDSetTimerDriven(false);
+	return _timerEnabled=false;
+}
+bool Omni4WD::PIDTimerGetStatus() const {
+	return _timerEnabled;
+}
+unsigned int Omni4WD::PIDTimerGetOverruns() const {
+	return _tickOverruns;
+}
+void Omni4WD::PIDTimerTick() {
+	if(++_tickCount<_tickDivider) return;
+	_tickCount=0;
+	if(_tickBusy) {		// the last control is still running
+		++_tickOverruns;
+		return;
+	}
+	_tickBusy=true;
+	controlTick();
+	_tickBusy=false;
+}
+void Omni4WD::controlTick() {
+	struct EdgeSample sampleUL,sampleLL,sampleLR,sampleUR;
+	noInterrupts();		// the edges of the 4 wheels at the same time
+	_wheelUL->sampleEdges(sampleUL);
+	_wheelLL->sampleEdges(sampleLL);
+	_wheelLR->sampleEdges(sampleLR);
+	_wheelUR->sampleEdges(sampleUR);
+	interrupts();
+	_wheelUL->PIDRegulate(sampleUL);
+	_wheelLL->PIDRegulate(sampleLL);
+	_wheelLR->PIDRegulate(sampleLR);
+	_wheelUR->PIDRegulate(sampleUR);
+}
+// relay auto-tune of the 4 wheels at once	202610
+// Rotates the car at speedMMPS, waits until the speed settles with the current tunings,
+// then runs Motor::PIDAutoTuneStart() on every wheel. Blocks for 2-4s and stops the car.
+// The tunings proposed by rule are applied to the wheels which finished, the others keep theirs.
+// Call SetTunings() yourself only with the control timer off (PIDTimerDisable()).
+// Returns true when all 4 finished.
+bool Omni4WD::PIDAutoTune(unsigned int speedMMPS,unsigned char rule,unsigned int relayRPM) {
+	if(!PIDGetStatus()) return false;
+	MotorWheel* wheels[]={_wheelUL,_wheelLL,_wheelLR,_wheelUR};
+	setCarRotateLeft(speedMMPS);
+	delayMS(1000);
+	for(int i=0;i<4;i++) wheels[i]->PIDAutoTuneStart(relayRPM);
+	for(unsigned long endTime=millis()+AUTOTUNE_TIMEOUT_MS+100;millis()<endTime;) {
+		bool running=false;
+		for(int i=0;i<4;i++) running|=wheels[i]->PIDAutoTuneGetStatus()==AUTOTUNE_RUNNING;
+		if(!running) break;
+		delayMS(SAMPLETIME);
+	}
+	bool done=true;
+	bool timer=PIDTimerGetStatus();
+	if(timer) PIDTimerDisable();	// SetTunings() rewrites the fixed point coefficients one by one,
+									// a tick in between would compute with half of them
+	for(int i=0;i<4;i++) {
+		float kc,taui,taud;
+		wheels[i]->PIDAutoTuneCancel();
+		if(wheels[i]->PIDAutoTuneGetTunings(kc,taui,taud,rule)) wheels[i]->SetTunings(kc,taui,taud);
+		else done=false;
+	}
+	if(timer) PIDTimerEnable();
+	setCarStop();
+	return done;
+}
 /*
 void Omni4WD::delayMS(unsigned int ms,unsigned int slot,bool debug) {
 	for(int i=0;i<ms;i+=slot) {
@@ -340,7 +451,7 @@ void Omni4WD::delayMS(unsigned int ms,bool debug,unsigned char* actBreak) {		//
 	for(unsigned long endTime=millis()+ms;millis()<endTime;) 
 	{
 		if(actBreak) return;
-		PIDRegulate();
+		PIDRegulate();	// nothing while the control timer runs
 		if(debug && (millis()%500==0)) debugger();
 		if(endTime-millis()>=SAMPLETIME) delay(SAMPLETIME);
 		else delay(endTime-millis());
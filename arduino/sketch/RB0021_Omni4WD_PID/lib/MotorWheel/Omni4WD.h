@@ -80,6 +80,17 @@ public:
 	float PIDGetI_Param();	// 201210
 	float PIDGetD_Param();	// 201210
 	bool PIDRegulate();
+	// fixed rate control timer	202610
+	bool PIDTimerEnable();	// after PIDEnable(), AVR only, #define OMNI4WD_PID_TIMER before #include <Omni4WD.h>
+	bool PIDTimerDisable();
+	bool PIDTimerGetStatus() const;
+	unsigned int PIDTimerGetOverruns() const;
+	void PIDTimerTick();	// from the timer interrupt, every 1.024ms
+	void controlTick();		// all 4 wheels, every sample time
+	static Omni4WD* _timerOmni;
+	static bool _timerISR;	// set by the ISR of OMNI4WD_PID_TIMER
+	bool PIDAutoTune(unsigned int speedMMPS=100,unsigned char rule=AUTOTUNE_RULE_TL_PI,
+						unsigned int relayRPM=AUTOTUNE_RELAY_RPM);	// 202610
 	void delayMS(unsigned int ms=100, bool debug=false,unsigned char* actBreak = 0);
 	void demoActions(unsigned int speedMMPS=100,unsigned int duration=5000,unsigned int uptime=500,bool debug=false);
 	void debugger(bool wheelULDebug=true,bool wheelLLDebug=true,
@@ -122,10 +133,27 @@ private:
 	unsigned char _switchMotorsStat;
 	unsigned char setSwitchMotorsStat(unsigned char switchMotorsStat);
 
+	bool _timerEnabled;	// 202610
+	unsigned int _tickDivider;
+	volatile unsigned int _tickCount;
+	volatile bool _tickBusy;
+	volatile unsigned int _tickOverruns;
+
 	Omni4WD();	
 
 };
 
+// the timer0 compare match A interrupt of PIDTimerEnable(), 202610.
+// Only in the sketch which defines OMNI4WD_PID_TIMER, another library may use the vector.
+#if defined(OMNI4WD_PID_TIMER) && defined(__AVR__) && defined(OCIE0A)
+ISR(TIMER0_COMPA_vect,ISR_NOBLOCK) {	// encoder interrupts keep running during the control
+	if(Omni4WD::_timerOmni) Omni4WD::_timerOmni->PIDTimerTick();
+}
+static struct Omni4WDTimerISR {
+	Omni4WDTimerISR() { Omni4WD::_timerISR=true; }
+} omni4WDTimerISR;
+#endif
+
 #endif
 
 
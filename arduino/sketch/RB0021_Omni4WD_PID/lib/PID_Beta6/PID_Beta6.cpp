@@ -46,20 +46,38 @@ PID::PID(int *Input, int *Output, int *Setpoint, int *FFBias, float Kc, float Ta
  ****************************************************************************/
 void PID::ConstructorCommon(int *Input, int *Output, int *Setpoint, float Kc, float TauI, float TauD)
 {
+  tSample = 1000;			//default Controller Sample Time is 1 second
+  bias = 0;
+  qShift = 15;
+  cofA_q = cofB_q = cofC_q = cofD_q = 0;
+  dFilterShift = 0;
+  dFilt = 0;
+  dFilt_q = 0;
+  pOnInput = false;
+  cofP_q = 0;
+  outRem = 0;
+  outRem_q = 0;
+  gainSchedule = false;
+  gsErrShift = 8;
+  gsDErrShift = 6;
+  gsStep256 = 64;
+  cofI_q = 0;
+
   PID::SetInputLimits(0, 1023);		//default the limits to the 
   PID::SetOutputLimits(0, 255);		//full ranges of the I/O
 
-  tSample = 1000;			//default Controller Sample Time is 1 second
-
   PID::SetTunings( Kc, TauI, TauD);
 
   nextCompTime = millis();
   inAuto = false;
+  useFixed = false;
   myOutput = Output;
   myInput = Input;
   mySetpoint = Setpoint;
 
   Err = lastErr = prevErr = 0;
+  lastInput = *Input;
+  lastSetpoint = *Setpoint;
 }
 
 
@@ -95,6 +113,7 @@ void PID::SetOutputLimits(int OUTMin, int OUTMax)
 
 	outMin = OUTMin;
 	outSpan = OUTMax - OUTMin;
+	outSpan_i = OUTMax - OUTMin;
 }
 
 /* SetTunings(...)*************************************************************
@@ -127,9 +146,60 @@ void PID::SetTunings(float Kc, float TauI, float TauD)
 	taur = tempTauR;
 	taud = TauD / tSampleInSec;
 
-	cof_A = kc * (1 + taur + taud);
-	cof_B = kc * (1 + 2 * taud);
-	cof_C = kc * taud;
+	PID::SetCoefficients();
+}
+
+/* SetCoefficients()************************************************************
+ *  the velocity form: output = cof_A * Err - cof_B * lastErr + cof_C * prevErr.
+ *  with the derivative filter, the D part leaves cof_A/B/C and is computed from
+ *  the input with cof_D instead
+ ******************************************************************************/
+void PID::SetCoefficients()
+{
+	if (dFilterShift == 0)
+	{
+		cof_A = kc * (1 + taur + taud);
+		cof_B = kc * (1 + 2 * taud);
+		cof_C = kc * taud;
+		cof_D = 0;
+	}
+	else
+	{
+		cof_A = kc * (1 + taur);
+		cof_B = kc;
+		cof_C = 0;
+		cof_D = kc * taud;
+	}
+	PID::SetFixedCoefficients();
+}
+
+/* SetFixedCoefficients()*******************************************************
+ *  scales cof_A/B/C to 16 bit integers for the fixed point Compute().  qShift is
+ *  the largest number of fraction bits for which all three still fit, so small
+ *  gains keep their precision (kc 0.31 --> 0.31 * 2^15, error < 0.01%)
+ ******************************************************************************/
+void PID::SetFixedCoefficients()
+{
+	float maxCof = fabs(cof_A);
+	if (fabs(cof_B) > maxCof) maxCof = fabs(cof_B);
+	if (fabs(cof_C) > maxCof) maxCof = fabs(cof_C);
+	if (fabs(cof_D) > maxCof) maxCof = fabs(cof_D);
+	if (pOnInput && fabs(kc) > maxCof) maxCof = fabs(kc);
+
+	qShift = 15;
+	while (qShift > 0 && maxCof * (float)(1L << qShift) > 32767.0) qShift--;
+
+	float scale = (float)(1L << qShift);
+	cofA_q = (int)(cof_A * scale + (cof_A < 0 ? -0.5 : 0.5));
+	cofB_q = (int)(cof_B * scale + (cof_B < 0 ? -0.5 : 0.5));
+	cofC_q = (int)(cof_C * scale + (cof_C < 0 ? -0.5 : 0.5));
+	cofD_q = (int)(cof_D * scale + (cof_D < 0 ? -0.5 : 0.5));
+	cofP_q = (int)(kc * scale + (kc < 0 ? -0.5 : 0.5));	// kc <= cof_A, fits
+	cofI_q = (int)(kc * taur * scale + 0.5);
+	bias_q = (long)(bias * scale);
+	dFilt = 0;				// the scale may have changed
+	dFilt_q = 0;
+	outRem_q = 0;
 }
 
 /* Reset()*********************************************************************
@@ -145,7 +215,14 @@ void PID::Reset()
 	  bias = (*myBias - outMin) / outSpan;
 	else
 	  bias = (*myOutput - outMin) / outSpan;
-
+	bias_q = (long)(bias * (float)(1L << qShift));
+
+	lastInput = *myInput;
+	lastSetpoint = *mySetpoint;
+	dFilt = 0;
+	dFilt_q = 0;
+	outRem = 0;
+	outRem_q = 0;
 }
 
 /* SetMode(...)****************************************************************
@@ -175,12 +252,89 @@ void PID::SetSampleTime(int NewSampleTime)
 		taud *= ((float)NewSampleTime)/((float) tSample);
 		tSample = (unsigned long)NewSampleTime;
 
-		cof_A = kc * (1 + taur + taud);
-		cof_B = kc * (1 + 2 * taud);
-		cof_C = kc * taud;
+		PID::SetCoefficients();
 	}
 }
 
+/* SetFixedPoint(...)*******************************************************
+ * selects float or fixed point arithmetic for Compute().  the tunings are the
+ * same for both, switching does not bump the output
+ ******************************************************************************/
+void PID::SetFixedPoint(bool fixedPoint)
+{
+	useFixed = fixedPoint;
+	dFilt = 0;
+	dFilt_q = 0;
+	outRem = 0;
+	outRem_q = 0;
+}
+
+/* SetDerivativeFilter(...)*************************************************
+ * the derivative is taken from the input instead of the error, so a setpoint
+ * change does not kick the output, and low pass filtered against the encoder
+ * noise:  D += (-cof_D * (Input - lastInput) - D) / 2^filterShift.
+ * the division is a shift, the same in float and fixed point
+ ******************************************************************************/
+void PID::SetDerivativeFilter(unsigned char filterShift)
+{
+	if (filterShift > 7) filterShift = 7;
+	dFilterShift = filterShift;
+	PID::SetCoefficients();
+}
+
+/* SetProportionalOnInput(...)***********************************************
+ * kc * (Err - lastErr) = kc * (setpoint change) - kc * (Input - lastInput).
+ * dropping the setpoint part leaves the P term on the input only
+ ******************************************************************************/
+void PID::SetProportionalOnInput(bool onInput)
+{
+	pOnInput = onInput;
+	lastSetpoint = *mySetpoint;
+	PID::SetFixedCoefficients();
+}
+
+/* SetGainSchedule(...)*****************************************************
+ * fuzzy gain scheduling with the rule tables of fuzzy_table.h.  every Compute()
+ * the error and its change are quantized to the 7 levels NB..PB,
+ *   level = Err >> errShift, (Err - lastErr) >> dErrShift, limited to -3..+3
+ * (mirrored for a negative Err, see GainScheduleScale())
+ * and pid_tbl gives the levels of delta Kp and delta Ki for them.  a level L
+ * scales the P / I part of the velocity form by 1 + (L - ZO) * step256 / 256,
+ * step256 64: 0.25..1.75 times the tunings.  shifts and table lookups only,
+ * the fixed point Compute() stays without float
+ ******************************************************************************/
+void PID::SetGainSchedule(bool on, unsigned char errShift, unsigned char dErrShift, unsigned char step256)
+{
+	if (errShift > 14) errShift = 14;
+	if (dErrShift > 14) dErrShift = 14;
+	if (step256 > 85) step256 = 85;		// scale > 0 at NB
+	gsErrShift = errShift;
+	gsDErrShift = dErrShift;
+	gsStep256 = step256;
+	gainSchedule = on;
+}
+
+static int GainScheduleLevel(int value, unsigned char shift)
+{
+	int level = (value < 0) ? -((-value) >> shift) : (value >> shift);	// symmetric around 0
+	if (level < -3) level = -3;
+	else if (level > 3) level = 3;
+	return level + 3;
+}
+
+void PID::GainScheduleScale(int* kpScale256, int* kiScale256)
+{
+	// the rules are not symmetric (NB,NB --> PB but PB,PB --> NB), a speed loop should
+	// act the same up and down: mirror a negative Err, so the rows ZO..PB are used for
+	// the size of the error, and the columns for growing (PS..PB) or shrinking (NS..NB)
+	int err = Err, dErr = Err - lastErr;
+	if (err < 0) { err = -err; dErr = -dErr; }
+	unsigned char e = GainScheduleLevel(err, gsErrShift);
+	unsigned char de = GainScheduleLevel(dErr, gsDErrShift);
+	*kpScale256 = ((char)pgm_read_byte(&pid_tbl[DELTA_KP_IDX][e][de]) - FZ_ZO) * gsStep256;	// scale - 1
+	*kiScale256 = ((char)pgm_read_byte(&pid_tbl[DELTA_KI_IDX][e][de]) - FZ_ZO) * gsStep256;
+}
+
 /* Compute() **********************************************************************
  *     This, as they say, is where the magic happens.  this function should be called
  *   every time "void loop()" executes.  the function will decide for itself whether a new
@@ -219,42 +373,135 @@ void PID::Compute()
 	//...Perform PID Computations if it's time...
 	if (now>=nextCompTime)							
 	{
-  
-		Err = *mySetpoint - *myInput;
-		//if we're using an external bias (i.e. the user used the 
-		//overloaded constructor,) then pull that in now
-		if(UsingFeedForward)
-		{
-			bias = *myBias - outMin;
-		}
+		PID::ComputeNow();
 
+		nextCompTime += tSample;				// determine the next time the computation
+		if(nextCompTime < now) nextCompTime = now + tSample;	// should be performed	
+	}								
 
+
+}
+
+/* ComputeNow() *******************************************************************
+ *   the calculation part of Compute(), without the sample time check.  the caller
+ *   must call it every SetSampleTime() milliseconds
+ *********************************************************************************/
+void PID::ComputeNow()
+{
+	justCalced=false;
+	if (!inAuto) return; //if we're in manual just leave;
+
+	Err = *mySetpoint - *myInput;
+	//if we're using an external bias (i.e. the user used the 
+	//overloaded constructor,) then pull that in now
+	if(UsingFeedForward)
+	{
+		bias = *myBias - outMin;
+	}
+
+
+	int output;
+	if (useFixed)
+	{
+		output = ComputeFixed();
+	}
+	else
+	{
 		// perform the PID calculation.  
 		//float output = bias + kc * ((Err - lastErr)+ (taur * Err) + (taud * (Err - 2*lastErr + prevErr)));
 		noInterrupts();
-		int output = bias + (cof_A * Err - cof_B * lastErr + cof_C * prevErr);
+		float delta = cof_A * Err - cof_B * lastErr + cof_C * prevErr;
 		interrupts();
+		if (dFilterShift)
+		{
+			float step = (-cof_D * (*myInput - lastInput) - dFilt) / (float)(1 << dFilterShift);
+			dFilt += step;
+			delta += step;		// velocity form, the change of the D term
+		}
+		if (pOnInput) delta -= kc * (*mySetpoint - lastSetpoint);
+		if (gainSchedule)
+		{
+			int kpScale256, kiScale256;
+			PID::GainScheduleScale(&kpScale256, &kiScale256);
+			int pTerm = pOnInput ? -(*myInput - lastInput) : (Err - lastErr);
+			delta += (kc * pTerm * kpScale256 + kc * taur * Err * kiScale256) / 256.0;
+		}
+		// the velocity output is summed by the caller: carry what the int cuts off,
+		// or an I step below 1 (kc * taur * Err < 1) would never move the output
+		delta += outRem;
+		int step = (int)delta;
+		outRem = delta - step;
+		output = bias + step;
 
 		//make sure the computed output is within output constraints
-		if (output < -outSpan) output = -outSpan;
-		else if (output > outSpan) output = outSpan;
-		
+		if (output < -outSpan) { output = -outSpan; outRem = 0; }
+		else if (output > outSpan) { output = outSpan; outRem = 0; }
+	}
+	
 
-		prevErr = lastErr;
-		lastErr = Err;
+	prevErr = lastErr;
+	lastErr = Err;
+	lastInput = *myInput;
+	lastSetpoint = *mySetpoint;
 
 
-		//scale the output from percent span back out to a real world number
-						*myOutput = output;
+	//scale the output from percent span back out to a real world number
+					*myOutput = output;
 
-		nextCompTime += tSample;				// determine the next time the computation
-		if(nextCompTime < now) nextCompTime = now + tSample;	// should be performed	
+	justCalced=true;  //set the flag that will tell the outside world that the output was just computed
+}
 
-		justCalced=true;  //set the flag that will tell the outside world that the output was just computed
 
-	}								
+/* ComputeFixed() *****************************************************************
+ *   the same calculation as the float one in Compute(), with 16x16 --> 32 bit
+ *   multiplies only.  the sum saturates instead of overflowing, the output is
+ *   clamped to the output span.  in this velocity form the integral is held by
+ *   the caller (Motor::speed2DutyCycle), which clamps it as well, so a saturated
+ *   output does not wind anything up here.
+ *********************************************************************************/
+#define PID_ACC_MAX 0x7FFFFFFFL
+static long PIDSatAdd(long a, long b)
+{
+	if (b > 0 && a > PID_ACC_MAX - b) return PID_ACC_MAX;
+	if (b < 0 && a < -PID_ACC_MAX - b) return -PID_ACC_MAX;
+	return a + b;
+}
+
+int PID::ComputeFixed()
+{
+	if (UsingFeedForward)
+	{
+		bias_q = (long)(*myBias - (int)outMin) << qShift;	// < 2^15 * 2^15, fits
+	}
+
+	long acc = PIDSatAdd(outRem_q, (long)cofA_q * Err);	// the bias is added after the carry
+	acc = PIDSatAdd(acc, -((long)cofB_q * lastErr));
+	acc = PIDSatAdd(acc, (long)cofC_q * prevErr);
+	if (dFilterShift)
+	{
+		long step = (-(long)cofD_q * (*myInput - lastInput) - dFilt_q) >> dFilterShift;
+		dFilt_q += step;
+		acc = PIDSatAdd(acc, step);	// velocity form, the change of the D term
+	}
+	if (pOnInput) acc = PIDSatAdd(acc, -((long)cofP_q * (*mySetpoint - lastSetpoint)));
+	if (gainSchedule)
+	{
+		int kpScale256, kiScale256;
+		PID::GainScheduleScale(&kpScale256, &kiScale256);
+		int pTerm = pOnInput ? -(*myInput - lastInput) : (Err - lastErr);
+		acc = PIDSatAdd(acc, (((long)cofP_q * pTerm) >> 8) * kpScale256);	// < 2^21 * 2^8
+		acc = PIDSatAdd(acc, (((long)cofI_q * Err) >> 8) * kiScale256);
+	}
 
+	// back to real world units, truncated toward zero like the float --> int conversion,
+	// and the cut fraction is carried to the next call as in the float Compute()
+	long output = (acc < 0) ? -((-acc) >> qShift) : (acc >> qShift);
+	outRem_q = acc - output * (1L << qShift);
+	output += (bias_q < 0) ? -((-bias_q) >> qShift) : (bias_q >> qShift);
 
+	if (output < -outSpan_i) { output = -outSpan_i; outRem_q = 0; }
+	else if (output > outSpan_i) { output = outSpan_i; outRem_q = 0; }
+	return (int)output;
 }
 
 
@@ -267,6 +514,22 @@ bool PID::JustCalculated()
 {
 	return justCalced;
 }
+bool PID::GetFixedPoint()
+{
+	return useFixed;
+}
+unsigned char PID::GetDerivativeFilter()
+{
+	return dFilterShift;
+}
+bool PID::GetProportionalOnInput()
+{
+	return pOnInput;
+}
+bool PID::GetGainSchedule()
+{
+	return gainSchedule;
+}
 int PID::GetMode()
 {
 	if(inAuto)return 1;
@@ -25,6 +25,10 @@ class PID
 										//   calculation frequency can be set using SetMode
 										//   SetSampleTime respectively
 
+    void ComputeNow();				// * performs the PID calculation without checking the
+										//   sample time, for callers with their own fixed rate
+										//   timer (202610)
+
     void SetInputLimits(int, int);  //Tells the PID what 0-100% are for the Input
 
     void SetOutputLimits(int, int); //Tells the PID what 0-100% are for the Output
@@ -44,6 +48,27 @@ class PID
     bool JustCalculated();			// * in certain situations, it helps to know when the PID has
 										//   computed this bit will be true for one cycle after the
 										//   pid calculation has occurred
+
+    void SetFixedPoint(bool);		// * Compute() in integer arithmetic instead of float.  same
+										//   tunings, the coefficients are scaled to 16 bits (202610).
+										//   float by default
+    bool GetFixedPoint();
+
+    void SetDerivativeFilter(unsigned char);	// * 0: derivative of the error, unfiltered (default).
+										//   n: derivative of the input, low pass filtered with
+										//   the time constant (2^n - 1) sample times (202610)
+    unsigned char GetDerivativeFilter();
+
+    void SetProportionalOnInput(bool);	// * the P term from the input instead of the error, a
+										//   setpoint change moves the output through the I term
+										//   (and a feed-forward) only, no kick (202610)
+    bool GetProportionalOnInput();
+
+    void SetGainSchedule(bool,			// * fuzzy gain scheduling, the P and I gains are scaled
+        unsigned char errShift=8,		//   every Compute() by pid_tbl of fuzzy_table.h, looked up
+        unsigned char dErrShift=6,		//   with the levels of Err (2^errShift per level) and
+        unsigned char step256=64);		//   Err-lastErr (2^dErrShift), step256/256 per level (202610)
+    bool GetGainSchedule();
     
 
    //Status functions allow you to query current PID constants ***************************************
@@ -62,6 +87,9 @@ class PID
 
     void ConstructorCommon(int*, int*, int*,           // * code that is shared by the constructors
         float, float, float);
+    void SetCoefficients();		// * kc/taur/taud --> cof_A/B/C and the fixed point ones
+    void SetFixedCoefficients();	// * cof_A/B/C --> cofA_q/B_q/C_q
+    int ComputeFixed();
 
    //scaled, tweaked parameters we'll actually be using
     float kc;                    // * (P)roportional Tuning Parameter
@@ -72,6 +100,41 @@ class PID
 	float cof_B;
 	float cof_C;
 
+	// fixed point Compute(), cof_X * 2^qShift, qShift as large as the 16 bits allow
+	bool useFixed;
+	unsigned char qShift;
+	int cofA_q;
+	int cofB_q;
+	int cofC_q;
+	long bias_q;
+	int outSpan_i;
+
+	// filtered derivative of the input, SetDerivativeFilter()
+	unsigned char dFilterShift;
+	float cof_D;				// kc * taud
+	int cofD_q;
+	float dFilt;				// derivative term, output units
+	long dFilt_q;				// derivative term, * 2^qShift
+	int lastInput;
+
+	// SetProportionalOnInput()
+	bool pOnInput;
+	int cofP_q;					// kc * 2^qShift
+	int lastSetpoint;
+
+	// the fraction of the velocity output cut by the conversion to int, carried to the
+	// next Compute() so that a small error still adds up in the caller's integral
+	float outRem;
+	long outRem_q;				// * 2^qShift
+
+	// SetGainSchedule()
+	bool gainSchedule;
+	unsigned char gsErrShift;
+	unsigned char gsDErrShift;
+	unsigned char gsStep256;
+	int cofI_q;					// kc * taur * 2^qShift
+	void GainScheduleScale(int* kpScale256, int* kiScale256);
+
    //nice, pretty parameters we'll give back to the user if they ask what the tunings are
     float P_Param;
     float I_Param;
@@ -1,44 +1,53 @@
 
-#if 0
 #ifndef	_PID_TABLE_H_
 #define	_PID_TABLE_H_
 
-#define	PB				6
-#define	PM				5
-#define	PS				4
-#define	ZO				3
-#define	NS				2
-#define	NM				1
-#define	NB				0
+// the rule tables are used by PID::SetGainSchedule(), 202610
+// pid_tbl[DELTA_KP_IDX or DELATA_KI_IDX][level of Err][level of Err - lastErr]
+// the levels are FZ_ prefixed, PB is the port B of Arduino.h
+#ifndef PROGMEM		// not AVR, the table stays in RAM
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const unsigned char*)(addr))
+#endif
+
+#define	FZ_PB				6
+#define	FZ_PM				5
+#define	FZ_PS				4
+#define	FZ_ZO				3
+#define	FZ_NS				2
+#define	FZ_NM				1
+#define	FZ_NB				0
 
 #define	DELTA_KP_IDX	0
 #define	DELATA_KI_IDX	1
+#define	DELTA_KI_IDX	DELATA_KI_IDX
 #define	ERR				7
 #define	DELTA_ERR		7
 
 
-const char pid_tbl[2][7][7]={
+const char pid_tbl[2][7][7] PROGMEM={
 						{
-							{PB,PB,PM,PM,PS,ZO,ZO},
-							{PB,PB,PM,PS,PS,ZO,ZO},
-							{PM,PM,PM,PS,ZO,NS,NS},
-							{PM,PM,PS,ZO,NS,NM,NM},
-							{PS,PS,ZO,NS,NS,NM,NM},
-							{PS,ZO,NS,NM,NM,NM,NB},
-							{ZO,ZO,NM,NM,NM,NB,NB},
+							{FZ_PB,FZ_PB,FZ_PM,FZ_PM,FZ_PS,FZ_ZO,FZ_ZO},
+							{FZ_PB,FZ_PB,FZ_PM,FZ_PS,FZ_PS,FZ_ZO,FZ_ZO},
+							{FZ_PM,FZ_PM,FZ_PM,FZ_PS,FZ_ZO,FZ_NS,FZ_NS},
+							{FZ_PM,FZ_PM,FZ_PS,FZ_ZO,FZ_NS,FZ_NM,FZ_NM},
+							{FZ_PS,FZ_PS,FZ_ZO,FZ_NS,FZ_NS,FZ_NM,FZ_NM},
+							{FZ_PS,FZ_ZO,FZ_NS,FZ_NM,FZ_NM,FZ_NM,FZ_NB},
+							{FZ_ZO,FZ_ZO,FZ_NM,FZ_NM,FZ_NM,FZ_NB,FZ_NB},
 						},
 						
 						{
-							{NB,NB,NM,NM,NS,ZO,ZO},
-							{NB,NB,NM,NS,NS,ZO,ZO},
-							{NB,NM,NS,NS,ZO,PS,PS},
-							{NM,NM,NS,ZO,PS,PM,PM},
-							{NM,NS,ZO,PS,PS,PM,PB},
-							{ZO,ZO,PS,PS,PM,PB,PB},
-							{ZO,ZO,PS,PM,PM,PB,PB},
+							{FZ_NB,FZ_NB,FZ_NM,FZ_NM,FZ_NS,FZ_ZO,FZ_ZO},
+							{FZ_NB,FZ_NB,FZ_NM,FZ_NS,FZ_NS,FZ_ZO,FZ_ZO},
+							{FZ_NB,FZ_NM,FZ_NS,FZ_NS,FZ_ZO,FZ_PS,FZ_PS},
+							{FZ_NM,FZ_NM,FZ_NS,FZ_ZO,FZ_PS,FZ_PM,FZ_PM},
+							{FZ_NM,FZ_NS,FZ_ZO,FZ_PS,FZ_PS,FZ_PM,FZ_PB},
+							{FZ_ZO,FZ_ZO,FZ_PS,FZ_PS,FZ_PM,FZ_PB,FZ_PB},
+							{FZ_ZO,FZ_ZO,FZ_PS,FZ_PM,FZ_PM,FZ_PB,FZ_PB},
 						},
 					 };
 
+#if 0	// absolute gains for the levels, not used, SetGainSchedule() scales kc instead
 const float kp_tbl[ERR] = {
 						0.07987,
 						0.08974,
@@ -59,8 +68,7 @@ const float ki_tbl[DELTA_ERR] = {
 							0.30000,
 							0.00000,
 						   };
- 
-#endif	_PID_TABLE_H_
-
 #endif
 
+#endif	// _PID_TABLE_H_
+
@@ -0,0 +1,93 @@
+#ifndef HOST_SIM_ARDUINO_H
+#define HOST_SIM_ARDUINO_H
+
+/**
+ * @file Arduino.h
+ * @brief ホスト (Linux) でMotorWheel / Omni4WD / PID_Beta6をビルドするための最小限のArduino互換ヘッダ
+ *
+ * 時間 (micros/millis/delay)、ピン (analogWrite/digitalWrite とポート入力レジスタ)、割り込みの登録
+ * (attachInterrupt / PCattachInterrupt) を host_arduino.cpp の模擬に置き換えます
+ * 時間は motor_sim.cpp のシミュレーションが進めるため、実時間とは関係ありません
+ * 割り込みはシミュレーションのステップの間にだけ呼ばれ、実行中のコードに割り込むことはありません
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define PI 3.1415926535897932384626433832795
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void noInterrupts();
+void interrupts();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+// ATmega328P (Uno) と同じピン配置: D0-D7 PORTD, D8-D13 PORTB, D14-D19 (A0-A5) PORTC
+// ポートの番号はこのシミュレーション内だけのもの (0:PORTD 1:PORTB 2:PORTC)
+#define HOST_NUM_PINS 20
+extern volatile uint8_t host_port_input[3];
+#define digitalPinToPort(P) ((P) < 8 ? 0 : ((P) < 14 ? 1 : 2))
+#define digitalPinToBitMask(P) ((uint8_t)(1 << ((P) < 8 ? (P) : ((P) < 14 ? (P) - 8 : (P) - 14))))
+#define portInputRegister(P) (&host_port_input[(P)])
+
+/// @brief Serial の代替 (出力は捨てる)
+class HostSerial {
+public:
+    void begin(long) {}
+    int available() { return 0; }
+    template <class T> size_t print(const T&) { return 0; }
+    template <class T> size_t print(const T&, int) { return 0; }
+    template <class T> size_t println(const T&) { return 0; }
+    template <class T> size_t println(const T&, int) { return 0; }
+    size_t println() { return 0; }
+};
+extern HostSerial Serial;
+
+// ---- シミュレーターから使う模擬の状態 (host_arduino.cpp) ----
+
+extern unsigned long host_micros;       ///< 現在時刻 (us)。micros() はAVRと同じく4us単位に切り捨てて返す
+extern int host_pwm[HOST_NUM_PINS];     ///< analogWrite() の値
+extern uint8_t host_out[HOST_NUM_PINS]; ///< digitalWrite() の値
+
+/// @brief delay() の代わりに呼ばれる関数 (シミュレーションを指定時間だけ進める)。未設定なら時間だけ進める
+extern void (*host_delay_hook)(unsigned long us);
+/// @brief analogWrite() のたびに呼ばれる関数 (制御周期と応答遅れの計測用)
+extern void (*host_analog_write_hook)(uint8_t pin, int val);
+
+/// @brief 入力ピンのレベルを変え、そのピンに登録された割り込み (CHANGE/RISING/FALLING) を呼びます
+void host_set_input(uint8_t pin, bool level);
+
+/// @brief 割り込みの呼び出し回数と、その処理にかかったホストの時間 (ns)
+extern unsigned long host_isr_calls;
+extern double host_isr_ns;
+
+#endif // HOST_SIM_ARDUINO_H
@@ -0,0 +1,2 @@
+// PID_Beta6.cpp がインクルードするだけのため空
+#include "Arduino.h"
@@ -0,0 +1,20 @@
+#ifndef HOST_SIM_PINCHANGEINT_H
+#define HOST_SIM_PINCHANGEINT_H
+
+/**
+ * @file PinChangeInt.h
+ * @brief lib/PinChangeInt の代わり。登録した割り込みは host_set_input() から呼ばれます
+ */
+
+#include "Arduino.h"
+
+class PCintPort {
+public:
+    static int attachInterrupt(uint8_t pin, void (*userFunc)(), int mode);
+    static void detachInterrupt(uint8_t pin);
+};
+
+#define PCdetachInterrupt(pin) PCintPort::detachInterrupt(pin)
+#define PCattachInterrupt(pin, userFunc, mode) PCintPort::attachInterrupt(pin, userFunc, mode)
+
+#endif // HOST_SIM_PINCHANGEINT_H
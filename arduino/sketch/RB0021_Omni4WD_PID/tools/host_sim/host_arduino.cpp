@@ -0,0 +1,105 @@
+/**
+ * @file host_arduino.cpp
+ * @brief Arduino.h / PinChangeInt.h の模擬の実装
+ *
+ * 割り込みは外部割り込み (D2/D3) とピン変化割り込みを区別せず、ピン毎に1つ登録できます
+ */
+#include "Arduino.h"
+#include "PinChangeInt.h"
+#include <chrono>
+
+HostSerial Serial;
+
+unsigned long host_micros = 0;
+int host_pwm[HOST_NUM_PINS];
+uint8_t host_out[HOST_NUM_PINS];
+volatile uint8_t host_port_input[3];
+void (*host_delay_hook)(unsigned long us) = 0;
+void (*host_analog_write_hook)(uint8_t pin, int val) = 0;
+unsigned long host_isr_calls = 0;
+double host_isr_ns = 0;
+
+namespace {
+
+/// @brief ピンに登録された割り込み
+struct PinInterrupt {
+    void (*func)();
+    int mode;
+};
+PinInterrupt pinInterrupts[HOST_NUM_PINS];
+
+} // namespace
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+unsigned long micros() { return host_micros & ~3UL; }
+unsigned long millis() { return host_micros / 1000; }
+
+void delay(unsigned long ms) {
+    if (host_delay_hook) host_delay_hook(ms * 1000);
+    else host_micros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    if (host_delay_hook) host_delay_hook(us);
+    else host_micros += us;
+}
+
+void noInterrupts() {}
+void interrupts() {}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < HOST_NUM_PINS) host_out[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= HOST_NUM_PINS) return LOW;
+    return (host_port_input[digitalPinToPort(pin)] & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+void analogWrite(uint8_t pin, int val) {
+    if (pin >= HOST_NUM_PINS) return;
+    host_pwm[pin] = val;
+    if (host_analog_write_hook) host_analog_write_hook(pin, val);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(), int mode) {
+    if (interruptNum < 2) pinInterrupts[interruptNum + 2] = PinInterrupt{userFunc, mode}; // INT0:D2, INT1:D3
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+    if (interruptNum < 2) pinInterrupts[interruptNum + 2] = PinInterrupt{0, 0};
+}
+
+int PCintPort::attachInterrupt(uint8_t pin, void (*userFunc)(), int mode) {
+    if (pin >= HOST_NUM_PINS) return -1;
+    pinInterrupts[pin] = PinInterrupt{userFunc, mode};
+    return 1;
+}
+
+void PCintPort::detachInterrupt(uint8_t pin) {
+    if (pin < HOST_NUM_PINS) pinInterrupts[pin] = PinInterrupt{0, 0};
+}
+
+void host_set_input(uint8_t pin, bool level) {
+    if (pin >= HOST_NUM_PINS) return;
+    volatile uint8_t& port = host_port_input[digitalPinToPort(pin)];
+    const uint8_t mask = digitalPinToBitMask(pin);
+    const bool last = (port & mask) != 0;
+    if (last == level) return;
+    if (level) port |= mask;
+    else port &= ~mask;
+
+    const PinInterrupt& irq = pinInterrupts[pin];
+    if (!irq.func) return;
+    if (irq.mode == CHANGE || (irq.mode == RISING && level) || (irq.mode == FALLING && !level)) {
+        const auto start = std::chrono::steady_clock::now();
+        irq.func();
+        host_isr_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        host_isr_calls++;
+    }
+}
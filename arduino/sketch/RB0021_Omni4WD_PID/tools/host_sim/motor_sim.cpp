@@ -0,0 +1,1015 @@
+/**
+ * @file motor_sim.cpp
+ * @brief MotorWheel / Omni4WD / PID_Beta6 の閉ループをホスト (Linux) で動かすシミュレーター
+ *
+ * 4つのホイールそれぞれに、DCモーター (電気系: R, L, 逆起電力 / 機械系: 慣性, クーロン摩擦, 負荷) と
+ * 減速機 (REDUCTION_RATIO) のモデルを用意し、PWMと方向ピンの出力から回転を計算します
+ * 回転に応じてエンコーダーのA/B相 (1回転あたりCPRエッジ、90度ずれ) のピンを変え、
+ * irqISR() / irqISR4X() で生成した割り込み関数を登録どおり (CHANGE/RISING/FALLING) に呼びます
+ * 制御はスケッチと同じく Omni4WD::PIDTimerTick() を1.024ms毎 (timer)、または
+ * delayMS() と同じ PIDRegulate() + delay(SAMPLETIME) の繰り返し (loop) で動かします
+ *
+ * シナリオ
+ *   step     : 各ホイールの目標回転数をステップ状に変え、応答遅れ/立ち上がり/整定/オーバーシュート/定常偏差を計測
+ *   car      : 前進 → 左旋回 → 停止。ホイールの速度から車体の速度を逆算し、指令と比べる (運動学の確認)
+ *   autotune : Omni4WD::PIDAutoTune() でゲインを求めてから step を実行 (--gain-schedule はチューニングの後で有効にする)
+ *   isr      : irqISR() 1回の処理時間を V1.5 までの irqISR() (割り込み内で割り算) と比べ、speedPPS が同じことを確認
+ *   estimator: 一定速度とステップ状の速度変化で、SPEED_EST_PERIOD / SPEED_EST_AVERAGE の推定誤差と遅れを計測
+ *   pid      : 固定小数点と float の PID::Compute() を同じ入力で比べ、出力の差が2を超えたら失敗。1回の処理時間も計測
+ *   pins     : PIN_IN_READ() と digitalRead() が全ピン・A/B相の4状態で同じこと、回転方向の判定と quadStepTable を確認
+ *
+ * 結果は表で標準出力へ書き出し、--max-* を指定した場合は超えたときに終了コード1を返します (回帰テスト用)
+ * CPU負荷はホストの処理時間と、AVRのサイクル数の推定値 (--isr-cycles / --control-cycles) から求めます
+ * ビルドと実行は run_sim.sh を参照してください
+ *
+ * 使い方:
+ *   motor_sim [--scenario=step|car|autotune|isr|pins|estimator|pid] [--mode=timer|loop] [--from=RPM] [--to=RPM] [--speed=MMPS]
+ *             [--kc=] [--taui=] [--taud=] [--sample-ms=10] [--estimator=period|average] [--decode=1x|4x]
+ *             [--fixed=1|0] [--ff=gain256,offsetRPM] [--antiwindup=shift] [--p-on-input] [--dfilter=shift]
+ *             [--gain-schedule] [--rule=zn-pi|tl-pi|zn-pid] [--load=mNm] [--spread=%] [--seed=N]
+ *             [--loop-work-us=us] [--trace=file.csv]
+ *             [--max-overshoot=%] [--max-settle-ms=ms] [--max-latency-ms=ms] [--max-sserr=%]
+ */
+#include <MotorWheel.h>
+#include <Omni4WD.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// スケッチと同じホイールの割り込み (1x) と、4x デコードの割り込み
+irqISR(irq1, isr1);
+irqISR(irq2, isr2);
+irqISR(irq3, isr3);
+irqISR(irq4, isr4);
+irqISR4X(quadIrq1, quadIsr1);
+irqISR4X(quadIrq2, quadIsr2);
+irqISR4X(quadIrq3, quadIsr3);
+irqISR4X(quadIrq4, quadIsr4);
+
+// isr / pins シナリオ用: 現在の irqISR() / irqISR4X() と、V1.5 までの irqISR() (割り込み内で割り算、digitalRead())
+irqISR(benchIrq, benchIsr);
+irqISR4X(benchQuadIrq, benchQuadIsr);
+irqISR(benchAvgIrq, benchAvgIsr); // estimator シナリオ用: SPEED_EST_AVERAGE 側
+
+/// @brief V1.5 までの ISRVars (速度は割り込み内で計算)
+struct LegacyISRVars {
+    void (*ISRfunc)();
+    volatile long pulses;
+    volatile unsigned long pulseStartMicros;
+    volatile unsigned long pulseEndMicros;
+    volatile unsigned int speedPPS;
+    volatile bool currDirection;
+    unsigned char pinIRQB;
+    unsigned char pinIRQ;
+};
+
+/// @brief MotorWheel.h の V1.2 (201207) の irqISR() そのまま (コメントアウトされて残っているもの)
+#define irqISRLegacy(y, x) \
+    void x(); \
+    LegacyISRVars y = {x}; \
+    void x() { \
+        static bool first_pulse = true; \
+        y.pulseEndMicros = micros(); \
+        if (first_pulse == false && y.pulseEndMicros > y.pulseStartMicros) { \
+            y.speedPPS = MICROS_PER_SEC / (y.pulseEndMicros - y.pulseStartMicros); \
+        } else first_pulse = false; \
+        y.pulseStartMicros = y.pulseEndMicros; \
+        if (y.pinIRQB != PIN_UNDEFINED) \
+            y.currDirection = DIR_INVERSE(digitalRead(y.pinIRQ) ^ digitalRead(y.pinIRQB)); \
+        y.currDirection == DIR_ADVANCE ? ++y.pulses : --y.pulses; \
+    }
+irqISRLegacy(legacyIrq, legacyIsr);
+
+namespace {
+
+const unsigned long DT_US = 10;          ///< シミュレーションの刻み (us)
+const unsigned long TIMER0_TICK_US = 1024; ///< タイマー0の比較一致割り込みの周期 (us)
+const double AVR_CLOCK_HZ = 16e6;
+const int NUM_WHEELS = 4;
+const char* const WHEEL_NAMES[NUM_WHEELS] = {"wheel1(UL)", "wheel2(LL)", "wheel3(LR)", "wheel4(UR)"};
+
+/// @brief スケッチと同じピン (PWM, 方向, エンコーダーA, エンコーダーB)
+const uint8_t WHEEL_PINS[NUM_WHEELS][4] = {{11, 12, 14, 15}, {3, 2, 4, 5}, {10, 7, 6, 13}, {9, 8, 16, 17}};
+
+/// @brief DCモーターのパラメーター (モーター軸)
+struct MotorParams {
+    double r;  ///< 巻線抵抗 (Ohm)
+    double l;  ///< インダクタンス (H)
+    double ke; ///< 逆起電力定数 (V s/rad)、トルク定数 (N m/A) も同じ値
+    double j;  ///< 慣性モーメント (kg m^2)、減速機の先のホイールと車体の分を含む
+    double tc; ///< クーロン摩擦 (N m)
+    double b;  ///< 粘性摩擦 (N m s/rad)
+};
+
+/**
+ * @brief Namiki 22CL-103501PG80:1 相当の値
+ * @details 12Vで無負荷約6900RPM、機械的時定数約80ms、不感帯約0.9V (PWM 19/255) になるように決めた値で、
+ *          実測値ではありません。実機の応答と比べて合わせてください
+ */
+const MotorParams NAMIKI_PARAMS = {6.0, 1e-3, 0.0153, 3.1e-6, 2.3e-3, 0.0};
+
+/// @brief モーター1個と減速機、エンコーダーのモデル
+struct MotorPlant {
+    MotorParams p;
+    uint8_t pinPWM, pinDir, pinA, pinB;
+    double current = 0; ///< A
+    double omega = 0;   ///< モーター軸の角速度 (rad/s)
+    double turns = 0;   ///< モーター軸の回転数 (rev)
+    long quad = 0;      ///< A/B相の状態の通し番号 (1回転あたり2*CPR)
+
+    double rpm() const { return omega * 60 / (2 * PI); }
+
+    /// @brief dt秒進めます。loadは回転を妨げる向きの負荷トルク (N m)
+    void step(double dt, double load) {
+        const double duty = (double)host_pwm[pinPWM] / MAX_PWM;
+        const double volt = REF_VOLT * duty * (host_out[pinDir] == DIR_ADVANCE ? 1 : -1);
+        current += (volt - p.r * current - p.ke * omega) / p.l * dt;
+        const double drive = p.ke * current - p.b * omega;
+        const double friction = p.tc + load;
+        if (omega == 0) {
+            if (fabs(drive) > friction) omega += (drive - copysign(friction, drive)) / p.j * dt;
+        } else {
+            const double next = omega + (drive - copysign(friction, omega)) / p.j * dt;
+            omega = (next * omega < 0) ? 0 : next; // 摩擦で逆転はしない
+        }
+        turns += omega / (2 * PI) * dt;
+        updateEncoder();
+    }
+
+    /// @brief A相が先行するのが正転: 00 -> 10 -> 11 -> 01 (A<<1|B)、quadStepTable と同じ
+    void updateEncoder() {
+        const long target = (long)floor(turns * 2 * CPR);
+        while (quad != target) {
+            quad += (target > quad) ? 1 : -1;
+            const int state = quad & 3;
+            host_set_input(pinA, state == 1 || state == 2);
+            host_set_input(pinB, state == 2 || state == 3);
+        }
+    }
+};
+
+/// @brief コマンドラインの設定
+struct Config {
+    std::string scenario = "step";
+    bool timerMode = true;      ///< true: PIDTimerTick() を1.024ms毎、false: PIDRegulate() + delay()
+    int fromRPM = 1000;
+    int toRPM = 4000;
+    int speedMMPS = 100;        ///< car / autotune の車体の速度
+    float kc = 0.31f, taui = 0.01f, taud = 0;
+    int sampleMS = 10;
+    unsigned char estimator = SPEED_EST_PERIOD; ///< スケッチと同じ
+    bool decode4x = false;
+    bool fixedPoint = true;     ///< スケッチと同じ (ライブラリの既定は float)
+    int ffGain256 = 0, ffOffsetRPM = 0;
+    int antiWindup = 0;
+    bool pOnInput = false;
+    int dFilter = 0;
+    bool gainSchedule = false;
+    unsigned char rule = AUTOTUNE_RULE_TL_PI;
+    double loadMNm = 0;
+    double spreadPercent = 10;  ///< ホイール毎の慣性と摩擦のばらつき (±%)
+    unsigned seed = 1;
+    unsigned long loopWorkUs = 0; ///< loop モードで loop() の他の処理にかかる時間
+    unsigned long settleMS = 1500;
+    unsigned long runMS = 1500;
+    std::string tracePath;
+    double maxOvershoot = -1, maxSettleMS = -1, maxLatencyMS = -1, maxSSErr = -1;
+    double isrCycles = 300;     ///< 推定値: ピン変化割り込みの振り分け + irqISR()
+    double controlCycles = 6000; ///< 推定値: controlTick() の4輪分 (速度の計算、固定小数点PID、map())
+};
+
+/// @brief ホイール毎の記録 (1ms毎)
+struct WheelLog {
+    std::vector<float> rpm;      ///< モーターの実際の回転数
+    std::vector<float> estimate; ///< Motor::getSpeedRPM()
+    std::vector<int> setpoint;
+    std::vector<int> pwm;        ///< 方向付きのPWM
+    unsigned long pwmWrites = 0;
+    unsigned long lastWriteUs = 0;
+    double intervalMin = 1e9, intervalMax = 0, intervalSum = 0;
+    unsigned long intervals = 0;
+    long stepUs = -1;            ///< 目標を変えた時刻 (応答遅れの計測中のみ)
+    int pwmAtStep = 0;
+    double latencyMS = -1;
+};
+
+Config config;
+MotorPlant plants[NUM_WHEELS];
+MotorWheel* wheels[NUM_WHEELS];
+Omni4WD* omni;
+WheelLog logs[NUM_WHEELS];
+unsigned long nextTickUs = 0;
+unsigned long nextLogUs = 0;
+unsigned long controlCalls = 0;
+double controlNs = 0;
+double tickNs = 0;
+unsigned long tickCalls = 0;
+FILE* trace = 0;
+
+unsigned long elapsedStartUs = 0;
+unsigned long isrCallsStart = 0;
+
+int signedPWM(int i) {
+    const int pwm = host_pwm[plants[i].pinPWM];
+    return host_out[plants[i].pinDir] == DIR_ADVANCE ? pwm : -pwm;
+}
+
+void onAnalogWrite(uint8_t pin, int) {
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        if (plants[i].pinPWM != pin) continue;
+        WheelLog& log = logs[i];
+        if (log.pwmWrites++ > 0) {
+            const double interval = (host_micros - log.lastWriteUs) / 1000.0;
+            if (interval > 0) { // 同じ制御周期内の書き込みは数えない
+                log.intervalMin = std::min(log.intervalMin, interval);
+                log.intervalMax = std::max(log.intervalMax, interval);
+                log.intervalSum += interval;
+                log.intervals++;
+            }
+        }
+        log.lastWriteUs = host_micros;
+        if (log.stepUs >= 0 && log.latencyMS < 0 && signedPWM(i) != log.pwmAtStep) {
+            log.latencyMS = (host_micros - log.stepUs) / 1000.0;
+        }
+    }
+}
+
+void writeTrace() {
+    if (!trace) return;
+    fprintf(trace, "%.3f", host_micros / 1000.0);
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        fprintf(trace, ",%d,%.1f,%d,%d", wheels[i]->PIDGetSpeedRPMDesired() * (wheels[i]->getDesiredDir() == DIR_ADVANCE ? 1 : -1),
+                plants[i].rpm(), wheels[i]->getSpeedRPM(), signedPWM(i));
+    }
+    fprintf(trace, "\n");
+}
+
+/// @brief シミュレーションを us だけ進めます (timer モードではタイマー割り込みも模擬)
+void advance(unsigned long us) {
+    const unsigned long end = host_micros + us;
+    const double load = config.loadMNm * 1e-3;
+    while (host_micros < end) {
+        host_micros += DT_US;
+        for (MotorPlant& plant : plants) plant.step(DT_US * 1e-6, load);
+        if (config.timerMode && host_micros >= nextTickUs) {
+            nextTickUs += TIMER0_TICK_US;
+            const unsigned long writes = logs[0].pwmWrites;
+            const auto start = std::chrono::steady_clock::now();
+            omni->PIDTimerTick();
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (logs[0].pwmWrites != writes) {
+                controlNs += ns;
+                controlCalls++;
+            } else {
+                tickNs += ns;
+                tickCalls++;
+            }
+        }
+        if (host_micros >= nextLogUs) {
+            nextLogUs += 1000;
+            for (int i = 0; i < NUM_WHEELS; i++) {
+                WheelLog& log = logs[i];
+                log.rpm.push_back((float)plants[i].rpm());
+                log.estimate.push_back((float)wheels[i]->getSpeedRPM());
+                log.setpoint.push_back(wheels[i]->PIDGetSpeedRPMDesired() * (wheels[i]->getDesiredDir() == DIR_ADVANCE ? 1 : -1));
+                log.pwm.push_back(signedPWM(i));
+            }
+            writeTrace();
+        }
+    }
+}
+
+void delayHook(unsigned long us) { advance(us); }
+
+/// @brief ms だけ制御を動かします (loop モードは Omni4WD::delayMS() と同じ繰り返し)
+void run(unsigned long ms) {
+    if (config.timerMode) {
+        advance(ms * 1000);
+        return;
+    }
+    const unsigned long end = host_micros + ms * 1000;
+    while (host_micros < end) {
+        if (config.loopWorkUs) advance(config.loopWorkUs);
+        const auto start = std::chrono::steady_clock::now();
+        const unsigned long writes = logs[0].pwmWrites;
+        omni->PIDRegulate();
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (logs[0].pwmWrites != writes) {
+            controlNs += ns;
+            controlCalls++;
+        }
+        advance(SAMPLETIME * 1000UL);
+    }
+}
+
+/// @brief 再現性のある [-1, 1) の乱数
+double uniform(unsigned& state) {
+    state = state * 1103515245u + 12345u;
+    return ((state >> 8) & 0xFFFF) / 32768.0 - 1;
+}
+
+void setup() {
+    ISRVars* isrs1x[NUM_WHEELS] = {&irq1, &irq2, &irq3, &irq4};
+    ISRVars* isrs4x[NUM_WHEELS] = {&quadIrq1, &quadIrq2, &quadIrq3, &quadIrq4};
+    unsigned rng = config.seed;
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        MotorPlant& plant = plants[i];
+        plant.p = NAMIKI_PARAMS;
+        plant.p.j *= 1 + uniform(rng) * config.spreadPercent / 100;
+        plant.p.tc *= 1 + uniform(rng) * config.spreadPercent / 100;
+        plant.pinPWM = WHEEL_PINS[i][0];
+        plant.pinDir = WHEEL_PINS[i][1];
+        plant.pinA = WHEEL_PINS[i][2];
+        plant.pinB = WHEEL_PINS[i][3];
+        wheels[i] = new MotorWheel(plant.pinPWM, plant.pinDir, plant.pinA, plant.pinB,
+                                   config.decode4x ? isrs4x[i] : isrs1x[i]);
+    }
+    omni = new Omni4WD(wheels[0], wheels[1], wheels[2], wheels[3]);
+    omni->PIDEnable(config.kc, config.taui, config.taud, config.sampleMS);
+    for (MotorWheel* wheel : wheels) {
+        wheel->setSpeedEstimator(config.estimator);
+        wheel->SetFixedPoint(config.fixedPoint);
+        if (config.ffGain256 || config.ffOffsetRPM) wheel->PIDSetFeedForward(config.ffGain256, config.ffOffsetRPM);
+        wheel->PIDSetAntiWindup(config.antiWindup);
+        wheel->SetProportionalOnInput(config.pOnInput);
+        wheel->SetDerivativeFilter(config.dFilter);
+        wheel->SetGainSchedule(config.gainSchedule && config.scenario != "autotune"); // autotune はスケッチと同じく後で
+    }
+    omni->PIDTimerEnable(); // ホストではタイマーは動かないが、分周比が設定される
+    nextTickUs = host_micros + TIMER0_TICK_US;
+    nextLogUs = host_micros;
+}
+
+/// @brief 1つのホイールのステップ応答の結果
+struct StepResult {
+    double latencyMS, riseMS, settleMS, overshoot, ssErr, ripple;
+};
+
+StepResult analyzeStep(const WheelLog& log, size_t stepIndex, double from, double to) {
+    StepResult r{log.latencyMS, -1, -1, 0, 0, 0};
+    const size_t end = log.rpm.size();
+    const double span = to - from;
+    const double band = 0.02 * std::max(fabs(to), fabs(from) * (to == 0));
+    double t10 = -1, t90 = -1;
+    for (size_t k = stepIndex; k < end; k++) {
+        const double progress = span != 0 ? (log.rpm[k] - from) / span : 1;
+        const double t = (double)(k - stepIndex);
+        if (t10 < 0 && progress >= 0.1) t10 = t;
+        if (t90 < 0 && progress >= 0.9) t90 = t;
+        if (span != 0) r.overshoot = std::max(r.overshoot, (progress - 1) * 100);
+        if (fabs(log.rpm[k] - to) > band) r.settleMS = -1;
+        else if (r.settleMS < 0) r.settleMS = t;
+    }
+    if (t10 >= 0 && t90 >= 0) r.riseMS = t90 - t10;
+    const size_t tail = std::min<size_t>(200, end - stepIndex);
+    double mean = 0;
+    for (size_t k = end - tail; k < end; k++) mean += log.rpm[k];
+    mean /= tail;
+    double var = 0;
+    for (size_t k = end - tail; k < end; k++) var += (log.rpm[k] - mean) * (log.rpm[k] - mean);
+    r.ssErr = to != 0 ? (mean - to) / fabs(to) * 100 : mean;
+    r.ripple = sqrt(var / tail);
+    return r;
+}
+
+bool check(const char* name, const char* wheel, double value, double limit) {
+    if (limit < 0 || value <= limit) return true;
+    printf("FAIL %s %s %.2f > %.2f\n", wheel, name, value, limit);
+    return false;
+}
+
+bool scenarioStep() {
+    for (MotorWheel* wheel : wheels) wheel->setSpeedRPM(config.fromRPM);
+    run(config.settleMS);
+    double from[NUM_WHEELS];
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        const std::vector<float>& rpm = logs[i].rpm;
+        from[i] = 0;
+        for (size_t k = rpm.size() - 100; k < rpm.size(); k++) from[i] += rpm[k];
+        from[i] /= 100;
+    }
+    const size_t stepIndex = logs[0].rpm.size();
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        logs[i].stepUs = host_micros;
+        logs[i].pwmAtStep = signedPWM(i);
+        logs[i].latencyMS = -1;
+        wheels[i]->setSpeedRPM(config.toRPM);
+    }
+    run(config.runMS);
+
+    printf("step %d -> %d RPM (%s, sample %dms)\n", config.fromRPM, config.toRPM,
+           config.timerMode ? "timer" : "loop", config.sampleMS);
+    printf("%-11s %8s %8s %9s %9s %8s %8s\n", "wheel", "latency", "rise", "settle2%", "overshoot", "sserr", "ripple");
+    bool ok = true;
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        const StepResult r = analyzeStep(logs[i], stepIndex, from[i], config.toRPM);
+        printf("%-11s %6.2fms %6.0fms %7.0fms %8.1f%% %7.2f%% %6.0frpm\n", WHEEL_NAMES[i], r.latencyMS, r.riseMS,
+               r.settleMS, r.overshoot, r.ssErr, r.ripple);
+        ok &= check("latency(ms)", WHEEL_NAMES[i], r.latencyMS < 0 ? 1e9 : r.latencyMS, config.maxLatencyMS);
+        ok &= check("settle(ms)", WHEEL_NAMES[i], r.settleMS < 0 ? 1e9 : r.settleMS, config.maxSettleMS);
+        ok &= check("overshoot(%)", WHEEL_NAMES[i], r.overshoot, config.maxOvershoot);
+        ok &= check("sserr(%)", WHEEL_NAMES[i], fabs(r.ssErr), config.maxSSErr);
+    }
+    return ok;
+}
+
+bool scenarioCar() {
+    struct Phase {
+        const char* name;
+        int (Omni4WD::*action)(int);
+        double vy, omega; ///< 指令: 前進 (mm/s)、旋回 (rad/s)
+    };
+    const double rotate = config.speedMMPS / sqrt(pow(omni->getWheelspan() / 2.0, 2) * 2); // setCarRotateLeft() と同じ
+    const Phase phases[] = {
+        {"advance", &Omni4WD::setCarAdvance, (double)config.speedMMPS, 0},
+        {"rotateLeft", &Omni4WD::setCarRotateLeft, 0, rotate},
+        {"stop", 0, 0, 0},
+    };
+    const double rpmToMMPS = (double)CIRMM / REDUCTION_RATIO / SEC_PER_MIN;
+    printf("car %d mm/s (%s)\n", config.speedMMPS, config.timerMode ? "timer" : "loop");
+    printf("%-11s %10s %10s %10s %10s %12s\n", "phase", "vy(mm/s)", "vx(mm/s)", "omega", "cmd omega", "wheel err");
+    for (const Phase& phase : phases) {
+        if (phase.action) (omni->*phase.action)(config.speedMMPS);
+        else omni->setCarStop();
+        run(2000);
+        // 最後の1秒の平均。setCarMove() の逆: UL=a+b-wW, LL=a-b-wW, LR=-a-b-wW, UR=-a+b-wW
+        double v[NUM_WHEELS], err = 0;
+        for (int i = 0; i < NUM_WHEELS; i++) {
+            const WheelLog& log = logs[i];
+            double sum = 0, sp = 0;
+            for (size_t k = log.rpm.size() - 1000; k < log.rpm.size(); k++) {
+                sum += log.rpm[k];
+                sp += log.setpoint[k];
+            }
+            v[i] = sum / 1000 * rpmToMMPS;
+            err = std::max(err, fabs(sum - sp) / 1000 * rpmToMMPS);
+        }
+        const double vy = (v[0] + v[1] - v[2] - v[3]) / 4;
+        const double vx = (v[0] - v[1] - v[2] + v[3]) / 4;
+        const double omega = -(v[0] + v[1] + v[2] + v[3]) / 4 / omni->getWheelspan();
+        printf("%-11s %10.1f %10.1f %10.3f %10.3f %9.1fmm/s\n", phase.name, vy, vx, omega, phase.omega, err);
+    }
+    return true;
+}
+
+bool scenarioAutoTune() {
+    const bool timerMode = config.timerMode;
+    config.timerMode = false; // PIDAutoTune() は delayMS() で制御を回す (ホストではタイマーが無いため)
+    const bool done = omni->PIDAutoTune(config.speedMMPS, config.rule);
+    config.timerMode = timerMode;
+    nextTickUs = host_micros + TIMER0_TICK_US;
+    for (MotorWheel* wheel : wheels) wheel->SetGainSchedule(config.gainSchedule); // 求めたゲインに掛ける
+    printf("autotune %s at %d mm/s\n", done ? "done" : "failed", config.speedMMPS);
+    printf("%-11s %8s %8s %8s %8s %8s\n", "wheel", "Ku", "Tu(s)", "kc", "taui", "taud");
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        float ku = 0, tu = 0;
+        wheels[i]->PIDAutoTuneGetResult(ku, tu);
+        printf("%-11s %8.3f %8.3f %8.3f %8.3f %8.4f\n", WHEEL_NAMES[i], ku, tu, wheels[i]->GetP_Param(),
+               wheels[i]->GetI_Param(), wheels[i]->GetD_Param());
+    }
+    printf("\n");
+    return scenarioStep() && done;
+}
+
+/**
+ * @brief 1エッジ分の割り込みの処理時間を、現在の irqISR() と V1.5 までの irqISR() で比べます
+ * @details 同じエッジの列 (指定の周期に±15usの揺らぎ) を両方の割り込みに与え、
+ *          エッジ毎に Motor::updateSpeedPPS() (SPEED_EST_PERIOD) と以前の割り込み内の speedPPS を比べます
+ *          列の途中で micros() が一周します。以前の割り込みは一周をまたぐエッジを捨てていたため、その1つだけは違ってよい
+ *          時間はホスト上の関数ポインタ経由の呼び出し (エッジの生成と合わせた時間) で、AVRのサイクル数ではありません
+ */
+bool scenarioISR() {
+    const uint8_t* pins = WHEEL_PINS[0];
+    MotorWheel wheel(pins[0], pins[1], pins[2], pins[3], &benchIrq);
+    legacyIrq.pinIRQ = pins[2];
+    legacyIrq.pinIRQB = pins[3];
+    host_set_input(pins[2], true); // 正転 (A^B = 1)
+    const unsigned periodsUs[] = {50000, 12500, 3125, 1876, 500};
+    const unsigned long edges = 200000;
+    bool ok = true;
+
+    printf("isr: %lu edges per period, host time per edge (function pointer call + edge generation)\n", edges);
+    printf("%9s %12s %12s %12s %10s %9s\n", "period", "irqISR", "V1.5 irqISR", "updatePPS", "mismatch", "wrapped");
+    for (unsigned period : periodsUs) {
+        unsigned rng = config.seed;
+        unsigned long mismatches = 0, wrapped = 0;
+        // 比較: 1エッジ毎に速度を計算する (以前の割り込みと同じ)。micros() は列の中ほどで一周する
+        host_micros = 0UL - period * 64UL;
+        for (unsigned long n = 0; n < 1000; n++) {
+            const unsigned long last = micros();
+            host_micros += period + (long)(uniform(rng) * 15);
+            const bool wraps = micros() < last;
+            benchIrq.ISRfunc();
+            legacyIrq.ISRfunc();
+            const unsigned int pps = wheel.updateSpeedPPS();
+            if (n > 0 && pps != legacyIrq.speedPPS) {
+                if (wraps) wrapped++;
+                else mismatches++;
+            }
+        }
+        ok &= mismatches == 0;
+
+        void (*const isrs[2])() = {benchIrq.ISRfunc, legacyIrq.ISRfunc};
+        double ns[2];
+        for (int k = 0; k < 2; k++) {
+            const auto start = std::chrono::steady_clock::now();
+            for (unsigned long n = 0; n < edges; n++) {
+                host_micros += period;
+                isrs[k]();
+            }
+            ns[k] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / edges;
+        }
+        // 割り算を移した先: PID の1サンプル毎に1回 (ここではエッジ毎に呼ぶ)
+        const auto start = std::chrono::steady_clock::now();
+        volatile unsigned int pps = 0; // 呼び出しが消されないように
+        for (unsigned long n = 0; n < edges; n++) {
+            host_micros += period;
+            benchIrq.ISRfunc();
+            pps = wheel.updateSpeedPPS();
+        }
+        (void)pps;
+        const double updateNs =
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / edges - ns[0];
+        printf("%7uus %10.2fns %10.2fns %10.2fns %10lu %9lu\n", period, ns[0], ns[1], updateNs, mismatches, wrapped);
+    }
+    printf("%s: updateSpeedPPS() %s the speedPPS of the V1.5 irqISR() on every edge except across the micros() wrap\n",
+           ok ? "PASS" : "FAIL", ok ? "matches" : "does not match");
+    return ok;
+}
+
+/// @brief A/B相の状態 (A<<1|B) を入力ピンに設定します (割り込みは登録されていないので呼ばれない)
+void setEncoderState(const uint8_t* pins, int state) {
+    host_set_input(pins[2], (state & 2) != 0);
+    host_set_input(pins[3], (state & 1) != 0);
+}
+
+/**
+ * @brief エンコーダーのピンの読み方を確認します
+ * @details 1. 全ピンの High/Low で、PIN_IN_READ() (ポート入力レジスタの直接読み) と digitalRead() が同じ
+ *          2. スケッチの4輪のピンで、A/B相の4状態それぞれで irqISR() の回転方向と加減算が
+ *             V1.5 の irqISR() (digitalRead() で A^B) と同じ
+ *          3. 正転 00 -> 10 -> 11 -> 01 (A<<1|B、motor_sim のエンコーダーと同じ) の A相のエッジで irqISR() が
+ *             DIR_ADVANCE、逆転で DIR_BACKOFF。irqISR4X() は1周で ±QUAD_EDGES_PER_PULSE * 2
+ *          4. quadStepTable の16通りが、正転の順で次の状態なら+1、前の状態なら-1、それ以外は0
+ *          どれかが違えば終了コード1
+ */
+bool scenarioPins() {
+    static const int FORWARD[4] = {0, 2, 3, 1}; // A<<1|B の正転の順
+    unsigned long failures = 0;
+
+    // 1. 全ピン
+    for (uint8_t pin = 0; pin < HOST_NUM_PINS; pin++) {
+        for (int level = 0; level < 2; level++) {
+            host_set_input(pin, level != 0);
+            const bool direct = PIN_IN_READ(PIN_IN_REG(pin), PIN_IN_MASK(pin), pin);
+            if (direct != (digitalRead(pin) == HIGH)) {
+                printf("FAIL pin %u level %d: PIN_IN_READ %d, digitalRead %d\n", pin, level, direct, digitalRead(pin));
+                failures++;
+            }
+        }
+        host_set_input(pin, false);
+    }
+    printf("pins: PIN_IN_READ() vs digitalRead() on %d pins x 2 levels%s\n", HOST_NUM_PINS,
+#ifdef PIN_IN_DIRECT
+           " (direct port read)"
+#else
+           " (digitalRead() fallback)"
+#endif
+    );
+
+    // 2. スケッチのピンで、A/B相の4状態
+    printf("%-11s %5s %5s  %s\n", "wheel", "pinA", "pinB", "state(A B): irqISR dir / V1.5 dir");
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        const uint8_t* pins = WHEEL_PINS[i];
+        MotorWheel wheel(pins[0], pins[1], pins[2], pins[3], &benchIrq);
+        legacyIrq.pinIRQ = pins[2];
+        legacyIrq.pinIRQB = pins[3];
+        printf("%-11s %5u %5u ", WHEEL_NAMES[i], pins[2], pins[3]);
+        for (int state = 0; state < 4; state++) {
+            setEncoderState(pins, state);
+            for (int k = 2; k < 4; k++) {
+                if (PIN_IN_READ(k == 2 ? benchIrq.inIRQ : benchIrq.inIRQB, k == 2 ? benchIrq.maskIRQ : benchIrq.maskIRQB,
+                                pins[k]) != (digitalRead(pins[k]) == HIGH)) {
+                    printf("\nFAIL %s pin %u state %d: the cached register/mask read differs from digitalRead()\n",
+                           WHEEL_NAMES[i], pins[k], state);
+                    failures++;
+                }
+            }
+            const long pulses = benchIrq.pulses, legacyPulses = legacyIrq.pulses;
+            benchIrq.ISRfunc();
+            legacyIrq.ISRfunc();
+            const bool same = benchIrq.currDirection == legacyIrq.currDirection &&
+                              benchIrq.pulses - pulses == legacyIrq.pulses - legacyPulses;
+            printf(" %d%d:%s/%s%s", state >> 1, state & 1, benchIrq.currDirection == DIR_ADVANCE ? "adv" : "back",
+                   legacyIrq.currDirection == DIR_ADVANCE ? "adv" : "back", same ? "" : "(FAIL)");
+            failures += !same;
+        }
+        printf("\n");
+    }
+
+    // 3. 正転/逆転の1周
+    const uint8_t* pins = WHEEL_PINS[0];
+    MotorWheel wheel1x(pins[0], pins[1], pins[2], pins[3], &benchIrq);
+    MotorWheel wheel4x(pins[0], pins[1], pins[2], pins[3], &benchQuadIrq);
+    for (int dir = 1; dir >= -1; dir -= 2) {
+        int index = 0;
+        setEncoderState(pins, FORWARD[index]);
+        benchQuadIrq.quadState = FORWARD[index];
+        const long start1x = benchIrq.pulses, start4x = benchQuadIrq.pulses;
+        for (int n = 0; n < 4; n++) {
+            index = (index + dir + 4) & 3;
+            const int last = benchQuadIrq.quadState;
+            setEncoderState(pins, FORWARD[index]);
+            if ((last ^ FORWARD[index]) & 2) { // A相のエッジ: irqISR() は TRIGGER (CHANGE) で呼ばれる
+                benchIrq.ISRfunc();
+                if (benchIrq.currDirection != (dir > 0 ? DIR_ADVANCE : DIR_BACKOFF)) {
+                    printf("FAIL irqISR() direction %s at %d -> %d\n", benchIrq.currDirection == DIR_ADVANCE ? "adv" : "back",
+                           last, FORWARD[index]);
+                    failures++;
+                }
+            }
+            benchQuadIrq.ISRfunc(); // irqISR4X() は両相の CHANGE で呼ばれる
+        }
+        const long count1x = benchIrq.pulses - start1x, count4x = benchQuadIrq.pulses - start4x;
+        const bool ok = count1x == 2 * dir && count4x == 2 * QUAD_EDGES_PER_PULSE * dir;
+        printf("%s 1 cycle: irqISR %+ld pulses, irqISR4X %+ld edges%s\n", dir > 0 ? "advance" : "backoff", count1x,
+               count4x, ok ? "" : " (FAIL)");
+        failures += !ok;
+    }
+
+    // 4. quadStepTable
+    for (int from = 0; from < 4; from++) {
+        for (int to = 0; to < 4; to++) {
+            int expected = 0;
+            for (int k = 0; k < 4; k++) {
+                if (FORWARD[k] != from) continue;
+                if (FORWARD[(k + 1) & 3] == to) expected = +1;
+                else if (FORWARD[(k + 3) & 3] == to) expected = -1;
+            }
+            if (quadStepTable[from << 2 | to] != expected) {
+                printf("FAIL quadStepTable[%d%d -> %d%d] = %d, expected %d\n", from >> 1, from & 1, to >> 1, to & 1,
+                       quadStepTable[from << 2 | to], expected);
+                failures++;
+            }
+        }
+    }
+    printf("quadStepTable: 16 transitions checked\n");
+    printf("%s (%lu failures)\n", failures ? "FAIL" : "PASS", failures);
+    return failures == 0;
+}
+
+/// @brief estimator シナリオの1つの推定方法の結果
+struct EstimatorResult {
+    double rms, max;      ///< 一定速度での誤差 (%)
+    double upMS, downMS;  ///< 速度のステップ (x1.5 / x0.5) から推定値がステップの中間を越えるまでの時間 (推定の遅れ)
+    double stopMS;        ///< x0.5 の速度で止まってから (最後のエッジから) 推定値が0になるまでの時間 (-1: 1秒以内に0にならない)
+};
+
+/**
+ * @brief 一定速度 (とそこからのステップ) のエンコーダーのエッジを2つの推定方法のホイールに与え、
+ *        SAMPLE_US 毎の Motor::updateSpeedPPS() を実際の速度と比べます
+ * @details A相の CHANGE のエッジの間隔は High/Low で 45/55 に偏り、±15us の揺らぎを加えます (光学センサーの偏りの模擬)
+ */
+void runEstimators(MotorWheel* estimators[2], double rpm, EstimatorResult results[2]) {
+    const unsigned long SAMPLE_US = 10240;      // Omni4WD::PIDTimerEnable() の10ms
+    const unsigned long WARMUP_US = 500000;
+    const unsigned long MEASURE_US = 2000000;
+    const unsigned long STEP_US = 1000000;      // ステップ後の観測時間
+    unsigned rng = config.seed;
+    double sumSq[2] = {0, 0}, maxErr[2] = {0, 0};
+    unsigned long samples = 0;
+    double nextEdge = (double)host_micros, nextSample = (double)host_micros + SAMPLE_US;
+    bool high = false;
+    double speed = rpm;
+    unsigned long stepAt = 0;
+    int phase = 0; // 0: 一定速度, 1: x1.5 へのステップ, 2: x0.5 へのステップ
+    double crossedAt[2] = {-1, -1};
+    unsigned long lastEdge = host_micros;
+    const unsigned long begin = host_micros;
+    while (true) {
+        const unsigned long t = host_micros - begin;
+        if (phase == 0 && t >= WARMUP_US + MEASURE_US) {
+            phase = 1;
+            speed = rpm * 1.5;
+            stepAt = t;
+        } else if (phase == 1 && t >= stepAt + STEP_US) {
+            for (int k = 0; k < 2; k++) results[k].upMS = crossedAt[k] < 0 ? -1 : (crossedAt[k] - stepAt) / 1000;
+            crossedAt[0] = crossedAt[1] = -1;
+            phase = 2;
+            speed = rpm * 0.5;
+            stepAt = t;
+        } else if (phase == 2 && t >= stepAt + STEP_US) {
+            for (int k = 0; k < 2; k++) results[k].downMS = crossedAt[k] < 0 ? -1 : (crossedAt[k] - stepAt) / 1000;
+            break;
+        }
+        if (nextEdge <= nextSample) {
+            host_micros = lastEdge = (unsigned long)nextEdge;
+            high = !high;
+            host_set_input(WHEEL_PINS[0][2], high);
+            benchIrq.ISRfunc();
+            benchAvgIrq.ISRfunc();
+            const double period = 1e6 * SEC_PER_MIN / (speed * CPR); // エッジの平均間隔 (us)
+            nextEdge += period * (high ? 0.9 : 1.1) + uniform(rng) * 15;
+        } else {
+            host_micros = (unsigned long)nextSample;
+            nextSample += SAMPLE_US;
+            for (int k = 0; k < 2; k++) {
+                const double estimate = SPEEDPPS2SPEEDRPM(estimators[k]->updateSpeedPPS());
+                const double err = (estimate - speed) / speed * 100;
+                if (phase == 0 && t >= WARMUP_US) {
+                    sumSq[k] += err * err;
+                    maxErr[k] = std::max(maxErr[k], fabs(err));
+                } else if (phase > 0 && crossedAt[k] < 0) {
+                    const double middle = (speed + (phase == 1 ? rpm : rpm * 1.5)) / 2; // 前の速度との中間
+                    if (phase == 1 ? estimate >= middle : estimate <= middle) crossedAt[k] = (double)t;
+                }
+            }
+            if (phase == 0 && t >= WARMUP_US) samples++;
+        }
+    }
+    for (int k = 0; k < 2; k++) {
+        results[k].rms = sqrt(sumSq[k] / samples);
+        results[k].max = maxErr[k];
+        results[k].stopMS = -1;
+    }
+    // 停止: 最後のエッジから推定値が0になるまで
+    for (double t = nextSample - lastEdge; t <= 1000000; t += SAMPLE_US) {
+        host_micros = lastEdge + (unsigned long)t;
+        for (int k = 0; k < 2; k++) {
+            if (results[k].stopMS < 0 && estimators[k]->updateSpeedPPS() == 0) results[k].stopMS = t / 1000;
+        }
+    }
+}
+
+/**
+ * @brief 速度の推定方法の比較: 速度毎の一定速度での誤差と、速度のステップへの遅れ (制御周期 10.24ms で読む)
+ * @details 速度毎に、止まって (エッジなし) から推定値が0になるまでの時間も表示します。結果は表だけで、合否は判定しません
+ */
+bool scenarioEstimator() {
+    const uint8_t* pins = WHEEL_PINS[0];
+    MotorWheel periodWheel(pins[0], pins[1], pins[2], pins[3], &benchIrq);
+    MotorWheel averageWheel(pins[0], pins[1], pins[2], pins[3], &benchAvgIrq);
+    periodWheel.setSpeedEstimator(SPEED_EST_PERIOD);
+    averageWheel.setSpeedEstimator(SPEED_EST_AVERAGE);
+    MotorWheel* estimators[2] = {&periodWheel, &averageWheel};
+    const double speeds[] = {150, 300, 500, 1000, 2000, 4000, 6000, 8000};
+
+    printf("estimator: edges 45/55 +-15us, sampled every 10.24ms; error RMS/max %%, lag to the middle of x1.5 / x0.5 steps\n");
+    printf("%6s %6s %8s | %-39s | %-39s\n", "", "", "edge", "SPEED_EST_PERIOD", "SPEED_EST_AVERAGE");
+    printf("%6s %6s %8s | %7s %7s %7s %7s %7s | %7s %7s %7s %7s %7s\n", "RPM", "PPS", "period", "rms", "max", "up",
+           "down", "stop", "rms", "max", "up", "down", "stop");
+    for (double rpm : speeds) {
+        EstimatorResult r[2] = {};
+        runEstimators(estimators, rpm, r);
+        const double pps = rpm * CPR / SEC_PER_MIN;
+        printf("%6.0f %6.1f %6.1fms |", rpm, pps, 1000 / pps);
+        for (int k = 0; k < 2; k++) {
+            printf(" %6.1f%% %6.1f%% %5.0fms %5.0fms %5.0fms %s", r[k].rms, r[k].max, r[k].upMS, r[k].downMS,
+                   r[k].stopMS, k ? "\n" : "|");
+        }
+    }
+    printf("stop: from x0.5 of the speed to 0, -1 = not within 1s\n");
+    return true;
+}
+
+/// @brief pid シナリオの PID の設定
+struct PIDCase {
+    const char* name;
+    float kc, taui, taud;
+    bool pOnInput;
+    unsigned char dFilter;
+    bool gainSchedule;
+};
+
+/// @brief Motor と同じ使い方の PID 1つ (入力/出力/目標と、速度形の出力を積分したデューティ)
+struct PIDLoop {
+    int input = 0, output = 0, setpoint = 0;
+    long duty = 0;     ///< Motor::speed2DutyCycle と同じ (±MAX_SPEEDRPM)
+    double rpm = 0;    ///< 1次遅れのモデルの回転数
+    PID pid;
+
+    PIDLoop(const PIDCase& c, bool fixedPoint) : pid(&input, &output, &setpoint, c.kc, c.taui, c.taud) {
+        // Motor::PIDSetup() と同じ
+        pid.SetInputLimits(0, MAX_SPEEDRPM);
+        pid.SetOutputLimits(0, MAX_SPEEDRPM);
+        pid.SetSampleTime(config.sampleMS);
+        pid.SetFixedPoint(fixedPoint);
+        pid.SetMode(AUTO);
+        pid.SetDerivativeFilter(c.dFilter);
+        pid.SetProportionalOnInput(c.pOnInput);
+        pid.SetGainSchedule(c.gainSchedule);
+    }
+
+    /// @brief 1サンプル: PID を計算し、デューティを積分して、モデルを sampleMS 進めます
+    void step() {
+        pid.ComputeNow();
+        duty = constrain(duty + output, -(long)MAX_SPEEDRPM, (long)MAX_SPEEDRPM);
+        // 1次遅れ 80ms、不感帯 20/255、最大 7000RPM (デューティは MAX_SPEEDRPM が PWM 255)
+        const double deadband = MAX_SPEEDRPM * 20.0 / 255;
+        const double drive = std::max(0.0, fabs((double)duty) - deadband) * 7000 / (MAX_SPEEDRPM - deadband);
+        const double target = duty < 0 ? -drive : drive;
+        rpm += (target - rpm) * (1 - exp(-config.sampleMS / 80.0));
+        input = (int)lround(rpm);
+    }
+};
+
+/**
+ * @brief 固定小数点と float の PID::Compute() の比較
+ * @details 設定毎に次を調べ、1. か 2. で出力の差が PID_OUTPUT_TOLERANCE を超えたら終了コード1
+ *          1. ステップ応答: float の PID でモデルを動かし (目標 3000/6000/1000/7500/0/4000 RPM を1秒ずつ)、
+ *             同じ入力と目標を固定小数点の PID にも与えて、毎回の出力の差を比べる
+ *          2. 乱数: 目標と入力を 0..MAX_SPEEDRPM の乱数にした 200000 回の出力の差
+ *          3. (参考、判定しない) 固定小数点と float それぞれで別々にモデルを動かしたときの回転数の差
+ *             速度形の出力はデューティに積分されるため、1の差でもゲインが大きいと軌道が離れていく
+ *          処理時間は 2. の ComputeNow() 1回のホストの時間で、AVRのサイクル数ではありません
+ */
+bool scenarioPID() {
+    // 係数の丸めで1、それぞれが次の回に持ち越す切り捨ての端数 (1未満) でもう1
+    const int PID_OUTPUT_TOLERANCE = 2;
+    const PIDCase cases[] = {
+        {"command line", config.kc, config.taui, config.taud, config.pOnInput, (unsigned char)config.dFilter,
+         config.gainSchedule},
+        {"sketch", 0.31f, 0.01f, 0, false, 0, false},
+        {"sketch FF", 0.3f, 0.1f, 0, true, 0, false},
+        {"PID dfilter", 0.5f, 0.05f, 0.01f, false, 2, false},
+        {"PI sched", 2.97f, 0.081f, 0, false, 0, true},
+        {"PI p-in sched", 2.06f, 0.214f, 0, true, 0, true},
+        {"kc 90", 90, 0.01f, 0, false, 0, false},
+    };
+    const int setpoints[] = {3000, 6000, 1000, 7500, 0, 4000};
+    const int samplesPerStep = 1000 / config.sampleMS;
+    const unsigned long randomCount = 200000;
+    bool ok = true;
+
+    printf("pid: |fixed - float| of the output on the same step response (max/mean) and %lu random inputs (max),\n"
+           "     rpm drift of separate closed loops (max/mean, not checked), host ns per Compute\n", randomCount);
+    printf("%-14s %6s %6s %6s | %9s %9s | %6s | %9s %9s | %7s %7s\n", "case", "kc", "taui", "taud", "step max",
+           "mean", "random", "drift max", "mean", "fixed", "float");
+    for (const PIDCase& c : cases) {
+        // 1. ステップ応答 (float の PID の入力を固定小数点の PID にも与える)
+        PIDLoop floatLoop(c, false), shadow(c, true);
+        int sameMax = 0;
+        double sameSum = 0;
+        // 3. 別々の閉ループ
+        PIDLoop fixedLoop(c, true), floatLoop2(c, false);
+        int stepMax = 0;
+        double stepSum = 0;
+        unsigned long samples = 0;
+        for (int sp : setpoints) {
+            for (int n = 0; n < samplesPerStep; n++) {
+                floatLoop.setpoint = shadow.setpoint = fixedLoop.setpoint = floatLoop2.setpoint = sp;
+                shadow.input = floatLoop.input;
+                shadow.pid.ComputeNow();
+                floatLoop.step();
+                const int same = abs(shadow.output - floatLoop.output);
+                sameMax = std::max(sameMax, same);
+                sameSum += same;
+                fixedLoop.step();
+                floatLoop2.step();
+                const int diff = abs(fixedLoop.input - floatLoop2.input);
+                stepMax = std::max(stepMax, diff);
+                stepSum += diff;
+                samples++;
+            }
+        }
+        // 2. 乱数
+        PIDLoop fixedRandom(c, true), floatRandom(c, false);
+        unsigned rng = config.seed;
+        std::vector<int> randomInputs(randomCount * 2);
+        for (int& v : randomInputs) v = (int)((uniform(rng) + 1) / 2 * MAX_SPEEDRPM);
+        int randomMax = 0;
+        for (unsigned long n = 0; n < randomCount; n++) {
+            fixedRandom.setpoint = floatRandom.setpoint = randomInputs[2 * n];
+            fixedRandom.input = floatRandom.input = randomInputs[2 * n + 1];
+            fixedRandom.pid.ComputeNow();
+            floatRandom.pid.ComputeNow();
+            randomMax = std::max(randomMax, abs(fixedRandom.output - floatRandom.output));
+        }
+        double ns[2];
+        PIDLoop* timed[2] = {&fixedRandom, &floatRandom};
+        for (int k = 0; k < 2; k++) {
+            PIDLoop& loop = *timed[k];
+            const auto start = std::chrono::steady_clock::now();
+            for (unsigned long n = 0; n < randomCount; n++) {
+                loop.setpoint = randomInputs[2 * n];
+                loop.input = randomInputs[2 * n + 1];
+                loop.pid.ComputeNow();
+            }
+            ns[k] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                    randomCount;
+        }
+        const bool pass = sameMax <= PID_OUTPUT_TOLERANCE && randomMax <= PID_OUTPUT_TOLERANCE;
+        printf("%-14s %6.2f %6.3f %6.3f | %9d %9.3f | %6d | %9d %9.3f | %5.1fns %5.1fns%s\n", c.name, c.kc, c.taui,
+               c.taud, sameMax, sameSum / samples, randomMax, stepMax, stepSum / samples, ns[0], ns[1],
+               pass ? "" : "  FAIL");
+        ok &= pass;
+    }
+    printf("%s: the outputs of fixed point and float differ by %s %d\n", ok ? "PASS" : "FAIL", ok ? "at most" : "more than",
+           PID_OUTPUT_TOLERANCE);
+    return ok;
+}
+
+void printLoad() {
+    const double seconds = (host_micros - elapsedStartUs) * 1e-6;
+    const double isrRate = (host_isr_calls - isrCallsStart) / seconds;
+    const double controlRate = controlCalls / seconds;
+    printf("\ncontrol interval (wheel1): ");
+    const WheelLog& log = logs[0];
+    if (log.intervals) printf("min %.2fms mean %.2fms max %.2fms\n", log.intervalMin, log.intervalSum / log.intervals, log.intervalMax);
+    else printf("-\n");
+    printf("encoder interrupts: %.0f/s, host %.0fns each\n", isrRate, host_isr_calls ? host_isr_ns / host_isr_calls : 0);
+    printf("control (4 wheels): %.1f/s, host %.0fns each", controlRate, controlCalls ? controlNs / controlCalls : 0);
+    if (tickCalls) printf(", timer tick without control %.0fns", tickNs / tickCalls);
+    printf("\n");
+    const double load = (isrRate * config.isrCycles + controlRate * config.controlCycles) / AVR_CLOCK_HZ * 100;
+    printf("AVR 16MHz load estimate: %.1f%% (%.0f cycles/interrupt, %.0f cycles/control, estimates)\n", load,
+           config.isrCycles, config.controlCycles);
+}
+
+unsigned char parseRule(const std::string& value) {
+    if (value == "zn-pi") return AUTOTUNE_RULE_ZN_PI;
+    if (value == "zn-pid") return AUTOTUNE_RULE_ZN_PID;
+    return AUTOTUNE_RULE_TL_PI;
+}
+
+bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        const double num = atof(value.c_str());
+        if (key == "--scenario") config.scenario = value;
+        else if (key == "--mode") config.timerMode = value != "loop";
+        else if (key == "--from") config.fromRPM = (int)num;
+        else if (key == "--to") config.toRPM = (int)num;
+        else if (key == "--speed") config.speedMMPS = (int)num;
+        else if (key == "--kc") config.kc = (float)num;
+        else if (key == "--taui") config.taui = (float)num;
+        else if (key == "--taud") config.taud = (float)num;
+        else if (key == "--sample-ms") config.sampleMS = (int)num;
+        else if (key == "--estimator") config.estimator = value == "period" ? SPEED_EST_PERIOD : SPEED_EST_AVERAGE;
+        else if (key == "--decode") config.decode4x = value == "4x";
+        else if (key == "--fixed") config.fixedPoint = num != 0;
+        else if (key == "--ff") sscanf(value.c_str(), "%d,%d", &config.ffGain256, &config.ffOffsetRPM);
+        else if (key == "--antiwindup") config.antiWindup = (int)num;
+        else if (key == "--p-on-input") config.pOnInput = true;
+        else if (key == "--dfilter") config.dFilter = (int)num;
+        else if (key == "--gain-schedule") config.gainSchedule = true;
+        else if (key == "--rule") config.rule = parseRule(value);
+        else if (key == "--load") config.loadMNm = num;
+        else if (key == "--spread") config.spreadPercent = num;
+        else if (key == "--seed") config.seed = (unsigned)num;
+        else if (key == "--loop-work-us") config.loopWorkUs = (unsigned long)num;
+        else if (key == "--settle-ms") config.settleMS = (unsigned long)num;
+        else if (key == "--run-ms") config.runMS = (unsigned long)num;
+        else if (key == "--trace") config.tracePath = value;
+        else if (key == "--max-overshoot") config.maxOvershoot = num;
+        else if (key == "--max-settle-ms") config.maxSettleMS = num;
+        else if (key == "--max-latency-ms") config.maxLatencyMS = num;
+        else if (key == "--max-sserr") config.maxSSErr = num;
+        else if (key == "--isr-cycles") config.isrCycles = num;
+        else if (key == "--control-cycles") config.controlCycles = num;
+        else {
+            fprintf(stderr, "unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) return 2;
+    if (!config.tracePath.empty()) {
+        trace = fopen(config.tracePath.c_str(), "w");
+        if (!trace) {
+            perror(config.tracePath.c_str());
+            return 2;
+        }
+        fprintf(trace, "t_ms");
+        for (int i = 1; i <= NUM_WHEELS; i++) fprintf(trace, ",sp%d,rpm%d,est%d,pwm%d", i, i, i, i);
+        fprintf(trace, "\n");
+    }
+    host_delay_hook = delayHook;
+    host_analog_write_hook = onAnalogWrite;
+    setup();
+    elapsedStartUs = host_micros;
+    isrCallsStart = host_isr_calls;
+
+    if (config.scenario == "isr") return scenarioISR() ? 0 : 1; // 閉ループは使わない
+    if (config.scenario == "pins") return scenarioPins() ? 0 : 1;
+    if (config.scenario == "estimator") return scenarioEstimator() ? 0 : 1;
+    if (config.scenario == "pid") return scenarioPID() ? 0 : 1;
+
+    bool ok;
+    if (config.scenario == "car") ok = scenarioCar();
+    else if (config.scenario == "autotune") ok = scenarioAutoTune();
+    else ok = scenarioStep();
+    printLoad();
+
+    if (trace) fclose(trace);
+    return ok ? 0 : 1;
+}
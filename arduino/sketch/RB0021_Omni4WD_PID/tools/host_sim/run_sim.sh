@@ -0,0 +1,33 @@
+#!/bin/sh
+# MotorWheel / Omni4WD / PID_Beta6 のホストシミュレーターをビルドして実行する
+#
+# 使い方:
+#   ./run_sim.sh                                   # 1000 -> 4000 RPM のステップ応答 (スケッチのゲイン)
+#   ./run_sim.sh --scenario=autotune --rule=zn-pi --gain-schedule --from=4000 --to=1000 --run-ms=3000
+#   ./run_sim.sh --scenario=autotune --rule=zn-pi
+#   ./run_sim.sh --scenario=car --speed=200 --trace=car.csv
+#   ./run_sim.sh --scenario=autotune --gain-schedule --max-overshoot=1 --max-settle-ms=500   # 超えたら終了コード1
+#                                                  # TL PI + スケジューリング (--gain-schedule なしでは 500ms を超える)
+#   ./run_sim.sh --ff=273,601 --kc=0.3 --taui=0.1 --p-on-input --antiwindup=1 --max-overshoot=1 --max-settle-ms=500
+#                                                  # スケッチの PID_FEEDFORWARD の設定 (FF_GAIN256 273, FF_OFFSET_RPM 601)
+#                                                  # 7500 -> 2000 のような大きな減速では 2-3% 行き過ぎる
+#   ./run_sim.sh --ff=256,0 --kc=0.3 --taui=0.1 --p-on-input --antiwindup=1   # 不感帯なし (550-650ms)
+#   ./run_sim.sh --scenario=isr                    # irqISR() 1エッジの時間と V1.5 の割り込みとの speedPPS の比較
+#   ./run_sim.sh --scenario=pins                   # PIN_IN_READ() と digitalRead()、回転方向の判定の確認
+#   ./run_sim.sh --scenario=estimator              # 速度毎の推定誤差と遅れ (SPEED_EST_PERIOD / SPEED_EST_AVERAGE)
+#   ./run_sim.sh --scenario=pid                    # 固定小数点と float の PID の出力の差 (2を超えたら終了コード1)
+#   ./run_sim.sh --scenario=pid --kc=0.3 --taui=0.1 --p-on-input --dfilter=2   # 1行目の設定をコマンドラインで
+#   ./run_sim.sh --estimator=average --from=0 --to=500   # 推定方法を変えたステップ応答
+#
+# 環境変数 CXX / CXXFLAGS でコンパイラとオプションを変更できます
+set -e
+HERE=$(cd "$(dirname "$0")" && pwd)
+LIB="$HERE/../../lib"
+OUT="${SIM_BUILD_DIR:-$HERE/build}"
+mkdir -p "$OUT"
+${CXX:-c++} -std=gnu++11 ${CXXFLAGS:--O2} -DARDUINO=10819 -D_NAMIKI_MOTOR \
+    -I"$HERE" -I"$LIB/MotorWheel" -I"$LIB/PID_Beta6" \
+    "$HERE/motor_sim.cpp" "$HERE/host_arduino.cpp" \
+    "$LIB/MotorWheel/MotorWheel.cpp" "$LIB/MotorWheel/Omni4WD.cpp" "$LIB/PID_Beta6/PID_Beta6.cpp" \
+    -o "$OUT/motor_sim"
+exec "$OUT/motor_sim" "$@"